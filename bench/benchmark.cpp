@@ -788,6 +788,108 @@ void Iterate_WithSomeWork()
   benchmark::do_not_optimize(registry.size());
 }
 
+void Iterate_Parallel_Affine()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler;
+
+  // Every worker gets 128kb of components, so the working set of each core fits in its L2
+  const size_t entities = scheduler.workers() * 4096;
+  const size_t iterations = 2000;
+
+  for (size_t i = 0; i < entities; i++)
+  {
+    auto d = static_cast<double>(i);
+    registry.create(Position { d, d }, Velocity { d, d });
+  }
+
+  auto view = registry.view<Position, Velocity>();
+
+  loop_state state;
+  state.policy(assignment::affine);
+  state.chunk_size(256);
+
+  const auto update = [](auto, auto& position, auto& velocity)
+  {
+    position.x += velocity.x * 0.016;
+    position.y += velocity.y * 0.016;
+  };
+
+  view.parallel_for_each(scheduler, state, update); // Warm up the caches
+
+  BEGIN_BENCHMARK(Iterate_Parallel_Affine);
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    view.parallel_for_each(scheduler, state, update);
+  }
+
+  END_BENCHMARK(iterations, entities);
+
+  double sum = 0;
+
+  registry.for_each<Position>([&sum](auto, auto& position)
+    { sum += position.x + position.y; });
+
+  benchmark::do_not_optimize(sum);
+}
+
+void Iterate_Parallel_Random()
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::add<
+    archetype<Position, Velocity>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler;
+
+  // Every worker gets 128kb of components, so the working set of each core fits in its L2
+  const size_t entities = scheduler.workers() * 4096;
+  const size_t iterations = 2000;
+
+  for (size_t i = 0; i < entities; i++)
+  {
+    auto d = static_cast<double>(i);
+    registry.create(Position { d, d }, Velocity { d, d });
+  }
+
+  auto view = registry.view<Position, Velocity>();
+
+  loop_state state;
+  state.policy(assignment::random);
+  state.chunk_size(256);
+
+  const auto update = [](auto, auto& position, auto& velocity)
+  {
+    position.x += velocity.x * 0.016;
+    position.y += velocity.y * 0.016;
+  };
+
+  view.parallel_for_each(scheduler, state, update); // Warm up the caches
+
+  BEGIN_BENCHMARK(Iterate_Parallel_Random);
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    view.parallel_for_each(scheduler, state, update);
+  }
+
+  END_BENCHMARK(iterations, entities);
+
+  double sum = 0;
+
+  registry.for_each<Position>([&sum](auto, auto& position)
+    { sum += position.x + position.y; });
+
+  benchmark::do_not_optimize(sum);
+}
+
 int main()
 {
   Create_NoComponents();
@@ -815,5 +917,8 @@ int main()
   Iterate_STDVectorToCompare_WithSomeWork();
   Iterate_WithSomeWork();
 
+  Iterate_Parallel_Affine();
+  Iterate_Parallel_Random();
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#ifndef XECS_ACCESS_HPP
+#define XECS_ACCESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XECS_STREAMING_STORES
+#endif
+
+namespace xecs
+{
+namespace internal
+{
+  /**
+   * @brief Whether or not a component can be written with non-temporal stores.
+   * 
+   * @tparam Component Component type
+   */
+  template<typename Component>
+  struct streamable : std::bool_constant<std::is_trivially_copyable_v<Component>
+                        && sizeof(Component) % sizeof(int32_t) == 0 && alignof(Component) >= alignof(int32_t)>
+  {};
+
+  template<typename Component>
+  constexpr auto streamable_v = streamable<Component>::value;
+
+  /**
+   * @brief Writes a component with non-temporal stores.
+   * 
+   * The destination cache lines are not read and the written data does not pollute the cache.
+   * Falls back to a regular copy on platforms without non-temporal stores.
+   * 
+   * @tparam Component Component type (must be streamable)
+   * @param destination Component to write
+   * @param value Value to write
+   */
+  template<typename Component>
+  inline void stream(Component* destination, const Component& value)
+  {
+    static_assert(streamable_v<Component>, "Component cannot be written with non-temporal stores");
+
+#if defined(XECS_STREAMING_STORES)
+#if defined(__x86_64__) || defined(_M_X64)
+    if constexpr (sizeof(Component) % sizeof(int64_t) == 0 && alignof(Component) >= alignof(int64_t))
+    {
+      auto* words = reinterpret_cast<long long*>(destination);
+
+      for (size_t i = 0; i < sizeof(Component) / sizeof(int64_t); i++)
+      {
+        long long word;
+        std::memcpy(&word, reinterpret_cast<const char*>(&value) + i * sizeof(int64_t), sizeof(int64_t));
+
+        _mm_stream_si64(words + i, word);
+      }
+
+      return;
+    }
+#endif
+
+    auto* words = reinterpret_cast<int*>(destination);
+
+    for (size_t i = 0; i < sizeof(Component) / sizeof(int32_t); i++)
+    {
+      int word;
+      std::memcpy(&word, reinterpret_cast<const char*>(&value) + i * sizeof(int32_t), sizeof(int32_t));
+
+      _mm_stream_si32(words + i, word);
+    }
+#else
+    std::memcpy(static_cast<void*>(destination), &value, sizeof(Component));
+#endif
+  }
+
+  /**
+   * @brief Orders previous non-temporal stores before any following store.
+   * 
+   * Must be called before the written data is published to another thread.
+   */
+  inline void stream_fence()
+  {
+#if defined(XECS_STREAMING_STORES)
+    _mm_sfence();
+#endif
+  }
+} // namespace internal
+
+/**
+ * @brief Write-only access to a component.
+ * 
+ * Used in place of a component type in views (for example view<out<Force>, const Mass>) when a system
+ * completely overwrites the component without reading it. The callable is given an out object instead
+ * of a reference, the component can only be assigned.
+ * 
+ * When the column of the component is larger than the stream threshold, components are written with
+ * non-temporal stores. The old cache lines are never read and the written data does not evict the
+ * data that is still being read, which halves the memory traffic of the column.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component>
+class out
+{
+public:
+  using component_type = Component;
+
+  static_assert(!std::is_const_v<Component>, "Write-only components cannot be const");
+
+  /**
+   * @brief Size in bytes from which a column is written with non-temporal stores.
+   * 
+   * Smaller columns probably fit in the cache, and will be read again soon.
+   */
+  static constexpr size_t stream_threshold = size_t { 1 } << 22;
+
+  /**
+   * @brief Construct a new out object
+   * 
+   * @param component Component to write
+   * @param stream Whether or not to use non-temporal stores
+   */
+  out(Component* component, const bool stream) : _component(component), _stream(stream) {}
+
+  /**
+   * @brief Writes the component.
+   * 
+   * @param value Value to write
+   * @return out& This
+   */
+  out& operator=(const Component& value)
+  {
+    if constexpr (internal::streamable_v<Component>)
+    {
+      if (_stream)
+      {
+        internal::stream(_component, value);
+        return *this;
+      }
+    }
+
+    *_component = value;
+
+    return *this;
+  }
+
+  /**
+   * @brief Writes the component by moving a value.
+   * 
+   * @param value Value to move
+   * @return out& This
+   */
+  out& operator=(Component&& value)
+  {
+    if constexpr (internal::streamable_v<Component>) return *this = static_cast<const Component&>(value);
+    else
+    {
+      *_component = std::move(value);
+
+      return *this;
+    }
+  }
+
+  /**
+   * @brief Returns whether or not a column of the specified size is written with non-temporal stores.
+   * 
+   * @param count Amount of components in the column
+   * @return true If the column is written with non-temporal stores
+   */
+  [[nodiscard]] static constexpr bool streams(const size_t count)
+  {
+    return internal::streamable_v<Component> && count * sizeof(Component) >= stream_threshold;
+  }
+
+private:
+  Component* _component;
+  bool _stream;
+};
+
+/**
+ * @brief Removes access qualifiers (const and out) from a component type in a view.
+ * 
+ * @tparam Type Qualified component type
+ */
+template<typename Type>
+struct component
+{
+  using type = std::remove_const_t<Type>;
+};
+
+template<typename Component>
+struct component<out<Component>>
+{
+  using type = Component;
+};
+
+template<typename Type>
+using component_t = typename component<Type>::type;
+
+/**
+ * @brief Whether or not a type is a write-only component access.
+ * 
+ * @tparam Type Qualified component type
+ */
+template<typename Type>
+struct is_out : std::false_type
+{};
+
+template<typename Component>
+struct is_out<out<Component>> : std::true_type
+{};
+
+template<typename Type>
+constexpr auto is_out_v = is_out<Type>::value;
+} // namespace xecs
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef XECS_BUFFER_HPP
+#define XECS_BUFFER_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace xecs
+{
+/**
+ * @brief Memory that stores the elements of every buffer of a component in a storage.
+ * 
+ * The arena is a single growable array of elements, split in blocks whose capacity is a power of two.
+ * Released blocks are kept in a free list per capacity and reused by the next allocation of the same
+ * capacity, so once the arena is large enough buffers grow and shrink without any allocation.
+ * 
+ * Blocks are identified by their offset in the arena, offsets stay valid when the arena grows.
+ * 
+ * @tparam Type Element type, must be trivial
+ */
+template<typename Type>
+class buffer_arena final
+{
+public:
+  using value_type = Type;
+  using size_type = uint32_t;
+
+  static_assert(std::is_trivial_v<Type>, "Buffer elements must be trivial");
+
+  /**
+   * @brief Construct a new buffer arena object
+   */
+  buffer_arena() : _data(NULL), _size(0), _capacity(0) {}
+
+  /**
+   * @brief Destroy the buffer arena object
+   */
+  ~buffer_arena() { free(_data); }
+
+  buffer_arena(const buffer_arena&) = delete;
+  buffer_arena(buffer_arena&&) = delete;
+  buffer_arena& operator=(const buffer_arena&) = delete;
+  buffer_arena& operator=(buffer_arena&&) = delete;
+
+  /**
+   * @brief Allocates a block of elements.
+   * 
+   * @warning Allocating may grow the arena, pointers to elements of the arena are invalidated.
+   * 
+   * @param capacity Capacity of the block, must be a power of two
+   * @return size_type Offset of the block in the arena
+   */
+  size_type allocate(const size_type capacity)
+  {
+    assert((capacity & (capacity - 1)) == 0 && "Capacity of the block is not a power of two");
+
+    std::vector<size_type>& free_list = _free[order(capacity)];
+
+    if (!free_list.empty())
+    {
+      const size_type offset = free_list.back();
+
+      free_list.pop_back();
+
+      return offset;
+    }
+
+    if (_size + capacity > _capacity)
+    {
+      const size_type grown = _capacity * 2;
+
+      _capacity = _size + capacity > grown ? _size + capacity : grown;
+      _data = static_cast<Type*>(std::realloc(_data, _capacity * sizeof(Type)));
+    }
+
+    const size_type offset = _size;
+
+    _size += capacity;
+
+    return offset;
+  }
+
+  /**
+   * @brief Releases a block so that it can be reused.
+   * 
+   * The elements of the block are left untouched until the block is allocated again.
+   * 
+   * @param offset Offset of the block in the arena
+   * @param capacity Capacity of the block
+   */
+  void release(const size_type offset, const size_type capacity) { _free[order(capacity)].push_back(offset); }
+
+  /**
+   * @brief Releases every block, keeps the memory.
+   */
+  void clear()
+  {
+    _size = 0;
+
+    for (auto& free_list : _free) free_list.clear();
+  }
+
+  /**
+   * @brief Replaces the blocks of this arena with copies of the blocks of another arena.
+   * 
+   * Offsets are the same in both arenas.
+   * 
+   * @param other Arena to copy
+   */
+  void assign(const buffer_arena& other)
+  {
+    if (other._size > _capacity)
+    {
+      _capacity = other._size;
+      _data = static_cast<Type*>(std::realloc(_data, _capacity * sizeof(Type)));
+    }
+
+    if (other._size != 0) std::memcpy(_data, other._data, other._size * sizeof(Type));
+
+    _size = other._size;
+
+    for (size_type i = 0; i < orders; i++) _free[i] = other._free[i];
+  }
+
+  /**
+   * @brief Returns the elements of the arena.
+   * 
+   * @return Type* Pointer to the first element of the arena
+   */
+  [[nodiscard]] Type* data() { return _data; }
+
+  /**
+   * @brief Returns the amount of elements that are part of a block (used or released).
+   * 
+   * @return size_type Amount of elements in blocks
+   */
+  [[nodiscard]] size_type size() const { return _size; }
+
+  /**
+   * @brief Returns the amount of elements the arena can contain without growing.
+   * 
+   * @return size_type Capacity of the arena
+   */
+  [[nodiscard]] size_type capacity() const { return _capacity; }
+
+private:
+  /**
+   * @brief Amount of different block capacities.
+   */
+  static constexpr size_type orders = 32;
+
+  /**
+   * @brief Returns the log2 of a power of two capacity.
+   * 
+   * @param capacity Capacity of a block
+   * @return size_type Index of the free list of the capacity
+   */
+  static size_type order(size_type capacity)
+  {
+    size_type result = 0;
+
+    while (capacity >>= 1) result++;
+
+    return result;
+  }
+
+private:
+  Type* _data;
+  size_type _size;
+  size_type _capacity;
+
+  std::vector<size_type> _free[orders];
+};
+
+/**
+ * @brief Component that stores a variable amount of elements.
+ * 
+ * The first few elements are stored inline, in the component itself. Larger buffers move their
+ * elements to a block of the buffer_arena of the storage, and only keep the offset of the block.
+ * The component is trivially copyable, so the storage relocates it like any other trivial component
+ * (no per-entity allocation, no element-wise move when the storage grows).
+ * 
+ * The storage owns the blocks: it gives every inserted buffer its own copy of the elements and
+ * releases the block when the entity is erased. Buffers can only grow past their inline capacity
+ * while they are in a storage.
+ * 
+ * @warning Assigning a buffer to another buffer of the same storage makes both use the same block,
+ * use assign with the elements instead. Buffers of the same storage share its arena: growing them
+ * from many threads, or swapping the archetype of an entity while its storage is modified by another
+ * thread, is not thread-safe. Snapshots only copy the handles, they see the current elements.
+ * 
+ * @tparam Type Element type, must be trivial
+ * @tparam Inline Amount of elements stored inline
+ */
+template<typename Type, size_t Inline = 8>
+class buffer final
+{
+public:
+  using value_type = Type;
+  using size_type = uint32_t;
+  using arena_type = buffer_arena<Type>;
+  using iterator = Type*;
+  using const_iterator = const Type*;
+
+  static_assert(std::is_trivial_v<Type>, "Buffer elements must be trivial");
+  static_assert(Inline > 0, "Buffers must have atleast one inline element");
+
+  /**
+   * @brief Amount of elements stored inline.
+   */
+  static constexpr size_type inline_capacity = static_cast<size_type>(Inline);
+
+  /**
+   * @brief Construct a new empty buffer object
+   */
+  buffer() : _arena(NULL), _offset(0), _size(0), _capacity(inline_capacity) {}
+
+  /**
+   * @brief Adds an element at the end of the buffer.
+   * 
+   * @param value Element to add
+   */
+  void push_back(const Type& value)
+  {
+    if (_size == _capacity) reserve(_capacity * 2);
+
+    data()[_size++] = value;
+  }
+
+  /**
+   * @brief Removes the last element of the buffer.
+   */
+  void pop_back()
+  {
+    assert(_size != 0 && "Buffer is empty");
+
+    _size--;
+  }
+
+  /**
+   * @brief Replaces the elements of the buffer.
+   * 
+   * @warning The elements must not be in the arena of the buffer, growing may move them.
+   * 
+   * @param first Pointer to the first element
+   * @param count Amount of elements
+   */
+  void assign(const Type* first, const size_type count)
+  {
+    reserve(count);
+
+    if (count != 0) std::memmove(data(), first, count * sizeof(Type));
+
+    _size = count;
+  }
+
+  /**
+   * @brief Changes the amount of elements, new elements are value initialized.
+   * 
+   * @param size New amount of elements
+   */
+  void resize(const size_type size)
+  {
+    reserve(size);
+
+    for (size_type i = _size; i < size; i++) data()[i] = Type();
+
+    _size = size;
+  }
+
+  /**
+   * @brief Removes every element, keeps the capacity.
+   */
+  void clear() { _size = 0; }
+
+  /**
+   * @brief Makes sure the buffer can contain atleast the specified amount of elements without growing.
+   * 
+   * @param capacity Minimum capacity of the buffer
+   */
+  void reserve(const size_type capacity)
+  {
+    if (capacity <= _capacity) return;
+
+    assert(_arena && "Buffer must be in a storage to grow past its inline capacity");
+
+    size_type grown = _capacity;
+
+    while (grown < capacity) grown *= 2;
+
+    grown = ceil(grown);
+
+    const size_type offset = _arena->allocate(grown);
+
+    // Allocating may move the arena, the old elements are found again
+    if (_size != 0) std::memcpy(_arena->data() + offset, data(), _size * sizeof(Type));
+
+    if (_capacity > inline_capacity) _arena->release(_offset, _capacity);
+
+    _offset = offset;
+    _capacity = grown;
+  }
+
+  [[nodiscard]] Type& operator[](const size_type index) { return data()[index]; }
+  [[nodiscard]] const Type& operator[](const size_type index) const { return data()[index]; }
+
+  [[nodiscard]] Type* data() { return _capacity > inline_capacity ? _arena->data() + _offset : _inline; }
+  [[nodiscard]] const Type* data() const { return _capacity > inline_capacity ? _arena->data() + _offset : _inline; }
+
+  [[nodiscard]] iterator begin() { return data(); }
+  [[nodiscard]] iterator end() { return data() + _size; }
+  [[nodiscard]] const_iterator begin() const { return data(); }
+  [[nodiscard]] const_iterator end() const { return data() + _size; }
+
+  /**
+   * @brief Returns the amount of elements in the buffer.
+   * 
+   * @return size_type Amount of elements
+   */
+  [[nodiscard]] size_type size() const { return _size; }
+
+  /**
+   * @brief Returns the amount of elements the buffer can contain without growing.
+   * 
+   * @return size_type Capacity of the buffer
+   */
+  [[nodiscard]] size_type capacity() const { return _capacity; }
+
+  /**
+   * @brief Returns whether or not the buffer is empty.
+   * 
+   * @return true If the buffer has no elements, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return _size == 0; }
+
+  /**
+   * @brief Makes the buffer use an arena, with its own copy of the elements.
+   * 
+   * Used by storages when a buffer is inserted: the block of the buffer (if any) belongs to another
+   * entity, maybe of another arena.
+   * 
+   * @param arena Arena of the storage
+   */
+  void adopt(arena_type* arena)
+  {
+    if (_capacity > inline_capacity)
+    {
+      arena_type* const source = _arena;
+      const size_type offset = arena->allocate(_capacity);
+
+      // Allocating may move the arena, the source block is found again
+      if (_size != 0) std::memmove(arena->data() + offset, source->data() + _offset, _size * sizeof(Type));
+
+      _offset = offset;
+    }
+
+    _arena = arena;
+  }
+
+  /**
+   * @brief Makes the buffer use another arena that has the same blocks (see buffer_arena::assign).
+   * 
+   * @param arena Copy of the arena of the buffer
+   */
+  void rebind(arena_type* arena) { _arena = arena; }
+
+  /**
+   * @brief Releases the block of the buffer, if it has one.
+   */
+  void release()
+  {
+    if (_capacity > inline_capacity) _arena->release(_offset, _capacity);
+  }
+
+private:
+  /**
+   * @brief Returns the smallest power of two that is larger or equal to a capacity.
+   * 
+   * @param capacity Capacity of a block
+   * @return size_type Power of two capacity
+   */
+  static size_type ceil(const size_type capacity)
+  {
+    size_type result = 1;
+
+    while (result < capacity) result *= 2;
+
+    return result;
+  }
+
+private:
+  arena_type* _arena;
+  size_type _offset;
+  size_type _size;
+  size_type _capacity;
+
+  Type _inline[Inline];
+};
+
+/**
+ * @brief Whether or not a component is a buffer.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component>
+struct is_buffer : std::false_type
+{};
+
+template<typename Type, size_t Inline>
+struct is_buffer<buffer<Type, Inline>> : std::true_type
+{};
+
+template<typename Component>
+constexpr auto is_buffer_v = is_buffer<Component>::value;
+} // namespace xecs
+
+#endif
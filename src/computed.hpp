@@ -0,0 +1,69 @@
+#ifndef XECS_COMPUTED_HPP
+#define XECS_COMPUTED_HPP
+
+#include "archetype.hpp"
+
+#include <type_traits>
+
+namespace xecs
+{
+/**
+ * @brief Declares a component that is computed from other components of the same entity.
+ * 
+ * Components are not computed by default. To compute a component, specialize this struct with
+ * the list of input components and a compute function, for example:
+ * 
+ * template<>
+ * struct xecs::computed<WorldBounds>
+ * {
+ *   using inputs = list<Transform, Mesh>;
+ *   static void compute(WorldBounds& bounds, const Transform& transform, const Mesh& mesh);
+ * };
+ * 
+ * A computed component is stored in a regular column like any other component. Storages track which
+ * entities had an input written since the component was last computed, and only compute the component
+ * again for those entities: lazily when it is unpacked, or in batch before it is iterated (see
+ * storage::compute). Every archetype that contains a computed component must contain its inputs.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component>
+struct computed
+{};
+
+/**
+ * @brief Whether or not a component is computed from other components.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component, typename = void>
+struct is_computed : std::false_type
+{};
+
+template<typename Component>
+struct is_computed<Component, std::void_t<typename computed<Component>::inputs>> : std::true_type
+{};
+
+template<typename Component>
+constexpr auto is_computed_v = is_computed<Component>::value;
+
+/**
+ * @brief Whether or not a component is computed from the specified component.
+ * 
+ * @tparam Component Component type
+ * @tparam Input Input component type
+ */
+template<typename Component, typename Input, typename = void>
+struct depends_on : std::false_type
+{};
+
+template<typename Component, typename Input>
+struct depends_on<Component, Input, std::enable_if_t<is_computed_v<Component>>>
+  : std::bool_constant<contains_v<Input, typename computed<Component>::inputs>>
+{};
+
+template<typename Component, typename Input>
+constexpr auto depends_on_v = depends_on<Component, Input>::value;
+} // namespace xecs
+
+#endif
@@ -0,0 +1,536 @@
+#ifndef XECS_COROUTINE_HPP
+#define XECS_COROUTINE_HPP
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include "execution.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define XECS_COROUTINES 1
+
+namespace xecs
+{
+class system_task;
+
+/**
+ * @brief Point of the frame where asynchronous systems are resumed.
+ * 
+ * Systems written as coroutines (system_task) can start long work and co_await it. When
+ * the work completes, on whatever thread, the system is not resumed immediately. Instead, it is
+ * queued and resumed the next time the phase is resumed, on the thread that resumes the phase
+ * (usually the main thread at a well defined point of the frame). This means that after a co_await,
+ * a system can safely access the registry again, the same way a regular system would.
+ * 
+ * The phase owns every system that is spawned on it.
+ * 
+ * @note Only the methods that queue systems (called by completions) are thread-safe.
+ */
+class phase final
+{
+public:
+  using size_type = size_t;
+
+  /**
+   * @brief Construct a new phase object
+   */
+  phase() = default;
+
+  /**
+   * @brief Destroy the phase object
+   * 
+   * Destroys every system that did not complete. Work that they awaited and that completes later
+   * is dropped, the phase is not used anymore.
+   */
+  ~phase();
+
+  phase(const phase&) = delete;
+  phase(phase&&) = delete;
+  phase& operator=(const phase&) = delete;
+  phase& operator=(phase&&) = delete;
+
+  /**
+   * @brief Starts a system and takes ownership of it.
+   * 
+   * The system runs on the calling thread until its first co_await.
+   * 
+   * @param task The system to start
+   */
+  void spawn(system_task task);
+
+  /**
+   * @brief Resumes every system whose awaited work has completed.
+   * 
+   * Systems that are queued while resuming (for example with next()) are resumed by the next call.
+   * Completed systems are destroyed.
+   * 
+   * @throw Rethrows the first exception thrown by a system that completed
+   * 
+   * @return size_type The amount of systems that were resumed
+   */
+  size_type resume();
+
+  /**
+   * @brief Returns an awaitable that suspends the system until the next time the phase is resumed.
+   * 
+   * @return auto Awaitable
+   */
+  auto next()
+  {
+    struct awaitable
+    {
+      phase* owner;
+
+      bool await_ready() const noexcept { return false; }
+
+      void await_suspend(std::coroutine_handle<> handle) { owner->queue(handle); }
+
+      void await_resume() const noexcept {}
+    };
+
+    return awaitable { this };
+  }
+
+  /**
+   * @brief Returns the amount of systems that are still running.
+   * 
+   * @return size_type Amount of systems still running
+   */
+  [[nodiscard]] size_type running() const { return _tasks.size(); }
+
+  /**
+   * @brief Queues a suspended system to be resumed at the next resume.
+   * 
+   * This method is thread-safe.
+   * 
+   * @param handle Suspended coroutine
+   */
+  void queue(std::coroutine_handle<> handle)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ready.push_back(handle);
+  }
+
+private:
+  std::mutex _mutex;
+  std::vector<std::coroutine_handle<>> _ready;
+  std::vector<std::coroutine_handle<>> _resuming;
+  std::vector<system_task> _tasks;
+};
+
+/**
+ * @brief Result of external work that a system can co_await.
+ * 
+ * The work is completed by calling complete with the result, from any thread. The awaiting system
+ * is then resumed the next time its phase is resumed.
+ * 
+ * Deferred results are handles, copies share the same result.
+ * 
+ * @tparam Type Result type
+ */
+template<typename Type>
+class deferred
+{
+private:
+  struct state
+  {
+    std::mutex mutex;
+    std::optional<Type> value;
+    std::coroutine_handle<> waiter;
+    phase* owner = nullptr;
+  };
+
+public:
+  /**
+   * @brief Construct a new deferred object
+   */
+  deferred() : _state(std::make_shared<state>()) {}
+
+  /**
+   * @brief Completes the work with the specified result.
+   * 
+   * If the awaiting system was destroyed (with its phase), the result is kept but nothing is resumed.
+   * 
+   * This method is thread-safe.
+   * 
+   * @throw std::logic_error If the work was already completed, the first result is kept
+   * 
+   * @param value Result of the work
+   */
+  void complete(Type value)
+  {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+
+    // The waiter was already queued once, resuming it twice would resume a running system
+    if (_state->value) throw std::logic_error("Deferred result was already completed");
+
+    _state->value.emplace(std::move(value));
+
+    if (_state->waiter) _state->owner->queue(_state->waiter);
+  }
+
+  /**
+   * @brief Returns whether or not the work has completed.
+   * 
+   * @return true If the work has completed, false otherwise
+   */
+  [[nodiscard]] bool ready() const
+  {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return _state->value.has_value();
+  }
+
+  /**
+   * @brief Returns an awaitable that resumes on the phase once the work has completed.
+   * 
+   * Used by system_task, you should not need to call this directly.
+   * 
+   * @param owner Phase to resume on
+   * @return auto Awaitable
+   */
+  auto on(phase* owner) const
+  {
+    struct awaitable
+    {
+      std::shared_ptr<state> shared;
+      phase* owner;
+      std::coroutine_handle<> handle;
+
+      // Lives in the frame of the system, destroyed with it
+      ~awaitable()
+      {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+
+        // The system will not be resumed, completing must not use it or its phase
+        if (handle && shared->waiter == handle)
+        {
+          shared->waiter = nullptr;
+          shared->owner = nullptr;
+        }
+      }
+
+      bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(std::coroutine_handle<> suspended)
+      {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+
+        // Already completed, the system can continue right away
+        if (shared->value) return false;
+
+        handle = suspended;
+
+        shared->waiter = handle;
+        shared->owner = owner;
+
+        return true;
+      }
+
+      Type await_resume() { return std::move(*shared->value); }
+    };
+
+    return awaitable { _state, owner, nullptr };
+  }
+
+private:
+  std::shared_ptr<state> _state;
+};
+
+namespace internal
+{
+  template<typename Type, typename = void>
+  struct is_sender : std::false_type
+  {};
+
+  template<typename Type>
+  struct is_sender<Type, std::void_t<typename Type::values>> : std::true_type
+  {};
+
+  template<typename Type>
+  struct is_deferred : std::false_type
+  {};
+
+  template<typename Type>
+  struct is_deferred<deferred<Type>> : std::true_type
+  {};
+
+  template<typename List>
+  struct sender_result;
+
+  template<>
+  struct sender_result<list<>>
+  {
+    using type = void;
+  };
+
+  template<typename Value>
+  struct sender_result<list<Value>>
+  {
+    using type = std::decay_t<Value>;
+  };
+
+  template<typename... Values>
+  struct sender_result<list<Values...>>
+  {
+    using type = std::tuple<std::decay_t<Values>...>;
+  };
+
+  /**
+   * @brief Awaits a sender and resumes on the phase once it completes.
+   * 
+   * Senders that complete with a single value return that value, senders with many values
+   * return a tuple. Errors are rethrown in the system and stopped senders throw std::runtime_error.
+   * 
+   * The operation and its result are kept outside of the frame of the system, until the operation
+   * completes, so that destroying the system (with its phase) while the sender runs is safe.
+   */
+  template<typename Sender>
+  class sender_awaitable
+  {
+  private:
+    using result_type = typename sender_result<typename Sender::values>::type;
+    using storage_type = std::conditional_t<std::is_void_v<result_type>, bool, result_type>;
+
+    struct completion;
+
+    struct receiver
+    {
+      completion* shared;
+
+      template<typename... Values>
+      void set_value(Values&&... values) noexcept
+      {
+        if constexpr (std::is_void_v<result_type>) shared->result.emplace(true);
+        else
+          shared->result.emplace(std::forward<Values>(values)...);
+
+        shared->finish();
+      }
+
+      void set_error(std::exception_ptr error) noexcept
+      {
+        shared->error = std::move(error);
+        shared->finish();
+      }
+
+      void set_stopped() noexcept { shared->finish(); }
+    };
+
+    /**
+     * @brief State shared by the awaitable and the running operation.
+     */
+    struct completion
+    {
+      std::mutex mutex;
+      phase* owner;
+      std::coroutine_handle<> handle;
+      std::optional<storage_type> result;
+      std::exception_ptr error;
+      std::shared_ptr<completion> running;
+      execution::internal::connect_result_t<Sender, receiver> operation;
+
+      completion(const Sender& sender, phase* resume_on)
+        : owner(resume_on), operation(sender.connect(receiver { this }))
+      {}
+
+      /**
+       * @brief Queues the system on its phase, if it still exists.
+       */
+      void finish() noexcept
+      {
+        std::shared_ptr<completion> self;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Released after the lock, the operation may be destroyed once it has completed
+        self = std::move(running);
+
+        if (owner) owner->queue(handle);
+      }
+    };
+
+  public:
+    sender_awaitable(const Sender& sender, phase* owner)
+      : _shared(std::make_shared<completion>(sender, owner))
+    {}
+
+    ~sender_awaitable()
+    {
+      std::lock_guard<std::mutex> lock(_shared->mutex);
+
+      // The system will not be resumed, completing must not use it or its phase
+      _shared->owner = nullptr;
+    }
+
+    sender_awaitable(const sender_awaitable&) = delete;
+    sender_awaitable(sender_awaitable&&) = delete;
+    sender_awaitable& operator=(const sender_awaitable&) = delete;
+    sender_awaitable& operator=(sender_awaitable&&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+      _shared->handle = handle;
+      _shared->running = _shared;
+      _shared->operation.start();
+    }
+
+    result_type await_resume()
+    {
+      if (_shared->error) std::rethrow_exception(_shared->error);
+      if (!_shared->result) throw std::runtime_error("Awaited sender was stopped");
+
+      if constexpr (!std::is_void_v<result_type>) return std::move(*_shared->result);
+    }
+
+  private:
+    std::shared_ptr<completion> _shared;
+  };
+} // namespace internal
+
+/**
+ * @brief Coroutine type for asynchronous systems.
+ * 
+ * A system task is lazily started and must be spawned on a phase. Inside the system, deferred
+ * results and senders can be co_awaited. The system is always resumed by the phase, so it can
+ * access the registry after every co_await.
+ * 
+ * @warning Entities held across a co_await may have been destroyed in the meantime. Check them
+ * with registry::has or use registry::try_unpack before writing results back.
+ */
+class system_task
+{
+public:
+  class promise_type
+  {
+  public:
+    system_task get_return_object() { return system_task { std::coroutine_handle<promise_type>::from_promise(*this) }; }
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    std::suspend_always final_suspend() const noexcept { return {}; }
+
+    void return_void() const noexcept {}
+
+    void unhandled_exception() { _error = std::current_exception(); }
+
+    template<typename Awaitable>
+    decltype(auto) await_transform(Awaitable&& awaitable)
+    {
+      using type = std::decay_t<Awaitable>;
+
+      if constexpr (internal::is_deferred<type>::value) return awaitable.on(_owner);
+      else if constexpr (internal::is_sender<type>::value)
+        return internal::sender_awaitable<type> { awaitable, _owner };
+      else
+        return std::forward<Awaitable>(awaitable);
+    }
+
+  private:
+    friend class phase;
+
+    phase* _owner = nullptr;
+    std::exception_ptr _error;
+  };
+
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  system_task(system_task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+  system_task& operator=(system_task&& other) noexcept
+  {
+    if (this != &other)
+    {
+      if (_handle) _handle.destroy();
+      _handle = std::exchange(other._handle, nullptr);
+    }
+
+    return *this;
+  }
+
+  system_task(const system_task&) = delete;
+  system_task& operator=(const system_task&) = delete;
+
+  ~system_task()
+  {
+    if (_handle) _handle.destroy();
+  }
+
+  /**
+   * @brief Returns whether or not the system has completed.
+   * 
+   * @return true If the system completed
+   */
+  [[nodiscard]] bool done() const { return !_handle || _handle.done(); }
+
+private:
+  friend class phase;
+
+  explicit system_task(handle_type handle) : _handle(handle) {}
+
+private:
+  handle_type _handle;
+};
+
+inline phase::~phase()
+{
+  _tasks.clear();
+}
+
+inline void phase::spawn(system_task task)
+{
+  task._handle.promise()._owner = this;
+
+  auto handle = task._handle;
+
+  _tasks.push_back(std::move(task));
+
+  handle.resume();
+}
+
+inline phase::size_type phase::resume()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _resuming.swap(_ready);
+  }
+
+  const size_type resumed = _resuming.size();
+
+  for (auto handle : _resuming) handle.resume();
+
+  _resuming.clear();
+
+  std::exception_ptr error;
+
+  for (size_type i = 0; i < _tasks.size();)
+  {
+    if (_tasks[i].done())
+    {
+      if (!error) error = _tasks[i]._handle.promise()._error;
+
+      _tasks[i] = std::move(_tasks.back());
+      _tasks.pop_back();
+    }
+    else
+      i++;
+  }
+
+  if (error) std::rethrow_exception(error);
+
+  return resumed;
+}
+} // namespace xecs
+
+#endif
+
+#endif
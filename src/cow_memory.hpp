@@ -0,0 +1,609 @@
+#ifndef XECS_COW_MEMORY_HPP
+#define XECS_COW_MEMORY_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace xecs
+{
+namespace internal
+{
+  /**
+   * @brief Returns the size of a page of virtual memory.
+   * 
+   * @return size_t Page size in bytes
+   */
+  inline size_t page_size()
+  {
+#if defined(__linux__)
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+  }
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+  /**
+   * @brief File of the pages shared by a cow_memory and its forks.
+   * 
+   * Every page of the file counts the memories that map it. Pages that are not mapped anymore are
+   * punched out of the file, which frees their memory, and reused by the next pages written.
+   */
+  class page_file final
+  {
+  public:
+    /**
+     * @brief Page of the file used by nothing, pages of memories that are not in the file yet.
+     */
+    static constexpr size_t none = static_cast<size_t>(-1);
+
+    /**
+     * @brief Construct a new page file object
+     * 
+     * @param fd Memory file descriptor, closed with the page file
+     */
+    explicit page_file(const int fd) : _fd(fd), _size(0) {}
+
+    /**
+     * @brief Destroy the page file object
+     */
+    ~page_file() { close(_fd); }
+
+    page_file(const page_file&) = delete;
+    page_file(page_file&&) = delete;
+    page_file& operator=(const page_file&) = delete;
+    page_file& operator=(page_file&&) = delete;
+
+    /**
+     * @brief Creates an empty page file.
+     * 
+     * @return std::shared_ptr<page_file> The page file, NULL if memory files are not supported
+     */
+    static std::shared_ptr<page_file> create()
+    {
+      const int fd = static_cast<int>(syscall(SYS_memfd_create, "xecs", 1u)); // MFD_CLOEXEC
+
+      return fd < 0 ? nullptr : std::make_shared<page_file>(fd);
+    }
+
+    /**
+     * @brief Returns the file descriptor of the page file.
+     * 
+     * @return int File descriptor
+     */
+    [[nodiscard]] int fd() const { return _fd; }
+
+    /**
+     * @brief Takes pages that are not used by any memory, they are then used once.
+     * 
+     * Pages are taken in increasing order when possible, so consecutive pages of a memory can be
+     * mapped at once.
+     * 
+     * @param count Amount of pages to take
+     * @param pages Taken pages, appended
+     * @return true If the pages were taken, false if the file could not grow
+     */
+    bool take(const size_t count, std::vector<size_t>& pages)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+
+      const size_t reused = std::min(count, _free.size());
+      const size_t grown = count - reused;
+
+      if (grown != 0 && ftruncate(_fd, static_cast<off_t>((_size + grown) * page_size())) != 0) return false;
+
+      for (size_t i = 0; i < reused; i++)
+      {
+        pages.push_back(_free.back());
+        _uses[_free.back()] = 1;
+        _free.pop_back();
+      }
+
+      for (size_t i = 0; i < grown; i++)
+      {
+        pages.push_back(_size++);
+        _uses.push_back(1);
+      }
+
+      return true;
+    }
+
+    /**
+     * @brief Signals that another memory maps the pages.
+     * 
+     * @param pages Pages of the file, none is skipped
+     */
+    void use(const std::vector<size_t>& pages)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+
+      for (const size_t page : pages)
+      {
+        if (page != none) _uses[page]++;
+      }
+    }
+
+    /**
+     * @brief Signals that a memory does not map the pages anymore, pages that are not used are freed.
+     * 
+     * @param pages Pages of the file, none is skipped
+     */
+    void release(const std::vector<size_t>& pages)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+
+      const size_t first = _free.size();
+
+      for (const size_t page : pages)
+      {
+        if (page != none && --_uses[page] == 0) _free.push_back(page);
+      }
+
+      if (first == _free.size()) return;
+
+      // The memory of every consecutive run of unused pages is freed at once
+      std::sort(_free.begin() + static_cast<std::ptrdiff_t>(first), _free.end());
+
+      for (size_t i = first; i < _free.size();)
+      {
+        size_t last = i + 1;
+
+        while (last < _free.size() && _free[last] == _free[last - 1] + 1) last++;
+
+        fallocate(_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(_free[i] * page_size()),
+          static_cast<off_t>((last - i) * page_size()));
+
+        i = last;
+      }
+
+      // Pages are taken from the back, the smallest pages first
+      std::sort(_free.begin(), _free.end(), std::greater<size_t>());
+    }
+
+  private:
+    const int _fd;
+    size_t _size;
+    std::vector<uint32_t> _uses;
+    std::vector<size_t> _free;
+    std::mutex _mutex;
+  };
+#endif
+} // namespace internal
+
+/**
+ * @brief Contiguous memory whose pages are shared copy-on-write with its forks.
+ * 
+ * Forking maps the pages of the memory a second time, at another address, and nothing is copied: both
+ * memories read the same physical pages. The first write to a page, by either memory, gives that memory its
+ * own copy of the page (the copy is made by the operating system, writes do not need to signal anything).
+ * Memory only grows with the pages that are written after a fork.
+ * 
+ * To be shared, pages are kept in a memory file. Pages written since the last fork (and pages that were never
+ * forked) are moved to the file by the next fork, so forking costs a few system calls, plus one copy of every page
+ * that was written since the last fork. The first fork therefore copies every page that was ever written, it costs
+ * as much as copying the memory: only the next forks are cheap. Consecutive pages are mapped at once, but memories
+ * that are forked and written many times end up with many mappings.
+ * 
+ * The memory starts with a private page that points to the cow_memory, so that it can be found from the data
+ * (see of). Small amounts of memory are cheaper to copy than to map (see minimum_size).
+ * 
+ * @note Pages are only shared on linux (see supported), elsewhere fork always fails.
+ * 
+ * @warning Pages are shared as bytes, they must only contain trivially copyable objects. The memory must not be
+ * written while it is forked.
+ */
+class cow_memory final
+{
+public:
+  using size_type = size_t;
+
+  /**
+   * @brief Size under which memory is copied instead of being shared.
+   */
+  static constexpr size_type minimum_size = 64 * 1024;
+
+  /**
+   * @brief Construct a new cow memory object, every byte is zero.
+   * 
+   * @param size Size in bytes, rounded up to a multiple of the page size
+   */
+  explicit cow_memory(const size_type size)
+    : _size((size + internal::page_size() - 1) / internal::page_size() * internal::page_size())
+  {
+#if defined(__linux__) && defined(SYS_memfd_create)
+    void* region = mmap(NULL, header() + _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    _region = region == MAP_FAILED ? NULL : static_cast<char*>(region);
+
+    _pages.assign(_size / internal::page_size(), internal::page_file::none);
+#else
+    _region = static_cast<char*>(std::calloc(1, header() + _size));
+#endif
+
+    if (_region) *reinterpret_cast<cow_memory**>(_region) = this;
+  }
+
+  /**
+   * @brief Destroy the cow memory object
+   */
+  ~cow_memory()
+  {
+#if defined(__linux__) && defined(SYS_memfd_create)
+    if (_region) munmap(_region, header() + _size);
+    if (_file) _file->release(_pages);
+#else
+    std::free(_region);
+#endif
+  }
+
+  cow_memory(const cow_memory&) = delete;
+  cow_memory(cow_memory&&) = delete;
+  cow_memory& operator=(const cow_memory&) = delete;
+  cow_memory& operator=(cow_memory&&) = delete;
+
+  /**
+   * @brief Returns whether or not pages can be shared on this system.
+   * 
+   * @return true If forks share pages, false if fork always fails
+   */
+  [[nodiscard]] static bool supported()
+  {
+#if defined(__linux__) && defined(SYS_memfd_create)
+    static const bool supported = internal::page_file::create() != nullptr;
+    return supported;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * @brief Returns whether or not memory of the specified size is a cow_memory (see allocate).
+   * 
+   * @param size Size in bytes
+   * @return true If the memory is shared with forks, false if it is copied
+   */
+  [[nodiscard]] static bool shares(const size_type size) { return size >= minimum_size && supported(); }
+
+  /**
+   * @brief Allocates memory that can be forked (see duplicate), every byte is zero.
+   * 
+   * Large memory is the data of a new cow_memory, small memory is allocated with calloc.
+   * 
+   * @param size Size in bytes
+   * @return void* The memory, freed with deallocate, NULL if it could not be allocated
+   */
+  [[nodiscard]] static void* allocate(const size_type size)
+  {
+    if (!shares(size)) return std::calloc(1, size);
+
+    cow_memory* memory = new cow_memory(size);
+
+    if (!memory->_region)
+    {
+      delete memory;
+      return NULL;
+    }
+
+    return memory->data();
+  }
+
+  /**
+   * @brief Moves memory allocated with malloc to memory that can be forked (see allocate).
+   * 
+   * Arrays are allocated with malloc until they are first forked, so that arrays that are never forked
+   * do not pay for shared pages. Small memory is the same for both and is not moved.
+   * 
+   * @tparam Type Type of the elements of the memory
+   * @param data Memory to move, may be NULL, set to the moved memory (freed with deallocate)
+   * @param size Size of the memory
+   * @return true If the memory was moved, false if it could not be allocated (data is then unchanged)
+   */
+  template<typename Type>
+  static bool share(Type*& data, const size_type size)
+  {
+    if (!data || !shares(size)) return true;
+
+    void* shared = allocate(size);
+
+    if (!shared) return false;
+
+    std::memcpy(shared, static_cast<void*>(data), size);
+    std::free(static_cast<void*>(data));
+
+    data = static_cast<Type*>(shared);
+
+    return true;
+  }
+
+  /**
+   * @brief Resizes memory allocated with allocate, like realloc.
+   * 
+   * @param data Memory to resize, NULL to allocate
+   * @param previous Size of the memory
+   * @param size New size in bytes, the bytes after the previous size are unspecified
+   * @return void* The resized memory, NULL if it could not be allocated
+   */
+  [[nodiscard]] static void* reallocate(void* data, const size_type previous, const size_type size)
+  {
+    if (!shares(previous) && !shares(size)) return std::realloc(data, size);
+
+    void* resized = allocate(size);
+
+    // Like realloc, the memory is kept when it cannot be resized
+    if (!resized) return NULL;
+
+    if (data)
+    {
+      std::memcpy(resized, data, std::min(previous, size));
+      deallocate(data, previous);
+    }
+
+    return resized;
+  }
+
+  /**
+   * @brief Frees memory allocated with allocate.
+   * 
+   * @param data Memory to free, may be NULL
+   * @param size Size of the memory
+   */
+  static void deallocate(void* data, const size_type size)
+  {
+    if (data && shares(size)) delete of(data);
+    else
+      std::free(data);
+  }
+
+  /**
+   * @brief Returns a copy-on-write fork of memory allocated with allocate (see fork).
+   * 
+   * Memory that cannot be shared is copied.
+   * 
+   * @param data Memory to fork, may be NULL
+   * @param size Size of the memory
+   * @return void* The fork, freed with deallocate, NULL if it could not be allocated
+   */
+  [[nodiscard]] static void* duplicate(void* data, const size_type size)
+  {
+    if (!data) return NULL;
+
+    if (shares(size))
+    {
+      if (cow_memory* memory = of(data)->fork()) return memory->data();
+    }
+
+    void* copy = allocate(size);
+
+    if (copy) std::memcpy(copy, data, size);
+
+    return copy;
+  }
+
+  /**
+   * @brief Returns the memory that contains the specified data.
+   * 
+   * @param data Data of a cow_memory (see data)
+   * @return cow_memory* The memory of the data
+   */
+  [[nodiscard]] static cow_memory* of(const void* data)
+  {
+    return *reinterpret_cast<cow_memory* const*>(static_cast<const char*>(data) - header());
+  }
+
+  /**
+   * @brief Returns the first byte of the memory, aligned to a page.
+   * 
+   * @return void* Data of the memory
+   */
+  [[nodiscard]] void* data() const { return _region + header(); }
+
+  /**
+   * @brief Returns the size of the memory.
+   * 
+   * @return size_type Size in bytes, a multiple of the page size
+   */
+  [[nodiscard]] size_type size() const { return _size; }
+
+  /**
+   * @brief Makes a copy-on-write fork of the memory.
+   * 
+   * @return cow_memory* Fork of the memory, owned by the caller, NULL if pages cannot be shared
+   */
+  [[nodiscard]] cow_memory* fork()
+  {
+#if defined(__linux__) && defined(SYS_memfd_create)
+    if (!_region || !flush()) return NULL;
+
+    cow_memory* fork = new cow_memory(_size);
+
+    if (!fork->_region)
+    {
+      delete fork;
+      return NULL;
+    }
+
+    fork->_file = _file;
+    fork->_pages = _pages;
+
+    if (_file) _file->use(_pages);
+
+    fork->map(0, _pages.size());
+
+    return fork;
+#else
+    return NULL;
+#endif
+  }
+
+private:
+  /**
+   * @brief Returns the size of the private header in front of the data.
+   * 
+   * @return size_type Size in bytes
+   */
+  static size_type header() { return internal::page_size(); }
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+  /**
+   * @brief Moves every page that is not shared in the file yet to the file.
+   * 
+   * Pages that were written since they were mapped from the file, or that were never in the file, are
+   * found with the page map of the process. Pages that were never touched are moved without being written,
+   * new pages of the file are zero. Without the page map, every page is written again.
+   * 
+   * @return true If every page is in the file, false if the file cannot be created or grown
+   */
+  bool flush()
+  {
+    const size_type page = internal::page_size();
+    const size_type count = _pages.size();
+
+    // Present bit 63, swapped bit 62, file or shared bit 61. Unknown pages are present and written
+    const uint64_t unknown = uint64_t { 1 } << 63;
+
+    std::vector<uint64_t> entries(count, unknown);
+
+    static const int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+
+    if (pagemap >= 0)
+    {
+      const size_type bytes = count * sizeof(uint64_t);
+      const off_t offset = static_cast<off_t>(reinterpret_cast<uintptr_t>(data()) / page * sizeof(uint64_t));
+
+      if (pread(pagemap, entries.data(), bytes, offset) != static_cast<ssize_t>(bytes))
+      {
+        std::fill(entries.begin(), entries.end(), unknown);
+      }
+    }
+
+    std::vector<size_type> moved;
+    std::vector<bool> written;
+
+    for (size_type i = 0; i < count; i++)
+    {
+      const bool touched = (entries[i] >> 62) != 0;
+      const bool anonymous = touched && ((entries[i] >> 61) & 1) == 0;
+
+      if (_pages[i] == internal::page_file::none || anonymous)
+      {
+        moved.push_back(i);
+        written.push_back(touched);
+      }
+    }
+
+    if (moved.empty()) return true;
+
+    if (!_file && !(_file = internal::page_file::create())) return false;
+
+    std::vector<size_type> pages;
+
+    if (!_file->take(moved.size(), pages)) return false;
+
+    for (size_type i = 0; i < moved.size(); i++)
+    {
+      if (!written[i]) continue;
+
+      size_type last = i + 1;
+
+      while (last < moved.size() && written[last] && moved[last] == moved[last - 1] + 1 && pages[last] == pages[last - 1] + 1) last++;
+
+      const char* source = static_cast<const char*>(data()) + moved[i] * page;
+
+      for (size_type done = 0, bytes = (last - i) * page; done < bytes;)
+      {
+        const ssize_t result = pwrite(_file->fd(), source + done, bytes - done, static_cast<off_t>(pages[i] * page + done));
+
+        if (result <= 0)
+        {
+          _file->release(pages);
+          return false;
+        }
+
+        done += static_cast<size_type>(result);
+      }
+
+      i = last - 1;
+    }
+
+    std::vector<size_type> replaced;
+
+    for (size_type i = 0; i < moved.size(); i++)
+    {
+      replaced.push_back(_pages[moved[i]]);
+      _pages[moved[i]] = pages[i];
+    }
+
+    for (size_type i = 0; i < moved.size();)
+    {
+      size_type last = i + 1;
+
+      while (last < moved.size() && moved[last] == moved[last - 1] + 1) last++;
+
+      map(moved[i], moved[last - 1] + 1);
+
+      i = last;
+    }
+
+    _file->release(replaced);
+
+    return true;
+  }
+
+  /**
+   * @brief Maps the pages in the range [first, last) from the file, consecutive pages of the file at once.
+   * 
+   * @param first First page of the range
+   * @param last Page after the last page of the range
+   */
+  void map(const size_type first, const size_type last)
+  {
+    const size_type page = internal::page_size();
+
+    for (size_type i = first; i < last;)
+    {
+      size_type end = i + 1;
+
+      while (end < last && _pages[end] == _pages[end - 1] + 1) end++;
+
+      void* address = static_cast<char*>(data()) + i * page;
+
+      void* mapped = mmap(address, (end - i) * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+        _file->fd(), static_cast<off_t>(_pages[i] * page));
+
+      assert(mapped == address && "Could not map pages of the memory file");
+
+      (void)mapped; // Suppress unused warning
+
+      i = end;
+    }
+  }
+#endif
+
+private:
+  char* _region;
+  size_type _size;
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+  std::shared_ptr<internal::page_file> _file;
+  std::vector<size_type> _pages;
+#endif
+};
+} // namespace xecs
+
+#endif
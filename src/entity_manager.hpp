@@ -2,6 +2,7 @@
 #define XECS_ENTITY_MANAGER_HPP
 
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
@@ -34,9 +35,13 @@ namespace xecs
  * will then go to the heap. The manager will always priorize fetching from the stack. It is possible to swap recycled values
  * accumulated in the heap memory stack into the stack memory stack
  * 
+ * With a fixed capacity, the stack memory stack can contain every entity, so the heap is never used and
+ * the entity manager never allocates.
+ * 
  * @tparam Entity unsigned integer type to represent entity
+ * @tparam Capacity Maximum amount of entities, zero if the entity manager grows
  */
-template<typename Entity>
+template<typename Entity, size_t Capacity = 0>
 class entity_manager
 {
 public:
@@ -50,7 +55,12 @@ public:
    * @brief Fixed capacity of entities for stack memory stack.
    * 
    */
-  static constexpr size_type stack_capacity = ENTITY_MANAGER_STACK_SIZE / sizeof(entity_type);
+  static constexpr size_type stack_capacity = Capacity ? Capacity : ENTITY_MANAGER_STACK_SIZE / sizeof(entity_type);
+
+  /**
+   * @brief Whether or not the entity manager has a fixed capacity and never allocates.
+   */
+  static constexpr bool fixed = Capacity != 0;
 
   /**
    * @brief Minimum capacity on entities for the heap memory stack.
@@ -68,9 +78,9 @@ public:
    * 
    */
   entity_manager()
-    : _current(0), _stack_reusable(0), _heap_reusable(0), _heap_capacity(minimum_heap_capacity), _stack_buffer()
+    : _current(0), _stack_reusable(0), _heap_reusable(0), _heap_capacity(fixed ? 0 : minimum_heap_capacity), _stack_buffer()
   {
-    _heap_buffer = static_cast<heap_buffer_type>(std::malloc(minimum_heap_capacity * sizeof(entity_type)));
+    _heap_buffer = fixed ? NULL : static_cast<heap_buffer_type>(std::malloc(minimum_heap_capacity * sizeof(entity_type)));
   }
 
   /**
@@ -100,7 +110,31 @@ public:
     else if (_heap_reusable)
       return _heap_buffer[--_heap_reusable];
     else
+    {
+      assert((!fixed || _current < Capacity) && "Too many entities for the fixed capacity of the entity manager");
+
       return _current++;
+    }
+  }
+
+  /**
+   * @brief Generates a block of unique entities, [first, first + count).
+   * 
+   * Recycled entities are not used, so that the block is contiguous. Only the internal counter
+   * is incremented.
+   * 
+   * @param count Amount of entities to generate
+   * @return entity_type The first entity identifier of the block
+   */
+  entity_type generate(const size_type count)
+  {
+    const entity_type first = _current;
+
+    assert((!fixed || _current + count <= Capacity) && "Too many entities for the fixed capacity of the entity manager");
+
+    _current += static_cast<entity_type>(count);
+
+    return first;
   }
 
   /**
@@ -112,6 +146,8 @@ public:
    */
   void release(entity_type entity)
   {
+    assert((!fixed || _stack_reusable < stack_capacity) && "Released more entities than the fixed capacity of the entity manager");
+
     if (_stack_reusable < stack_capacity) _stack_buffer[_stack_reusable++] = entity;
     else
     {
@@ -141,6 +177,40 @@ public:
     _current = 0;
   }
 
+  /**
+   * @brief Copies the internal counter and the reusable entities of another entity_manager.
+   * 
+   * Both entity_managers generate the same entities after that.
+   * 
+   * @param other The entity_manager to copy
+   */
+  void assign(const entity_manager& other)
+  {
+    reserve(other._heap_reusable);
+
+    _current = other._current;
+    _stack_reusable = other._stack_reusable;
+    _heap_reusable = other._heap_reusable;
+
+    std::memcpy(_stack_buffer, other._stack_buffer, _stack_reusable * sizeof(entity_type));
+    std::memcpy(_heap_buffer, other._heap_buffer, _heap_reusable * sizeof(entity_type));
+  }
+
+  /**
+   * @brief Resets the internal counter and clears reusable entities.
+   * 
+   * Used once the live entities have been renumbered to the range [0, current), the
+   * next generated entity will be current.
+   * 
+   * @param current New value of the internal counter
+   */
+  void reset(const entity_type current)
+  {
+    _stack_reusable = 0;
+    _heap_reusable = 0;
+    _current = current;
+  }
+
   /**
    * @brief moves reusable heap memory entites into stack memory as best as possible.
    * 
@@ -164,6 +234,22 @@ public:
     }
   }
 
+  /**
+   * @brief Grows the heap memory stack to fit atleast the specified amount of recycled entities.
+   * 
+   * @param capacity Minimum capacity of the heap memory stack
+   */
+  void reserve(const size_type capacity)
+  {
+    // Fixed entity managers never use the heap
+    if (!fixed && capacity > _heap_capacity)
+    {
+      _heap_capacity = capacity;
+
+      _heap_buffer = static_cast<heap_buffer_type>(std::realloc(_heap_buffer, _heap_capacity * sizeof(entity_type)));
+    }
+  }
+
   /**
    * @brief Resizes the heap memory stack to be as small possible.
    * 
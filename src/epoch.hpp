@@ -0,0 +1,288 @@
+#ifndef XECS_EPOCH_HPP
+#define XECS_EPOCH_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace xecs
+{
+/**
+ * @brief Epoch-based memory reclamation.
+ * 
+ * Allows memory that is still being read by other threads to be retired instead of freed. Readers
+ * pin the current epoch while they read, this never blocks and never waits on writers. Writers retire
+ * the memory they replace, and it is freed once every reader that could have seen it has left its epoch.
+ * 
+ * Every reader thread uses its own slot (for example, the worker index of a scheduler). Slots are
+ * aligned to cache lines so readers never share one.
+ * 
+ * @note A retired block of memory is freed at the earliest two epochs after it was retired.
+ */
+class epoch_manager final
+{
+public:
+  using size_type = size_t;
+  using epoch_type = uint64_t;
+
+private:
+  /**
+   * @brief Epoch currently pinned by a reader, zero when the reader is not reading.
+   */
+  struct alignas(64) slot
+  {
+    std::atomic<epoch_type> epoch { 0 };
+  };
+
+  /**
+   * @brief Memory that is waiting to be reclaimed.
+   */
+  struct retired
+  {
+    void* ptr;
+    size_type count;
+    void (*reclaim)(void*, size_type);
+    epoch_type epoch;
+  };
+
+public:
+  /**
+   * @brief Keeps an epoch pinned for as long as it exists.
+   * 
+   * Memory obtained while the guard exists stays valid until the guard is destroyed.
+   */
+  class guard
+  {
+  public:
+    explicit guard(std::atomic<epoch_type>* local) : _local(local) {}
+
+    ~guard() { _local->store(0, std::memory_order_release); }
+
+    guard(const guard&) = delete;
+    guard(guard&&) = delete;
+    guard& operator=(const guard&) = delete;
+    guard& operator=(guard&&) = delete;
+
+  private:
+    std::atomic<epoch_type>* _local;
+  };
+
+  /**
+   * @brief Construct a new epoch manager object
+   * 
+   * @param slots Maximum amount of readers that can read at the same time
+   */
+  explicit epoch_manager(const size_type slots = 64)
+    : _slots(new slot[slots > 0 ? slots : 1]), _slot_count(slots > 0 ? slots : 1), _epoch(1)
+  {}
+
+  /**
+   * @brief Destroy the epoch manager object
+   * 
+   * Reclaims all retired memory, there must not be any readers left.
+   */
+  ~epoch_manager()
+  {
+    for (auto& entry : _retired) entry.reclaim(entry.ptr, entry.count);
+  }
+
+  epoch_manager(const epoch_manager&) = delete;
+  epoch_manager(epoch_manager&&) = delete;
+  epoch_manager& operator=(const epoch_manager&) = delete;
+  epoch_manager& operator=(epoch_manager&&) = delete;
+
+  /**
+   * @brief Pins the current epoch for the reader of the specified slot.
+   * 
+   * This method is thread-safe and wait-free.
+   * 
+   * @warning Two threads must never pin the same slot at the same time.
+   * 
+   * @param slot Slot of the reader
+   * @return guard Guard that unpins the epoch when destroyed
+   */
+  guard pin(const size_type slot)
+  {
+    assert(slot < _slot_count && "Slot is out of range");
+
+    auto& local = _slots[slot].epoch;
+
+    // The epoch must be visible to writers before the reader loads any pointer
+    local.store(_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+
+    return guard { &local };
+  }
+
+  /**
+   * @brief Retires memory allocated with malloc.
+   * 
+   * The memory is freed once no reader can be reading it. Tries to reclaim older memory.
+   * 
+   * This method is thread-safe.
+   * 
+   * @param ptr Memory to free
+   */
+  void retire(void* ptr)
+  {
+    retire(ptr, 0, [](void* p, size_type)
+      { std::free(p); });
+  }
+
+  /**
+   * @brief Retires an array allocated with malloc.
+   * 
+   * The elements of the array are destroyed and the array is freed once no reader can be
+   * reading it. Tries to reclaim older memory.
+   * 
+   * This method is thread-safe.
+   * 
+   * @tparam Type Type of elements
+   * @param ptr Array to free
+   * @param count Amount of constructed elements in the array
+   */
+  template<typename Type>
+  void retire(Type* ptr, const size_type count)
+  {
+    retire(ptr, count, [](void* p, size_type n)
+      {
+        if constexpr (!std::is_trivially_destructible_v<Type>)
+        {
+          for (size_type i = 0; i < n; i++) static_cast<Type*>(p)[i].~Type();
+        }
+        else
+          (void)n; // Suppress unused warning
+
+        std::free(p);
+      });
+  }
+
+  /**
+   * @brief Retires an object allocated with new.
+   * 
+   * This method is thread-safe.
+   * 
+   * @tparam Type Type of object
+   * @param ptr Object to delete
+   */
+  template<typename Type>
+  void retire_object(Type* ptr)
+  {
+    retire(ptr, 0, [](void* p, size_type)
+      { delete static_cast<Type*>(p); });
+  }
+
+  /**
+   * @brief Tries to advance the epoch and reclaims the memory that is no longer reachable.
+   * 
+   * This method is thread-safe.
+   * 
+   * @return size_type Amount of retired blocks that were reclaimed
+   */
+  size_type collect()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return reclaim();
+  }
+
+  /**
+   * @brief Returns the amount of retired blocks waiting to be reclaimed.
+   * 
+   * @return size_type Amount of retired blocks
+   */
+  [[nodiscard]] size_type pending()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _retired.size();
+  }
+
+  /**
+   * @brief Returns the current global epoch.
+   * 
+   * @return epoch_type Current epoch
+   */
+  [[nodiscard]] epoch_type epoch() const { return _epoch.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Returns the maximum amount of readers.
+   * 
+   * @return size_type Amount of slots
+   */
+  [[nodiscard]] size_type slots() const { return _slot_count; }
+
+private:
+  void retire(void* ptr, const size_type count, void (*reclaim)(void*, size_type))
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _retired.push_back({ ptr, count, reclaim, _epoch.load(std::memory_order_relaxed) });
+
+    this->reclaim();
+  }
+
+  /**
+   * @brief Advances the epoch if every reader has reached it.
+   * 
+   * @return true If the epoch was advanced
+   */
+  bool try_advance()
+  {
+    const epoch_type current = _epoch.load(std::memory_order_relaxed);
+
+    for (size_type i = 0; i < _slot_count; i++)
+    {
+      const epoch_type local = _slots[i].epoch.load(std::memory_order_seq_cst);
+
+      if (local != 0 && local != current) return false;
+    }
+
+    _epoch.store(current + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  size_type reclaim()
+  {
+    try_advance();
+
+    const epoch_type current = _epoch.load(std::memory_order_relaxed);
+
+    size_type reclaimed = 0;
+
+    for (size_type i = 0; i < _retired.size();)
+    {
+      auto& entry = _retired[i];
+
+      // Readers can only be one epoch behind, two epochs later nobody can see the memory
+      if (entry.epoch + 2 <= current)
+      {
+        entry.reclaim(entry.ptr, entry.count);
+
+        entry = _retired.back();
+        _retired.pop_back();
+
+        reclaimed++;
+      }
+      else
+        i++;
+    }
+
+    return reclaimed;
+  }
+
+private:
+  std::unique_ptr<slot[]> _slots;
+  size_type _slot_count;
+  std::atomic<epoch_type> _epoch;
+  std::mutex _mutex;
+  std::vector<retired> _retired;
+};
+} // namespace xecs
+
+#endif
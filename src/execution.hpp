@@ -0,0 +1,830 @@
+#ifndef XECS_EXECUTION_HPP
+#define XECS_EXECUTION_HPP
+
+#include "archetype.hpp"
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace xecs
+{
+/**
+ * @brief Minimal sender/receiver framework (in the style of P2300 std::execution).
+ * 
+ * This allows ecs work to be composed into asynchronous runtimes that are built on senders
+ * without wrapping it in blocking calls.
+ * 
+ * A receiver is any type with the following member functions:
+ * - set_value(Values...) : Called when the work succeeded
+ * - set_error(std::exception_ptr) : Called when the work failed
+ * - set_stopped() : Called when the work was cancelled
+ * 
+ * A sender describes work without starting it. Every sender declares the values it completes with
+ * as a list (values) and can be connected to a receiver. Connecting returns an operation state
+ * that starts the work when start() is called. Operation states cannot be moved, they must stay
+ * alive until a completion is signaled to the receiver.
+ * 
+ * A scheduler is anything that can be passed to schedule() to obtain a sender that completes on
+ * its execution context. The xecs::scheduler and inline_scheduler are schedulers.
+ */
+namespace execution
+{
+  namespace internal
+  {
+    template<typename Sender, typename Receiver>
+    using connect_result_t = decltype(std::declval<const Sender&>().connect(std::declval<Receiver>()));
+
+    template<typename List>
+    struct decayed_tuple;
+
+    template<typename... Values>
+    struct decayed_tuple<list<Values...>>
+    {
+      using type = std::tuple<std::decay_t<Values>...>;
+    };
+
+    template<typename List>
+    using decayed_tuple_t = typename decayed_tuple<List>::type;
+
+    template<typename... Lists>
+    struct concat
+    {
+      using type = list<>;
+    };
+
+    template<typename... Types>
+    struct concat<list<Types...>>
+    {
+      using type = list<Types...>;
+    };
+
+    template<typename... ATypes, typename... BTypes, typename... Lists>
+    struct concat<list<ATypes...>, list<BTypes...>, Lists...>
+    {
+      using type = typename concat<list<ATypes..., BTypes...>, Lists...>::type;
+    };
+
+    template<typename... Lists>
+    using concat_t = typename concat<Lists...>::type;
+
+    template<typename Function, typename List>
+    struct invoke_values;
+
+    template<typename Function, typename... Values>
+    struct invoke_values<Function, list<Values...>>
+    {
+    private:
+      using result = std::invoke_result_t<Function, Values...>;
+
+    public:
+      using type = std::conditional_t<std::is_void_v<result>, list<>, list<result>>;
+    };
+
+    template<typename Function, typename List>
+    using invoke_values_t = typename invoke_values<Function, List>::type;
+  } // namespace internal
+
+  /**
+   * @brief Scheduler that executes work immediately on the thread that starts it.
+   */
+  class inline_scheduler
+  {
+  public:
+    class sender
+    {
+    public:
+      using values = list<>;
+
+      template<typename Receiver>
+      struct operation
+      {
+        Receiver receiver;
+
+        void start() noexcept { receiver.set_value(); }
+      };
+
+      template<typename Receiver>
+      operation<Receiver> connect(Receiver receiver) const { return { std::move(receiver) }; }
+    };
+
+    /**
+     * @brief Returns a sender that completes inline when started.
+     * 
+     * @return sender The schedule sender
+     */
+    sender schedule() const { return {}; }
+  };
+
+  /**
+   * @brief Sender that completes on a worker thread of the xecs::scheduler.
+   */
+  class pool_sender
+  {
+  public:
+    using values = list<>;
+
+    template<typename Receiver>
+    class operation : scheduler::task
+    {
+    public:
+      operation(scheduler* scheduler, Receiver receiver)
+        : scheduler::task { &operation::execute, NULL }, _scheduler(scheduler), _receiver(std::move(receiver))
+      {}
+
+      operation(const operation&) = delete;
+      operation(operation&&) = delete;
+      operation& operator=(const operation&) = delete;
+      operation& operator=(operation&&) = delete;
+
+      void start() noexcept { _scheduler->submit(this); }
+
+    private:
+      static void execute(scheduler::task* task)
+      {
+        static_cast<operation*>(task)->_receiver.set_value();
+      }
+
+    private:
+      scheduler* _scheduler;
+      Receiver _receiver;
+    };
+
+    explicit pool_sender(scheduler* scheduler) : _scheduler(scheduler) {}
+
+    template<typename Receiver>
+    operation<Receiver> connect(Receiver receiver) const { return { _scheduler, std::move(receiver) }; }
+
+  private:
+    scheduler* _scheduler;
+  };
+
+  /**
+   * @brief Returns a sender that completes on the execution context of the scheduler.
+   * 
+   * @tparam Scheduler Scheduler type
+   * @param scheduler The scheduler
+   * @return auto The schedule sender
+   */
+  template<typename Scheduler>
+  auto schedule(Scheduler& scheduler) { return scheduler.schedule(); }
+
+  /*! @copydoc schedule */
+  inline pool_sender schedule(xecs::scheduler& scheduler) { return pool_sender { &scheduler }; }
+
+  template<typename Scheduler>
+  using schedule_result_t = decltype(schedule(std::declval<Scheduler&>()));
+
+  /**
+   * @brief Sender that completes immediately with the specified values.
+   * 
+   * @tparam Values Value types
+   */
+  template<typename... Values>
+  class just_sender
+  {
+  public:
+    using values = list<Values...>;
+
+    template<typename Receiver>
+    struct operation
+    {
+      std::tuple<Values...> stored;
+      Receiver receiver;
+
+      void start() noexcept
+      {
+        std::apply([this](auto&... values)
+          { receiver.set_value(std::move(values)...); },
+          stored);
+      }
+    };
+
+    explicit just_sender(Values... values) : _values(std::move(values)...) {}
+
+    template<typename Receiver>
+    operation<Receiver> connect(Receiver receiver) const { return { _values, std::move(receiver) }; }
+
+  private:
+    std::tuple<Values...> _values;
+  };
+
+  /**
+   * @brief Returns a sender that completes immediately with the specified values.
+   * 
+   * @tparam Values Value types
+   * @param values Values to complete with
+   * @return just_sender<Values...> The sender
+   */
+  template<typename... Values>
+  just_sender<std::decay_t<Values>...> just(Values&&... values)
+  {
+    return just_sender<std::decay_t<Values>...> { std::forward<Values>(values)... };
+  }
+
+  /**
+   * @brief Sender that invokes a function with the values of another sender.
+   * 
+   * Completes with the result of the function. If the function throws, completes with the error.
+   * 
+   * @tparam Sender Predecessor sender type
+   * @tparam Function Function type
+   */
+  template<typename Sender, typename Function>
+  class then_sender
+  {
+  public:
+    using values = internal::invoke_values_t<Function, typename Sender::values>;
+
+    template<typename Receiver>
+    struct receiver
+    {
+      Function function;
+      Receiver next;
+
+      template<typename... Values>
+      void set_value(Values&&... values) noexcept
+      {
+        try
+        {
+          if constexpr (empty_v<then_sender::values>)
+          {
+            function(std::forward<Values>(values)...);
+            next.set_value();
+          }
+          else
+            next.set_value(function(std::forward<Values>(values)...));
+        }
+        catch (...)
+        {
+          next.set_error(std::current_exception());
+        }
+      }
+
+      void set_error(std::exception_ptr error) noexcept { next.set_error(std::move(error)); }
+
+      void set_stopped() noexcept { next.set_stopped(); }
+    };
+
+    then_sender(Sender sender, Function function) : _sender(std::move(sender)), _function(std::move(function)) {}
+
+    template<typename Receiver>
+    auto connect(Receiver next) const
+    {
+      return _sender.connect(receiver<Receiver> { _function, std::move(next) });
+    }
+
+  private:
+    Sender _sender;
+    Function _function;
+  };
+
+  /**
+   * @brief Pipeable adaptor returned by then(function).
+   * 
+   * @tparam Function Function type
+   */
+  template<typename Function>
+  struct then_closure
+  {
+    Function function;
+  };
+
+  /**
+   * @brief Returns a sender that invokes the function with the values of the sender.
+   * 
+   * @tparam Sender Sender type
+   * @tparam Function Function type
+   * @param sender Predecessor sender
+   * @param function Function to invoke
+   * @return then_sender<Sender, Function> The sender
+   */
+  template<typename Sender, typename Function>
+  then_sender<Sender, Function> then(Sender sender, Function function)
+  {
+    return { std::move(sender), std::move(function) };
+  }
+
+  /**
+   * @brief Returns a pipeable adaptor, sender | then(function) is the same as then(sender, function).
+   * 
+   * @tparam Function Function type
+   * @param function Function to invoke
+   * @return then_closure<Function> The adaptor
+   */
+  template<typename Function>
+  then_closure<Function> then(Function function) { return { std::move(function) }; }
+
+  template<typename Sender, typename Function>
+  then_sender<Sender, Function> operator|(Sender sender, then_closure<Function> closure)
+  {
+    return { std::move(sender), std::move(closure.function) };
+  }
+
+  /**
+   * @brief Sender that completes once all the senders have completed.
+   * 
+   * Completes with the values of all senders concatenated in order. If any sender fails, completes with
+   * the first error once all senders have completed. Otherwise, if any sender was stopped, completes
+   * as stopped.
+   * 
+   * @tparam Senders Sender types
+   */
+  template<typename... Senders>
+  class when_all_sender
+  {
+  public:
+    using values = internal::concat_t<typename Senders::values...>;
+
+    template<typename Receiver>
+    class operation
+    {
+    private:
+      template<size_t I>
+      struct receiver
+      {
+        operation* op;
+
+        template<typename... Values>
+        void set_value(Values&&... values) noexcept
+        {
+          std::get<I>(op->_values).emplace(std::forward<Values>(values)...);
+          op->arrive();
+        }
+
+        void set_error(std::exception_ptr error) noexcept
+        {
+          {
+            std::lock_guard<std::mutex> lock(op->_mutex);
+            if (!op->_error) op->_error = std::move(error);
+          }
+
+          op->arrive();
+        }
+
+        void set_stopped() noexcept
+        {
+          op->_stopped.store(true, std::memory_order_relaxed);
+          op->arrive();
+        }
+      };
+
+      // Operation states cannot be moved, so they are constructed in place by recursion
+      template<size_t I, typename... Children>
+      struct children
+      {
+        children(operation*, const Children&...) {}
+
+        void start() noexcept {}
+      };
+
+      template<size_t I, typename Child, typename... Children>
+      struct children<I, Child, Children...> : children<I + 1, Children...>
+      {
+        internal::connect_result_t<Child, receiver<I>> op;
+
+        children(operation* parent, const Child& child, const Children&... others)
+          : children<I + 1, Children...>(parent, others...), op(child.connect(receiver<I> { parent }))
+        {}
+
+        void start() noexcept
+        {
+          op.start();
+          children<I + 1, Children...>::start();
+        }
+      };
+
+    public:
+      operation(const std::tuple<Senders...>& senders, Receiver receiver)
+        : _receiver(std::move(receiver)), _remaining(sizeof...(Senders) + 1), _stopped(false),
+          _children(std::apply([this](const auto&... senders)
+            { return children<0, Senders...>(this, senders...); },
+            senders))
+      {}
+
+      operation(const operation&) = delete;
+      operation(operation&&) = delete;
+      operation& operator=(const operation&) = delete;
+      operation& operator=(operation&&) = delete;
+
+      void start() noexcept
+      {
+        _children.start();
+
+        // The extra count makes sure that we do not complete while still starting children
+        arrive();
+      }
+
+    private:
+      void arrive() noexcept
+      {
+        if (_remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+        if (_error) _receiver.set_error(std::move(_error));
+        else if (_stopped.load(std::memory_order_relaxed))
+          _receiver.set_stopped();
+        else
+        {
+          std::apply([this](auto&&... values)
+            { _receiver.set_value(std::move(values)...); },
+            std::apply([](auto&... optionals)
+              { return std::tuple_cat(std::move(*optionals)...); },
+              _values));
+        }
+      }
+
+    private:
+      Receiver _receiver;
+      std::tuple<std::optional<internal::decayed_tuple_t<typename Senders::values>>...> _values;
+      std::atomic<size_t> _remaining;
+      std::atomic<bool> _stopped;
+      std::exception_ptr _error;
+      std::mutex _mutex;
+      children<0, Senders...> _children;
+    };
+
+    explicit when_all_sender(Senders... senders) : _senders(std::move(senders)...) {}
+
+    template<typename Receiver>
+    operation<Receiver> connect(Receiver receiver) const { return { _senders, std::move(receiver) }; }
+
+  private:
+    std::tuple<Senders...> _senders;
+  };
+
+  /**
+   * @brief Returns a sender that completes once all the senders have completed.
+   * 
+   * @tparam Senders Sender types
+   * @param senders Senders to wait for
+   * @return when_all_sender<Senders...> The sender
+   */
+  template<typename... Senders>
+  when_all_sender<Senders...> when_all(Senders... senders)
+  {
+    return when_all_sender<Senders...> { std::move(senders)... };
+  }
+
+  /**
+   * @brief Sender that executes a body on every chunk of a view.
+   * 
+   * Every chunk is scheduled individually on the scheduler, so the chunks are executed
+   * on its execution context. Used by for_each and transform_reduce.
+   * 
+   * A body must provide the values of the sender and the following member functions:
+   * - prepare(size_t chunks) : Called before any chunk is executed
+   * - run(View&, size_t chunk, size_t chunk_size) : Called for every chunk
+   * - complete(Receiver&) : Called once every chunk has been executed
+   * 
+   * @tparam Scheduler Scheduler type
+   * @tparam View View type
+   * @tparam Body Body type
+   */
+  template<typename Scheduler, typename View, typename Body>
+  class chunk_sender
+  {
+  public:
+    using values = typename Body::values;
+
+    template<typename Receiver>
+    class operation
+    {
+    private:
+      struct receiver
+      {
+        operation* op;
+        size_t chunk;
+
+        void set_value() noexcept
+        {
+          try
+          {
+            op->_body.run(op->_view, chunk, op->_chunk_size);
+          }
+          catch (...)
+          {
+            op->fail(std::current_exception());
+          }
+
+          op->arrive();
+        }
+
+        void set_error(std::exception_ptr error) noexcept
+        {
+          op->fail(std::move(error));
+          op->arrive();
+        }
+
+        void set_stopped() noexcept
+        {
+          op->_stopped.store(true, std::memory_order_relaxed);
+          op->arrive();
+        }
+      };
+
+      using chunk_operation = internal::connect_result_t<schedule_result_t<Scheduler>, receiver>;
+      using chunk_storage = std::aligned_storage_t<sizeof(chunk_operation), alignof(chunk_operation)>;
+
+    public:
+      operation(Scheduler* scheduler, View view, Body body, size_t chunk_size, Receiver receiver)
+        : _scheduler(scheduler), _view(view), _body(std::move(body)), _chunk_size(chunk_size), _receiver(std::move(receiver)),
+          _chunks(0), _remaining(0), _stopped(false)
+      {}
+
+      ~operation()
+      {
+        for (size_t i = 0; i < _chunks; i++)
+        {
+          std::launder(reinterpret_cast<chunk_operation*>(&_operations[i]))->~chunk_operation();
+        }
+      }
+
+      operation(const operation&) = delete;
+      operation(operation&&) = delete;
+      operation& operator=(const operation&) = delete;
+      operation& operator=(operation&&) = delete;
+
+      void start() noexcept
+      {
+        const size_t chunks = _view.chunks(_chunk_size);
+
+        _body.prepare(chunks);
+
+        _remaining.store(chunks + 1, std::memory_order_relaxed);
+        _operations.reset(new chunk_storage[chunks]);
+
+        for (; _chunks < chunks; _chunks++)
+        {
+          new (&_operations[_chunks]) chunk_operation(schedule(*_scheduler).connect(receiver { this, _chunks }));
+        }
+
+        for (size_t i = 0; i < chunks; i++)
+        {
+          std::launder(reinterpret_cast<chunk_operation*>(&_operations[i]))->start();
+        }
+
+        // The extra count makes sure that we do not complete while still starting chunks
+        arrive();
+      }
+
+    private:
+      void fail(std::exception_ptr error) noexcept
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error) _error = std::move(error);
+      }
+
+      void arrive() noexcept
+      {
+        if (_remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+        if (_error) _receiver.set_error(std::move(_error));
+        else if (_stopped.load(std::memory_order_relaxed))
+          _receiver.set_stopped();
+        else
+        {
+          try
+          {
+            _body.complete(_receiver);
+          }
+          catch (...)
+          {
+            _receiver.set_error(std::current_exception());
+          }
+        }
+      }
+
+    private:
+      Scheduler* _scheduler;
+      View _view;
+      Body _body;
+      size_t _chunk_size;
+      Receiver _receiver;
+
+      std::unique_ptr<chunk_storage[]> _operations;
+      size_t _chunks;
+
+      std::atomic<size_t> _remaining;
+      std::atomic<bool> _stopped;
+      std::exception_ptr _error;
+      std::mutex _mutex;
+    };
+
+    chunk_sender(Scheduler* scheduler, View view, Body body, size_t chunk_size)
+      : _scheduler(scheduler), _view(view), _body(std::move(body)), _chunk_size(chunk_size ? chunk_size : 1)
+    {}
+
+    template<typename Receiver>
+    operation<Receiver> connect(Receiver receiver) const
+    {
+      return { _scheduler, _view, _body, _chunk_size, std::move(receiver) };
+    }
+
+  private:
+    Scheduler* _scheduler;
+    View _view;
+    Body _body;
+    size_t _chunk_size;
+  };
+
+  namespace internal
+  {
+    template<typename Function>
+    struct for_each_body
+    {
+      using values = list<>;
+
+      Function function;
+
+      void prepare(size_t) {}
+
+      template<typename View>
+      void run(View& view, size_t chunk, size_t chunk_size) { view.for_each_chunk(chunk, chunk_size, function); }
+
+      template<typename Receiver>
+      void complete(Receiver& receiver) { receiver.set_value(); }
+    };
+
+    template<typename Type, typename Reduce, typename Transform>
+    struct transform_reduce_body
+    {
+      using values = list<Type>;
+
+      Type init;
+      Reduce reduce;
+      Transform transform;
+
+      std::vector<std::optional<Type>> partials;
+
+      void prepare(size_t chunks) { partials.assign(chunks, std::nullopt); }
+
+      template<typename View>
+      void run(View& view, size_t chunk, size_t chunk_size)
+      {
+        auto& partial = partials[chunk];
+
+        view.for_each_chunk(chunk, chunk_size, [this, &partial](auto&&... arguments)
+          {
+            if (partial) partial = reduce(std::move(*partial), transform(arguments...));
+            else
+              partial.emplace(transform(arguments...));
+          });
+      }
+
+      template<typename Receiver>
+      void complete(Receiver& receiver)
+      {
+        if (partials.empty())
+        {
+          receiver.set_value(std::move(init));
+          return;
+        }
+
+        std::vector<Type> values;
+        values.reserve(partials.size());
+
+        for (auto& partial : partials) values.push_back(std::move(*partial));
+
+        // Partials are always combined with the same tree, so the result does not depend on scheduling
+        receiver.set_value(reduce(std::move(init), tree_reduce(values, reduce)));
+      }
+    };
+  } // namespace internal
+
+  /**
+   * @brief Returns a sender that iterates over every entity of the view.
+   * 
+   * The view is split into chunks when the sender is started, and every chunk is scheduled
+   * individually on the scheduler.
+   * 
+   * @warning The registry must not be structurally modified until the sender completes.
+   * 
+   * @tparam Scheduler Scheduler type
+   * @tparam View View type
+   * @tparam Function Function type
+   * @param scheduler The scheduler to execute chunks on
+   * @param view The view to iterate over
+   * @param function The function to invoke for every entity
+   * @param chunk_size Maximum amount of entities per chunk
+   * @return auto The sender
+   */
+  template<typename Scheduler, typename View, typename Function>
+  auto for_each(Scheduler& scheduler, View view, Function function, size_t chunk_size = loop_state::default_chunk_size)
+  {
+    using body = internal::for_each_body<Function>;
+
+    return chunk_sender<Scheduler, View, body> { &scheduler, view, body { std::move(function) }, chunk_size };
+  }
+
+  /**
+   * @brief Returns a sender that transforms every entity of the view and reduces the results.
+   * 
+   * Every chunk is reduced in parallel, then the partial results are reduced in chunk order
+   * starting from init. The sender completes with the result.
+   * 
+   * @warning The registry must not be structurally modified until the sender completes.
+   * 
+   * @tparam Scheduler Scheduler type
+   * @tparam View View type
+   * @tparam Type Result type
+   * @tparam Reduce Reduce function type
+   * @tparam Transform Transform function type
+   * @param scheduler The scheduler to execute chunks on
+   * @param view The view to iterate over
+   * @param init Initial value of the reduction
+   * @param reduce Function that combines two results
+   * @param transform Function that returns a result for an entity and its components
+   * @param chunk_size Maximum amount of entities per chunk
+   * @return auto The sender
+   */
+  template<typename Scheduler, typename View, typename Type, typename Reduce, typename Transform>
+  auto transform_reduce(Scheduler& scheduler, View view, Type init, Reduce reduce, Transform transform,
+    size_t chunk_size = loop_state::default_chunk_size)
+  {
+    using body = internal::transform_reduce_body<Type, Reduce, Transform>;
+
+    return chunk_sender<Scheduler, View, body> { &scheduler, view, body { std::move(init), std::move(reduce), std::move(transform), {} }, chunk_size };
+  }
+
+  namespace internal
+  {
+    template<typename Result>
+    struct sync_wait_state
+    {
+      std::mutex mutex;
+      std::condition_variable condition;
+      bool done = false;
+      std::optional<Result> result;
+      std::exception_ptr error;
+
+      void finish()
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        condition.notify_one();
+      }
+    };
+
+    template<typename Result>
+    struct sync_wait_receiver
+    {
+      sync_wait_state<Result>* state;
+
+      template<typename... Values>
+      void set_value(Values&&... values) noexcept
+      {
+        state->result.emplace(std::forward<Values>(values)...);
+        state->finish();
+      }
+
+      void set_error(std::exception_ptr error) noexcept
+      {
+        state->error = std::move(error);
+        state->finish();
+      }
+
+      void set_stopped() noexcept { state->finish(); }
+    };
+  } // namespace internal
+
+  /**
+   * @brief Starts the sender and blocks the current thread until it completes.
+   * 
+   * @throw Rethrows the error if the sender completed with an error
+   * 
+   * @tparam Sender Sender type
+   * @param sender The sender to wait for
+   * @return auto The values of the sender as a tuple, or nothing if the sender was stopped
+   */
+  template<typename Sender>
+  auto sync_wait(const Sender& sender)
+  {
+    using result_type = internal::decayed_tuple_t<typename Sender::values>;
+
+    internal::sync_wait_state<result_type> state;
+
+    auto operation = sender.connect(internal::sync_wait_receiver<result_type> { &state });
+    operation.start();
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.condition.wait(lock, [&state]()
+      { return state.done; });
+
+    if (state.error) std::rethrow_exception(state.error);
+
+    return std::move(state.result);
+  }
+} // namespace execution
+} // namespace xecs
+
+#endif
@@ -0,0 +1,296 @@
+#ifndef XECS_INDEX_HPP
+#define XECS_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace xecs
+{
+/**
+ * @brief Key of a component looked up by a secondary hash index.
+ * 
+ * Components have no index by default. To index a component, specialize this struct with
+ * a key type and a key function, for example:
+ * 
+ * template<>
+ * struct xecs::index_key<Player>
+ * {
+ *   using type = uint64_t;
+ *   static type key(const Player& player) { return player.id; }
+ * };
+ * 
+ * The key must be default constructible, equality comparable and hashable with std::hash. Many
+ * entities can have the same key, a lookup then finds any one of them.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component>
+struct index_key
+{};
+
+/**
+ * @brief Whether or not a component has a secondary hash index.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component, typename = void>
+struct has_index_key : std::false_type
+{};
+
+template<typename Component>
+struct has_index_key<Component, std::void_t<typename index_key<Component>::type>> : std::true_type
+{};
+
+template<typename Component>
+constexpr auto has_index_key_v = has_index_key<Component>::value;
+
+template<typename Component>
+using index_key_t = typename index_key<Component>::type;
+
+/**
+ * @brief Open addressing hash map from keys to entities.
+ * 
+ * Slots are stored in a single flat array and collisions are resolved with linear probing, so a
+ * lookup usually reads a single cache line. Erasing shifts the following slots back instead of
+ * leaving tombstones, lookups never get slower over time.
+ * 
+ * A key can be mapped to many entities, every mapping has its own slot. Erasing the mapping of one
+ * entity keeps the others, so the key is still found while any entity holds it.
+ * 
+ * @tparam Key Key type
+ * @tparam Entity unsigned int entity identifier
+ */
+template<typename Key, typename Entity>
+class hash_index final
+{
+public:
+  using key_type = Key;
+  using entity_type = Entity;
+  using size_type = size_t;
+
+  /**
+   * @brief Entity of empty slots, returned when a key is not found.
+   */
+  static constexpr entity_type null = std::numeric_limits<entity_type>::max();
+
+private:
+  struct slot
+  {
+    key_type key;
+    entity_type entity;
+  };
+
+public:
+  /**
+   * @brief Construct a new hash index object
+   */
+  hash_index() : _slots(NULL), _mask(0), _size(0) {}
+
+  /**
+   * @brief Destroy the hash index object
+   */
+  ~hash_index()
+  {
+    clear();
+
+    free(_slots);
+  }
+
+  hash_index(const hash_index&) = delete;
+  hash_index(hash_index&&) = delete;
+  hash_index& operator=(const hash_index&) = delete;
+  hash_index& operator=(hash_index&&) = delete;
+
+  /**
+   * @brief Maps a key to an entity, does nothing if the key is already mapped to that entity.
+   * 
+   * @param key Key to map
+   * @param entity Entity of the key
+   */
+  void insert(const key_type& key, const entity_type entity)
+  {
+    // Grow at 75% load
+    if ((_size + 1) * 4 > capacity() * 3) rehash(capacity() ? capacity() * 2 : 16);
+
+    size_type position = hash(key) & _mask;
+
+    while (_slots[position].entity != null)
+    {
+      if (_slots[position].entity == entity && _slots[position].key == key) return;
+
+      position = (position + 1) & _mask;
+    }
+
+    new (&_slots[position].key) key_type(key);
+    _slots[position].entity = entity;
+
+    _size++;
+  }
+
+  /**
+   * @brief Removes the mapping of a key to the specified entity, other entities of the key keep theirs.
+   * 
+   * @param key Key to remove
+   * @param entity Entity the key must be mapped to
+   */
+  void erase(const key_type& key, const entity_type entity)
+  {
+    if (_size == 0) return;
+
+    size_type position = hash(key) & _mask;
+
+    while (_slots[position].entity != null)
+    {
+      if (_slots[position].entity == entity && _slots[position].key == key)
+      {
+        remove(position);
+        return;
+      }
+
+      position = (position + 1) & _mask;
+    }
+  }
+
+  /**
+   * @brief Returns an entity mapped to a key.
+   * 
+   * @param key Key to find
+   * @return entity_type Any entity of the key, null if the key is not mapped
+   */
+  [[nodiscard]] entity_type find(const key_type& key) const
+  {
+    if (_size == 0) return null;
+
+    size_type position = hash(key) & _mask;
+
+    while (_slots[position].entity != null)
+    {
+      if (_slots[position].key == key) return _slots[position].entity;
+
+      position = (position + 1) & _mask;
+    }
+
+    return null;
+  }
+
+  /**
+   * @brief Removes every key.
+   */
+  void clear()
+  {
+    for (size_type i = 0; i < capacity(); i++)
+    {
+      if (_slots[i].entity != null)
+      {
+        _slots[i].key.~key_type();
+        _slots[i].entity = null;
+      }
+    }
+
+    _size = 0;
+  }
+
+  /**
+   * @brief Returns the amount of mappings, a key mapped to many entities counts once per entity.
+   * 
+   * @return size_type Amount of mappings
+   */
+  [[nodiscard]] size_type size() const { return _size; }
+
+  /**
+   * @brief Returns the amount of slots.
+   * 
+   * @return size_type Amount of slots, always a power of two (or zero)
+   */
+  [[nodiscard]] size_type capacity() const { return _slots ? _mask + 1 : 0; }
+
+private:
+  /**
+   * @brief Hashes a key, then mixes the bits so that identity hashes of sequential keys are spread.
+   * 
+   * @param key Key to hash
+   * @return size_type Hash of the key
+   */
+  static size_type hash(const key_type& key)
+  {
+    const uint64_t value = static_cast<uint64_t>(std::hash<key_type> {}(key)) * 0x9E3779B97F4A7C15ull;
+
+    return static_cast<size_type>(value ^ (value >> 32));
+  }
+
+  /**
+   * @brief Removes the slot at the specified position and shifts the following slots back.
+   * 
+   * @param position Position of the slot to remove
+   */
+  void remove(size_type position)
+  {
+    _slots[position].key.~key_type();
+    _slots[position].entity = null;
+
+    _size--;
+
+    size_type next = (position + 1) & _mask;
+
+    while (_slots[next].entity != null)
+    {
+      const size_type ideal = hash(_slots[next].key) & _mask;
+
+      // Move the slot back if the empty position is between its ideal position and its position
+      if (((next - ideal) & _mask) >= ((next - position) & _mask))
+      {
+        new (&_slots[position].key) key_type(std::move(_slots[next].key));
+        _slots[position].entity = _slots[next].entity;
+
+        _slots[next].key.~key_type();
+        _slots[next].entity = null;
+
+        position = next;
+      }
+
+      next = (next + 1) & _mask;
+    }
+  }
+
+  /**
+   * @brief Moves every key to a new array of slots.
+   * 
+   * @param capacity New amount of slots, must be a power of two
+   */
+  void rehash(const size_type capacity)
+  {
+    slot* old_slots = _slots;
+    const size_type old_capacity = this->capacity();
+
+    _slots = static_cast<slot*>(std::malloc(capacity * sizeof(slot)));
+    _mask = capacity - 1;
+    _size = 0;
+
+    for (size_type i = 0; i < capacity; i++) _slots[i].entity = null;
+
+    for (size_type i = 0; i < old_capacity; i++)
+    {
+      if (old_slots[i].entity != null)
+      {
+        insert(old_slots[i].key, old_slots[i].entity);
+
+        old_slots[i].key.~key_type();
+      }
+    }
+
+    free(old_slots);
+  }
+
+private:
+  slot* _slots;
+  size_type _mask;
+  size_type _size;
+};
+} // namespace xecs
+
+#endif
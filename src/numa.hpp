@@ -0,0 +1,207 @@
+#ifndef XECS_NUMA_HPP
+#define XECS_NUMA_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace xecs
+{
+namespace internal
+{
+  /**
+   * @brief Parses a linux cpu or node list (for example "0-3,8,10-11").
+   * 
+   * @param text List to parse
+   * @return std::vector<size_t> Every index in the list, in order
+   */
+  inline std::vector<size_t> parse_list(const std::string& text)
+  {
+    std::vector<size_t> indices;
+
+    size_t position = 0;
+
+    while (position < text.size())
+    {
+      size_t next = text.find(',', position);
+      if (next == std::string::npos) next = text.size();
+
+      const std::string part = text.substr(position, next - position);
+
+      if (!part.empty() && part[0] >= '0' && part[0] <= '9')
+      {
+        const size_t dash = part.find('-');
+
+        const size_t first = std::strtoul(part.c_str(), NULL, 10);
+        const size_t last = dash == std::string::npos ? first : std::strtoul(part.c_str() + dash + 1, NULL, 10);
+
+        for (size_t i = first; i <= last; i++) indices.push_back(i);
+      }
+
+      position = next + 1;
+    }
+
+    return indices;
+  }
+
+  /**
+   * @brief Reads the first line of a file.
+   * 
+   * @param path Path of the file
+   * @return std::string First line, empty if the file does not exist
+   */
+  inline std::string read_line(const std::string& path)
+  {
+    std::ifstream file(path);
+    std::string line;
+
+    if (file) std::getline(file, line);
+
+    return line;
+  }
+} // namespace internal
+
+/**
+ * @brief NUMA topology of the machine.
+ * 
+ * Lists the cpus of every node. On machines (or systems) without NUMA information, there is
+ * a single node that contains every cpu.
+ */
+class numa_topology final
+{
+public:
+  using size_type = size_t;
+
+  /**
+   * @brief Construct a new numa topology object by detecting the topology of the machine.
+   */
+  numa_topology()
+  {
+#if defined(__linux__)
+    for (const auto node : internal::parse_list(internal::read_line("/sys/devices/system/node/online")))
+    {
+      const auto cpus = internal::parse_list(internal::read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+
+      for (const auto cpu : cpus) add(cpu, node);
+
+      if (!cpus.empty()) _nodes = std::max(_nodes, node + 1);
+    }
+#endif
+
+    if (_cpus.empty())
+    {
+      const size_type cpus = std::max(std::thread::hardware_concurrency(), 1u);
+
+      for (size_type cpu = 0; cpu < cpus; cpu++) add(cpu, 0);
+
+      _nodes = 1;
+    }
+  }
+
+  /**
+   * @brief Returns the topology of the machine, detected once.
+   * 
+   * @return const numa_topology& Topology of the machine
+   */
+  static const numa_topology& system()
+  {
+    static const numa_topology topology;
+    return topology;
+  }
+
+  /**
+   * @brief Returns the amount of nodes.
+   * 
+   * @return size_type Amount of nodes (atleast one)
+   */
+  [[nodiscard]] size_type nodes() const { return _nodes; }
+
+  /**
+   * @brief Returns every cpu, grouped by node.
+   * 
+   * @return const std::vector<size_type>& Cpus grouped by node
+   */
+  [[nodiscard]] const std::vector<size_type>& cpus() const { return _cpus; }
+
+  /**
+   * @brief Returns the node of a cpu.
+   * 
+   * @param cpu The cpu
+   * @return size_type Node of the cpu, zero if the cpu is unknown
+   */
+  [[nodiscard]] size_type node(const size_type cpu) const
+  {
+    return cpu < _cpu_nodes.size() ? _cpu_nodes[cpu] : 0;
+  }
+
+private:
+  void add(const size_type cpu, const size_type node)
+  {
+    _cpus.push_back(cpu);
+
+    if (cpu >= _cpu_nodes.size()) _cpu_nodes.resize(cpu + 1, 0);
+
+    _cpu_nodes[cpu] = node;
+  }
+
+private:
+  std::vector<size_type> _cpus;
+  std::vector<size_type> _cpu_nodes;
+  size_type _nodes = 0;
+};
+
+/**
+ * @brief Binds the pages of a memory range to a node.
+ * 
+ * Pages that are already allocated are moved to the node, pages that are allocated later are
+ * allocated on the node. Only pages completely inside the range are bound, so ranges of
+ * neighbouring data are never affected.
+ * 
+ * Does nothing on a single node machine.
+ * 
+ * @param ptr Beginning of the range
+ * @param bytes Size of the range in bytes
+ * @param node Node to bind to
+ * @return true If the pages are on the node (always on a single node machine), false otherwise
+ */
+inline bool numa_bind(const void* ptr, const size_t bytes, const size_t node)
+{
+  if (numa_topology::system().nodes() <= 1) return true;
+
+#if defined(__linux__) && defined(SYS_mbind)
+  static const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+  const uintptr_t first = (reinterpret_cast<uintptr_t>(ptr) + page - 1) & ~(page - 1);
+  const uintptr_t last = (reinterpret_cast<uintptr_t>(ptr) + bytes) & ~(page - 1);
+
+  if (first >= last) return true;
+
+  constexpr size_t bits = sizeof(unsigned long) * 8;
+
+  std::vector<unsigned long> mask(node / bits + 1, 0);
+  mask[node / bits] |= 1ul << (node % bits);
+
+  constexpr int bind = 2; // MPOL_BIND
+  constexpr unsigned move = 1u << 1; // MPOL_MF_MOVE
+
+  return syscall(SYS_mbind, first, last - first, bind, mask.data(), mask.size() * bits + 1, move) == 0;
+#else
+  (void)ptr; // Suppress unused warning
+  (void)bytes;
+  (void)node;
+
+  return false;
+#endif
+}
+} // namespace xecs
+
+#endif
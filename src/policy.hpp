@@ -0,0 +1,197 @@
+#ifndef XECS_POLICY_HPP
+#define XECS_POLICY_HPP
+
+#include "archetype.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
+namespace xecs
+{
+template<typename Entity, typename Index = Entity>
+class sparse_array;
+
+template<typename Entity, typename Index = Entity>
+class concurrent_sparse_array;
+
+template<typename Entity, size_t Bytes>
+class packed_sparse_array;
+
+template<typename Entity, size_t MaxEntities>
+class fixed_sparse_array;
+
+/**
+ * @brief Mutex that does nothing.
+ * 
+ * Used by single-threaded policies, locking a null_mutex is optimized away completely.
+ */
+struct null_mutex
+{
+  void lock() {}
+  void unlock() {}
+  bool try_lock() { return true; }
+};
+
+/**
+ * @brief Compile-time configuration of a registry and its storages.
+ * 
+ * The default policy is single-threaded and has no overhead. Custom policies should
+ * inherit from one of the provided policies and only override what they need.
+ * 
+ * A policy contains:
+ * - mutex_type : Mutex used to lock the entity_manager and every storage
+ * - sparse_type<Entity> : Sparse array shared by the storages
+ * - single_allocation : Whether every storage keeps all its dense arrays in a single allocation
+ * - shared_pages : Whether the dense arrays of every storage are shared page by page with forks (see shared_pages_policy)
+ * - sparse_components : Components stored in their own sparse set instead of archetypes (see sparse_storage)
+ * - capacity<Archetype> : Compile-time capacity of the storage of an archetype, zero if it grows (see fixed_policy)
+ * - max_entities : Compile-time capacity of the entity_manager, zero if it grows (see fixed_policy)
+ */
+struct default_policy
+{
+  using mutex_type = null_mutex;
+
+  template<typename Entity>
+  using sparse_type = sparse_array<Entity>;
+
+  static constexpr bool single_allocation = false;
+
+  static constexpr bool shared_pages = false;
+
+  using sparse_components = list<>;
+
+  template<typename Archetype>
+  static constexpr size_t capacity = 0;
+
+  static constexpr size_t max_entities = 0;
+};
+
+/**
+ * @brief Thread-safe registry policy.
+ * 
+ * Every storage has its own lock, so threads that create or destroy entities of different
+ * archetypes never contend for the same storage. The sparse_array is paged and grows without
+ * moving existing pages, so it can grow while other threads are using it.
+ * 
+ * @warning Iteration is not synchronized, entities must not be created or destroyed in
+ * the storages being iterated.
+ */
+struct concurrent_policy : default_policy
+{
+  using mutex_type = std::mutex;
+
+  template<typename Entity>
+  using sparse_type = concurrent_sparse_array<Entity>;
+};
+
+/**
+ * @brief Policy for registries whose storages never contain more than a maximum amount of entities.
+ * 
+ * The sparse array only stores dense indexes, so its index type is chosen from the maximum instead
+ * of being the entity type: 8, 16, 24 (packed) or 32 bits. With 64 bit entities and atmost a few
+ * million entities per archetype, this makes the sparse array (the largest allocation of a registry)
+ * more than twice as small.
+ * 
+ * @warning Inserting more entities than the maximum in a storage is undefined behaviour (asserted).
+ * 
+ * @tparam MaxEntities Maximum amount of entities in a single storage
+ */
+template<size_t MaxEntities>
+struct bounded_policy : default_policy
+{
+  template<typename Entity>
+  using sparse_type = std::conditional_t<(MaxEntities <= (size_t { 1 } << 8)), sparse_array<Entity, uint8_t>,
+    std::conditional_t<(MaxEntities <= (size_t { 1 } << 16)), sparse_array<Entity, uint16_t>,
+      std::conditional_t<(MaxEntities <= (size_t { 1 } << 24)), packed_sparse_array<Entity, 3>,
+        std::conditional_t<(MaxEntities <= (size_t { 1 } << 31) * 2), sparse_array<Entity, uint32_t>,
+          sparse_array<Entity>>>>>;
+};
+
+/**
+ * @brief Policy that keeps the dense arrays of every storage in a single allocation.
+ * 
+ * The dense entity array and every component column of a storage are parts of one allocation, so a
+ * storage makes one allocation (instead of one per array) every time it grows. Columns are still
+ * stored one after the other (SoA), each starting on its own cache line. With many archetypes, this
+ * greatly reduces the amount of allocations and the pressure on the TLB.
+ * 
+ * Growing moves every column to the new allocation instead of reallocating the columns in place.
+ */
+struct single_allocation_policy : default_policy
+{
+  static constexpr bool single_allocation = true;
+};
+
+/**
+ * @brief Policy for registries that are forked many times, whose storages share their pages with forks.
+ * 
+ * The large dense arrays of every storage of trivially copyable components are memory that can be shared
+ * page by page (see cow_memory), so forking a registry copies nothing and only the pages that are written
+ * are copied. Without this policy, storages are copied by every fork.
+ * 
+ * Growing moves every column to new memory instead of reallocating the columns in place, and every array
+ * has a header page. The sparse array is shared by forks with any policy.
+ */
+struct shared_pages_policy : default_policy
+{
+  static constexpr bool shared_pages = true;
+};
+
+/**
+ * @brief Compile-time capacity of the storage of an archetype, used by fixed_policy.
+ * 
+ * @tparam Archetype Archetype of the storage
+ * @tparam Capacity Maximum amount of entities of the archetype
+ */
+template<typename Archetype, size_t Capacity>
+struct capacity_of
+{};
+
+namespace internal
+{
+  /**
+   * @brief Capacity of an archetype in a capacity_of, zero if the capacity is for another archetype.
+   */
+  template<typename Archetype, typename Capacity>
+  struct capacity_in : std::integral_constant<size_t, 0>
+  {};
+
+  template<typename Archetype, size_t Capacity>
+  struct capacity_in<Archetype, capacity_of<Archetype, Capacity>> : std::integral_constant<size_t, Capacity>
+  {};
+} // namespace internal
+
+/**
+ * @brief Policy for hard real-time registries that never allocate memory.
+ * 
+ * Every capacity is known at compile-time: the dense arrays of every storage, the sparse array and
+ * the recycled identifiers of the entity_manager are inline in the registry, which can be placed in
+ * static memory. Creating, destroying and swapping entities then never allocates and has a bounded
+ * latency. Storages of archetypes without a capacity_of can contain every entity.
+ * 
+ * Snapshots, epoch_managers, zone maps, indexes, buffers and sparse components still allocate.
+ * 
+ * @warning Creating more entities than the maximum, or more entities of an archetype than its
+ * capacity, is undefined behaviour (asserted).
+ * 
+ * @tparam MaxEntities Maximum amount of entity identifiers
+ * @tparam Capacities capacity_of of every archetype with a smaller capacity
+ */
+template<size_t MaxEntities, typename... Capacities>
+struct fixed_policy : default_policy
+{
+  template<typename Entity>
+  using sparse_type = fixed_sparse_array<Entity, MaxEntities>;
+
+  template<typename Archetype>
+  static constexpr size_t capacity = (size_t { 0 } + ... + internal::capacity_in<Archetype, Capacities>::value) != 0
+    ? (size_t { 0 } + ... + internal::capacity_in<Archetype, Capacities>::value)
+    : MaxEntities;
+
+  static constexpr size_t max_entities = MaxEntities;
+};
+} // namespace xecs
+
+#endif
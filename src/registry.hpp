@@ -3,21 +3,116 @@
 
 #include "archetype.hpp"
 #include "entity_manager.hpp"
+#include "epoch.hpp"
+#include "policy.hpp"
+#include "scheduler.hpp"
+#include "sparse_storage.hpp"
 #include "storage.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace xecs
 {
+/**
+ * @brief Memory needed by a registry, used to reserve all of it when the registry is constructed.
+ * 
+ * A profile is exported from a registry once it reached its usual size (for example at the end
+ * of a session), saved, and given to the registry the next time it is constructed. This way storages
+ * never go through their growth, every array is allocated once at its final size.
+ */
+struct capacity_profile
+{
+  std::vector<size_t> storages; ///< High-water mark of the capacity of every storage, in archetype order
+  size_t sparse = 0; ///< Capacity of the sparse array
+  size_t manager = 0; ///< Capacity of the heap memory stack of the entity_manager
+};
+
+/**
+ * @brief Writes a capacity profile as text.
+ * 
+ * @param stream Stream to write to
+ * @param profile Profile to write
+ * @return std::ostream& The stream
+ */
+inline std::ostream& operator<<(std::ostream& stream, const capacity_profile& profile)
+{
+  stream << profile.storages.size();
+
+  for (const auto capacity : profile.storages) stream << ' ' << capacity;
+
+  return stream << ' ' << profile.sparse << ' ' << profile.manager;
+}
+
+/**
+ * @brief Reads a capacity profile written with operator<<.
+ * 
+ * @param stream Stream to read from
+ * @param profile Profile to read into
+ * @return std::istream& The stream
+ */
+inline std::istream& operator>>(std::istream& stream, capacity_profile& profile)
+{
+  size_t count = 0;
+
+  if (!(stream >> count)) return stream;
+
+  profile.storages.resize(count);
+
+  for (auto& capacity : profile.storages) stream >> capacity;
+
+  return stream >> profile.sparse >> profile.manager;
+}
+
+/**
+ * @brief Components of a template entity, instantiated many times by a registry.
+ * 
+ * A prefab contains a value for every component of an archetype, for example
+ * prefab squad { Position { 0, 0 }, Health { 100 } }. See registry::instantiate.
+ * 
+ * @tparam Components The exact component types of one of the registry archetypes
+ */
+template<typename... Components>
+class prefab
+{
+public:
+  /**
+   * @brief Construct a new prefab object
+   * 
+   * @param components The components of every instance
+   */
+  prefab(const Components&... components) : _components(components...) {}
+
+  /**
+   * @brief Returns the components of every instance.
+   * 
+   * @return const std::tuple<Components...>& Components of the prefab
+   */
+  [[nodiscard]] const std::tuple<Components...>& components() const { return _components; }
+
+  /*! @copydoc components */
+  [[nodiscard]] std::tuple<Components...>& components() { return _components; }
+
+private:
+  std::tuple<Components...> _components;
+};
+
 /**
  * @brief Entity-component system core contaner.
  * 
@@ -34,28 +129,47 @@ namespace xecs
  * This registry leverages its knowledge of all achetypes at compile time, to reduce 
  * the complexity of many operations, who often times can be reduced to nearly no overhead.
  * 
+ * By default the registry is single-threaded. With the concurrent_policy, entities can be created,
+ * destroyed and swapped from many threads at the same time. Every storage has its own lock, so threads
+ * working on different archetypes never wait on each other. The only shared point is the entity_manager
+ * which is locked for a very short time when generating or releasing identifiers.
+ * 
  * @tparam Entity The unsigned integer entity type
  * @tparam ArchetypeList The list of all archetypes to be used by this registry
+ * @tparam Policy Compile-time configuration of the registry (see default_policy)
  */
-template<typename Entity, typename ArchetypeList>
+template<typename Entity, typename ArchetypeList, typename Policy = default_policy>
 class registry;
 
-template<typename Entity, typename... Archetypes>
-class registry<Entity, list<Archetypes...>> : verify_archetype_list<list<Archetypes...>>
+template<typename Entity, typename... Archetypes, typename Policy>
+class registry<Entity, list<Archetypes...>, Policy> : verify_archetype_list<list<Archetypes...>>
 {
 public:
   using entity_type = Entity;
   using archetype_list_type = list<Archetypes...>;
-  using registry_type = registry<entity_type, archetype_list_type>;
-  using pool_type = std::tuple<storage<entity_type, Archetypes>...>;
-  using shared_type = sparse_array<entity_type>;
-  using manager_type = entity_manager<entity_type>;
+  using policy_type = Policy;
+  using registry_type = registry<entity_type, archetype_list_type, policy_type>;
+  using pool_type = std::tuple<storage<entity_type, Archetypes, policy_type>...>;
+  using shared_type = typename policy_type::template sparse_type<entity_type>;
+  using manager_type = entity_manager<entity_type, policy_type::max_entities>;
+  using mutex_type = typename policy_type::mutex_type;
+  using sparse_list_type = typename policy_type::sparse_components;
 
   static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
     "Entity type must be an unsigned integer");
 
   static_assert(sizeof...(Archetypes) > 0, "Registry must contain atleast one archetype");
 
+  /**
+   * @brief Identifier that is never given to an entity, used for entities that do not exist.
+   */
+  static constexpr entity_type tombstone = std::numeric_limits<entity_type>::max();
+
+  /**
+   * @brief Maximum amount of entities sorted in a single slice of maintenance.
+   */
+  static constexpr size_t maintenance_slice = 4096;
+
 private:
   /**
    * @brief A registry view.
@@ -73,15 +187,71 @@ private:
   template<typename... Components>
   class basic_view;
 
+  /**
+   * @brief Creates many entities of an archetype from many threads at once.
+   * 
+   * @tparam Archetype The archetype of the created entities
+   */
+  template<typename Archetype>
+  class basic_appender;
+
+  /**
+   * @brief A read-only, point-in-time view of the registry.
+   * 
+   * @tparam Components The components to be included in the view.
+   */
+  template<typename... Components>
+  class basic_snapshot_view;
+
+  /**
+   * @brief A persistent set of the entities in a view that satisfy a predicate.
+   * 
+   * @tparam Components The components to be included in the set.
+   */
+  template<typename... Components>
+  class basic_entity_set;
+
+  /**
+   * @brief Sparse storages of the sparse components of the policy.
+   * 
+   * @tparam List List of sparse components
+   */
+  template<typename List>
+  struct sparse_pools;
+
+  template<typename... SparseComponents>
+  struct sparse_pools<list<SparseComponents...>>
+  {
+    using type = std::tuple<sparse_storage<entity_type, SparseComponents, policy_type>...>;
+  };
+
 public:
   /**
    * @brief Construct a new registry object
    */
   registry()
+    : _maintained_archetype(0), _maintained_offset(0)
   {
     setup_shared_memory();
   }
 
+  /**
+   * @brief Construct a new registry object and reserves the memory of a capacity profile
+   * 
+   * Storages of archetypes that are not in the profile (the archetype list changed) are not reserved.
+   * 
+   * @param profile Profile exported from a previous registry with the same archetypes
+   */
+  explicit registry(const capacity_profile& profile)
+    : registry()
+  {
+    reserve_storages(profile);
+
+    if (profile.sparse) _shared.assure(static_cast<entity_type>(profile.sparse - 1));
+
+    _manager.reserve(profile.manager);
+  }
+
   /**
    * @brief Destroy the registry object
    */
@@ -114,13 +284,109 @@ public:
     static_assert(size_v<current> == sizeof...(Components),
       "Registry does not contain suitable archetype for provided components");
 
-    const entity_type entity = _manager.generate();
+    entity_type entity;
+
+    {
+      std::lock_guard<mutex_type> lock(_manager_mutex);
+      entity = _manager.generate();
+    }
+
+    auto lock = this->lock<current>();
 
     access<current>().insert(entity, components...);
 
     return entity;
   }
 
+  /**
+   * @brief Creates many entities that are copies of a prefab.
+   * 
+   * The archetype is resolved at compile-time, the storage grows once and every column is filled with
+   * the value of its component at once (see storage::broadcast). Much faster than creating every entity.
+   * 
+   * The identifiers are a contiguous block, recycled identifiers are not used.
+   * 
+   * @tparam Components The exact component types of one of the registry archetypes
+   * @param prefab The prefab to instantiate
+   * @param count Amount of entities to create
+   * @return entity_type The first created entity, the created entities are [first, first + count)
+   */
+  template<typename... Components>
+  entity_type instantiate(const prefab<Components...>& prefab, const size_t count)
+  {
+    using current = find_for_t<list<Archetypes...>, Components...>;
+
+    static_assert(size_v<current> == sizeof...(Components),
+      "Registry does not contain suitable archetype for provided components");
+
+    entity_type first;
+
+    {
+      std::lock_guard<mutex_type> lock(_manager_mutex);
+      first = _manager.generate(count);
+    }
+
+    auto lock = this->lock<current>();
+
+    std::apply([&](const Components&... components)
+      { access<current>().broadcast(first, count, components...); },
+      prefab.components());
+
+    return first;
+  }
+
+  /**
+   * @brief Creates many entities that are copies of an existing entity.
+   * 
+   * Same as instantiate, with the archetype and components of the entity. The archetype of the
+   * entity is searched once for all the copies, specifying components reduces the search like destroy.
+   * 
+   * @warning Attempting to clone an entity that does not exist or does not contain all specified
+   * components will result in undefined behaviour.
+   * 
+   * @tparam Components Component types that you know this entity's archetype has
+   * @param entity The entity to copy
+   * @param count Amount of entities to create
+   * @return entity_type The first created entity, the created entities are [first, first + count)
+   */
+  template<typename... Components>
+  entity_type clone(const entity_type entity, const size_t count)
+  {
+    static_assert(size_v<prune_for_t<list<Archetypes...>, Components...>> > 0,
+      "Registry does not contain suitable archetype for provided components");
+
+    return view<Components...>().clone(entity, count);
+  }
+
+  /**
+   * @brief Reserves many entities of an archetype that will be created concurrently.
+   * 
+   * This is the synchronization point of concurrent creation. The identifiers of the entities are
+   * generated and the storage is grown to fit them all at once. Any amount of threads can then create
+   * entities with the returned appender, without any locks. This is great when a lot of entities
+   * of the same archetype are created in parallel (for example, particles).
+   * 
+   * The created entities are added to the storage once the appender is destroyed. Reserved identifiers
+   * that were not used are released.
+   * 
+   * @warning The storage of the archetype must not be used while the appender exists, with a
+   * concurrent policy it stays locked.
+   * 
+   * @tparam Components The exact component types of one of the registry archetypes
+   * @param count The amount of entities to reserve
+   * @return auto Appender to create the entities with
+   */
+  template<typename... Components>
+  auto append(const size_t count)
+  {
+    using current = find_for_t<list<Archetypes...>, Components...>;
+
+    static_assert(size_v<current> == sizeof...(Components),
+      "Registry does not contain suitable archetype for provided components");
+
+    return basic_appender<current> { this, count };
+  }
+
   /**
    * @brief Destroys the specified entity.
    * 
@@ -151,7 +417,11 @@ public:
    */
   void destroy_all()
   {
-    ((access<Archetypes>().clear()), ...);
+    ((lock<Archetypes>(), access<Archetypes>().clear()), ...);
+
+    r_sparse([](auto& sparse) { sparse.clear(); });
+
+    std::lock_guard<mutex_type> lock(_manager_mutex);
 
     _manager.release_all();
   }
@@ -166,128 +436,455 @@ public:
    * to make sure your ressources are being use optimally.
    * 
    * @note You should consider using this if your application is running for a long time.
+   * 
+   * Identifiers are never renumbered here, see defragment for that.
    */
   void optimize()
   {
-    ((access<Archetypes>().shrink_to_fit()), ...);
+    ((lock<Archetypes>(), access<Archetypes>().shrink_to_fit()), ...);
+
+    std::lock_guard<mutex_type> lock(_manager_mutex);
 
     _manager.swap();
     _manager.shrink_to_fit();
   }
 
   /**
-   * @brief Iterates over every entity that has the specified components and calls the given function.
+   * @brief Performs maintenance incrementally, in slices of work that fit in a time budget.
    * 
-   * Same thing as creating a view with the components you need and calling for_each.
+   * Every slice is bounded and small, so the budget is never exceeded by much. The maintenance
+   * continues from where the previous call stopped, in this order:
+   * - Sorts the next range of a storage by identifier (see maintenance_slice), until every range of
+   *   the storage is sorted. Ranges are never merged, so the storage as a whole may not be sorted
+   * - Shrinks that storage, then continues with the next archetype
+   * - Moves recycled entities from heap to stack memory and shrinks the entity_manager, this ends a pass
    * 
-   * @tparam Components The components types to form the view for
-   * @tparam Callable The callable type
-   * @param Callable The callable to invoke on every iteration
+   * At most one pass is done per call, atleast one slice is always done. Unlike optimize, this can
+   * be called every frame with a small budget.
+   * 
+   * @warning Entities are moved inside their storage, this must not be called during iteration.
+   * 
+   * @param budget Time to spend doing maintenance
+   * @return size_t Amount of slices of work done
    */
-  template<typename... Components, typename Callable>
-  void for_each(const Callable& callable) { view<Components...>().for_each(callable); }
+  size_t maintain(const std::chrono::nanoseconds budget)
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    size_t slices = 0;
+
+    while (true)
+    {
+      slices++;
+
+      if (maintain_slice() || std::chrono::steady_clock::now() - start >= budget) break;
+    }
+
+    return slices;
+  }
 
   /**
-   * @brief Will change the archetype of an entity.
+   * @brief Renumbers every entity so that identifiers are dense, then shrinks the sparse array.
    * 
-   * Common components between archetypes will be moved, other components
-   *  will be untouched/uninitialized.
+   * After many entities were destroyed, live identifiers are scattered and the sparse array stays
+   * as large as the largest identifier ever generated. Defragmenting gives the live entities the
+   * identifiers [0, size), archetype after archetype in storage order, so the sparse array can be
+   * shrunk and is accessed in order during iteration. The entity_manager continues from size.
    * 
-   * @tparam SwapComponents The components of the archetype to swap to
-   * @param entity The entity to swap archetype for
+   * Every identifier held outside of the registry must be translated with the returned table.
+   * 
+   * @warning Invalidates every entity identifier. Must not be called while other threads use the
+   * registry.
+   * 
+   * @return std::vector<entity_type> New identifier of every old identifier, tombstone for identifiers
+   * of entities that did not exist
    */
-  template<typename... Components>
-  void swap_archetype(const entity_type entity) { view().template swap_archetype<Components...>(entity); }
+  std::vector<entity_type> defragment()
+  {
+    std::lock_guard<mutex_type> manager_lock(_manager_mutex);
+
+    std::vector<entity_type> table(_manager.peek(), tombstone);
+
+    entity_type next = 0;
+
+    // Archetype after archetype, every storage takes the next range of identifiers
+    ((lock<Archetypes>(), access<Archetypes>().renumber(next, table.data()),
+       next += static_cast<entity_type>(access<Archetypes>().size())),
+      ...);
+
+    r_sparse([&table, next](auto& sparse) { sparse.renumber(table.data(), next); });
+
+    _shared.shrink(next);
+    _manager.reset(next);
+
+    return table;
+  }
 
   /**
-   * @brief Returns a reference of the stored component for the specified entity and component type.
-   * 
-   * Unpacking components this way is the simplest, but the most expensive way to do it. A view with
-   * only the specified component is created, so this method may need to check multiple storages
-   * to find where the entity is stored. A better alternative is to create the view yourself, with
-   * all the components you know the entity's archetype contains, this can significantly improve
-   * performance. However, obtaining the components from iteration is always the best way and has no cost.
+   * @brief Exports the memory needed by the registry.
    * 
-   * @warning Attempting to unpack an entity that doesn't contain the component results in
-   * undefined behaviour
+   * The profile contains the high-water marks of the storages, so it is usually best to export it
+   * once the registry reached its largest size.
    * 
-   * @tparam Component The component type to unpack
-   * @param entity Entity to unpack component for
-   * @return Component& Reference to component belonging to the entity
+   * @return capacity_profile Capacity profile of the registry
    */
-  template<typename Component>
-  Component& unpack(const entity_type entity) { return view<Component>().template unpack<Component>(entity); }
+  [[nodiscard]] capacity_profile profile()
+  {
+    capacity_profile profile;
+
+    profile.storages = { access<Archetypes>().high_water()... };
+    profile.sparse = _shared.capacity();
+
+    std::lock_guard<mutex_type> lock(_manager_mutex);
+
+    profile.manager = _manager.heap_capacity();
+
+    return profile;
+  }
 
   /**
-   * @brief Returns whether or not the entity has all the specified components.
+   * @brief Returns a copy-on-write fork of the registry.
    * 
-   * Not very expensive to do, but you shouldn't need to call this method in most cases.
-   * If your finding yourself calling this method often, then your probably doing something wrong.
+   * The fork has the same entities, with the same identifiers and components, then both registries
+   * change independently. The sparse array, and the storages with a shared pages policy (see shared_pages_policy),
+   * share their pages with the fork until they are written (see storage::fork), a fork then only takes memory
+   * for the pages that are written. Usefull to evaluate many what-if scenarios on the same state.
    * 
-   * If you want to make this method faster, you can specify the types that you know the 
-   * component has, this can reduce some of the complexity.
+   * Pages are shared through a memory file, and every page written since the previous fork is copied to it. The
+   * first fork therefore costs as much as copying the whole registry, the next forks only copy the pages that
+   * were written in between. Other storages are copied by every fork.
    * 
-   * @note Specifying more component types does not make this method slower, it can even
-   * make it faster in some cases.
+   * The sparse components and the reusable identifiers are copied.
    * 
-   * @tparam Components The component types to check for
-   * @param entity The entity to check for
-   * @return true If the entity has all the specified component types, false otherwise
+   * @warning Must not be called while other threads use the registry.
+   * 
+   * @return std::unique_ptr<registry> The fork
    */
-  template<typename... Components>
-  bool has(const entity_type entity) { return view<Components...>().contains(entity); }
+  [[nodiscard]] std::unique_ptr<registry> fork()
+  {
+    auto fork = std::make_unique<registry>();
+
+    ((lock<Archetypes>(), access<Archetypes>().fork(fork->template access<Archetypes>())), ...);
+
+    _shared.fork(fork->_shared);
+
+    r_fork_sparse(*fork);
+
+    std::lock_guard<mutex_type> manager_lock(_manager_mutex);
+
+    fork->_manager.assign(_manager);
+
+    return fork;
+  }
 
   /**
-   * @brief Returns the amount of entities contained by this registry who have the specified components if any.
+   * @brief Binds an epoch_manager to every storage of the registry.
    * 
-   * If no components are specified, this will the amount of all entities in the registry.
+   * Once bound, views can be read from other threads while storages grow (see storage::bind).
    * 
-   * @note The more components are specified, the faster this method becomes.
+   * @warning Must be called while there are no readers. The epoch_manager must outlive the registry.
    * 
-   * @tparam Components The required components to be counted in the returned size
-   * @return size_t The amount of entities in the registry that have the specified components
+   * @param epochs The epoch_manager to retire memory to
    */
-  template<typename... Components>
-  size_t size() { return view<Components...>().size(); }
+  void bind(epoch_manager& epochs)
+  {
+    ((access<Archetypes>().bind(&epochs)), ...);
+  }
 
   /**
-   * @brief Returns whether or not the registry contains any entities with the specified components if any.
-   * 
-   * If no components are specified, this will return whether or not the registry contains ANY entities.
+   * @brief Iterates over every entity that has the specified components and calls the given function.
    * 
-   * @note The more components are specified, the faster this method becomes.
+   * Same thing as creating a view with the components you need and calling for_each.
    * 
-   * @tparam Components The required components to be counted in the check
-   * @return true If the registry contains any entities that have the specified components.
+   * @tparam Components The components types to form the view for
+   * @tparam Callable The callable type
+   * @param Callable The callable to invoke on every iteration
    */
-  template<typename... Components>
-  bool empty() { return view<Components...>().empty(); }
+  template<typename... Components, typename Callable>
+  void for_each(const Callable& callable) { view<Components...>().for_each(callable); }
 
   /**
-   * @brief Returns a view of the registry for the specified components.
+   * @brief Assigns the same value to the specified component of every entity that has it.
    * 
-   * This is the main operation of the registry. Almost every method in the registry
-   * uses a view under the hood.
+   * Same thing as creating a view with the component and calling fill.
    * 
-   * Views find all the archetypes that contain the specified components at compile-time.
+   * @tparam Component The component type to fill
+   * @param value Value to assign
+   */
+  template<typename Component>
+  void fill(const Component& value) { view<out<Component>>().fill(value); }
+
+  /**
+   * @brief Computes the specified computed components again, for every entity whose inputs changed.
    * 
-   * Views are essentially free to create.
+   * Same thing as creating a view with the components and calling compute.
    * 
-   * @tparam Components The component types to include in the view
-   * @return auto A view of the registry for the specified components
+   * @tparam Components The computed component types
    */
   template<typename... Components>
-  auto view() { return basic_view<Components...> { this }; }
+  void compute() { view<Components...>().compute(); }
 
   /**
-   * @brief Returns the amount of storages in the registry.
+   * @brief Iterates in parallel over every entity that has the specified components.
    * 
-   * @return size_t Amount of storages.
+   * Same thing as creating a view with the components you need and calling parallel_for_each.
+   * 
+   * @tparam Components The components types to form the view for
+   * @tparam Callable The callable type
+   * @param scheduler The scheduler to execute the loop on
+   * @param Callable The callable to invoke on every iteration
    */
-  size_t storages() const { return _shared.shared(); }
+  template<typename... Components, typename Callable>
+  void parallel_for_each(scheduler& scheduler, const Callable& callable) { view<Components...>().parallel_for_each(scheduler, callable); }
 
   /**
-   * @brief Accesses the storage for the specified archetype.
+   * @brief Will change the archetype of an entity.
+   * 
+   * Common components between archetypes will be moved, other components
+   *  will be untouched/uninitialized.
+   * 
+   * @tparam SwapComponents The components of the archetype to swap to
+   * @param entity The entity to swap archetype for
+   */
+  template<typename... Components>
+  void swap_archetype(const entity_type entity) { view().template swap_archetype<Components...>(entity); }
+
+  /**
+   * @brief Adds a sparse component to an entity, or replaces it if the entity already has it.
+   * 
+   * Sparse components are listed in the sparse_components of the policy and are not part of any
+   * archetype (see sparse_storage). Attaching or detaching them is O(1) and never moves the other
+   * components of the entity, unlike swap_archetype.
+   * 
+   * @tparam Component The sparse component type to add
+   * @param entity Entity to add the component to
+   * @param component Value of the component
+   */
+  template<typename Component>
+  void attach(const entity_type entity, const Component& component = {})
+  {
+    auto lock = sparse_lock<Component>();
+
+    auto& sparse = this->sparse<Component>();
+
+    if (sparse.contains(entity)) sparse.unpack(entity) = component;
+    else
+      sparse.insert(entity, component);
+  }
+
+  /**
+   * @brief Removes a sparse component from an entity, does nothing if the entity does not have it.
+   * 
+   * @tparam Component The sparse component type to remove
+   * @param entity Entity to remove the component from
+   */
+  template<typename Component>
+  void detach(const entity_type entity)
+  {
+    auto lock = sparse_lock<Component>();
+
+    auto& sparse = this->sparse<Component>();
+
+    if (sparse.contains(entity)) sparse.erase(entity);
+  }
+
+  /**
+   * @brief Returns whether or not an entity has a sparse component.
+   * 
+   * @tparam Component The sparse component type to check
+   * @param entity Entity to check
+   * @return true If the entity has the component, false otherwise
+   */
+  template<typename Component>
+  bool attached(const entity_type entity) { return sparse<Component>().contains(entity); }
+
+  /**
+   * @brief Iterates over every entity that has a sparse component and the specified components.
+   * 
+   * Same thing as creating a view with the components and calling for_each_with.
+   * 
+   * @tparam Sparse The sparse component type
+   * @tparam Components The component types to iterate
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Sparse, typename... Components, typename Callable>
+  void for_each_with(const Callable& callable) { view<Components...>().template for_each_with<Sparse>(callable); }
+
+  /**
+   * @brief Returns a reference of the stored component for the specified entity and component type.
+   * 
+   * Unpacking components this way is the simplest, but the most expensive way to do it. A view with
+   * only the specified component is created, so this method may need to check multiple storages
+   * to find where the entity is stored. A better alternative is to create the view yourself, with
+   * all the components you know the entity's archetype contains, this can significantly improve
+   * performance. However, obtaining the components from iteration is always the best way and has no cost.
+   * 
+   * @warning Attempting to unpack an entity that doesn't contain the component results in
+   * undefined behaviour
+   * 
+   * @warning With a concurrent policy, the reference is invalidated if another thread grows or
+   * erases from the storage of the entity.
+   * 
+   * @note Sparse components (see attach) are unpacked from their sparse storage.
+   * 
+   * @tparam Component The component type to unpack
+   * @param entity Entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  Component& unpack(const entity_type entity)
+  {
+    if constexpr (contains_v<std::remove_const_t<Component>, sparse_list_type>) return sparse<std::remove_const_t<Component>>().unpack(entity);
+    else
+      return view<Component>().template unpack<Component>(entity);
+  }
+
+  /**
+   * @brief Returns the entity whose component has the specified key.
+   * 
+   * The component must have an index key (see index_key). Every storage with the component keeps a
+   * secondary hash index of the keys, maintained automatically when entities are created, destroyed,
+   * swapped to another archetype or when the component is written (see storage::lookup). The lookup is
+   * a single hash map lookup per storage.
+   * 
+   * @warning Writes through a reference returned by unpack are only seen if done before the next lookup.
+   * 
+   * @tparam Component The component type of the key
+   * @param key Key to find
+   * @return entity_type Entity with the key (any of them if many have it), tombstone if there is none
+   */
+  template<typename Component>
+  entity_type find(const index_key_t<Component>& key) { return view<Component>().template find<Component>(key); }
+
+  /**
+   * @brief Returns a pointer to the stored component for the specified entity and component type if it has one.
+   * 
+   * Safe alternative to unpack when you are not sure that the entity still exists or still has the
+   * component, for example when writing back the results of asynchronous work.
+   * 
+   * @warning Entities are recycled, an entity that was destroyed may have been reused by another entity.
+   * 
+   * @tparam Component The component type to unpack
+   * @param entity Entity to unpack component for
+   * @return Component* Pointer to component belonging to the entity, NULL if the entity does not have it
+   */
+  template<typename Component>
+  Component* try_unpack(const entity_type entity)
+  {
+    auto view = this->view<Component>();
+
+    return view.contains(entity) ? &view.template unpack<Component>(entity) : NULL;
+  }
+
+  /**
+   * @brief Returns whether or not the entity has all the specified components.
+   * 
+   * Not very expensive to do, but you shouldn't need to call this method in most cases.
+   * If your finding yourself calling this method often, then your probably doing something wrong.
+   * 
+   * If you want to make this method faster, you can specify the types that you know the 
+   * component has, this can reduce some of the complexity.
+   * 
+   * @note Specifying more component types does not make this method slower, it can even
+   * make it faster in some cases.
+   * 
+   * @tparam Components The component types to check for
+   * @param entity The entity to check for
+   * @return true If the entity has all the specified component types, false otherwise
+   */
+  template<typename... Components>
+  bool has(const entity_type entity) { return view<Components...>().contains(entity); }
+
+  /**
+   * @brief Returns the amount of entities contained by this registry who have the specified components if any.
+   * 
+   * If no components are specified, this will the amount of all entities in the registry.
+   * 
+   * @note The more components are specified, the faster this method becomes.
+   * 
+   * @tparam Components The required components to be counted in the returned size
+   * @return size_t The amount of entities in the registry that have the specified components
+   */
+  template<typename... Components>
+  size_t size() { return view<Components...>().size(); }
+
+  /**
+   * @brief Returns whether or not the registry contains any entities with the specified components if any.
+   * 
+   * If no components are specified, this will return whether or not the registry contains ANY entities.
+   * 
+   * @note The more components are specified, the faster this method becomes.
+   * 
+   * @tparam Components The required components to be counted in the check
+   * @return true If the registry contains any entities that have the specified components.
+   */
+  template<typename... Components>
+  bool empty() { return view<Components...>().empty(); }
+
+  /**
+   * @brief Returns a view of the registry for the specified components.
+   * 
+   * This is the main operation of the registry. Almost every method in the registry
+   * uses a view under the hood.
+   * 
+   * Views find all the archetypes that contain the specified components at compile-time.
+   * 
+   * Views are essentially free to create.
+   * 
+   * @tparam Components The component types to include in the view
+   * @return auto A view of the registry for the specified components
+   */
+  template<typename... Components>
+  auto view() { return basic_view<Components...> { this }; }
+
+  /**
+   * @brief Returns a read-only, point-in-time view of the registry for the specified components.
+   * 
+   * Made for long-running queries (for example, analytics) that need a consistent view of the
+   * registry while it keeps being modified. The snapshot view can be read from any thread, for as
+   * long as needed, it always sees the entities and components that existed when it was created.
+   * 
+   * Nothing is copied when the snapshot view is created. Storages copy a chunk the first time it is
+   * written while a snapshot exists (see storage::freeze), untouched data is never copied. To avoid
+   * unnecessary copies, iterate with const components (view<const Component>) when only reading.
+   * 
+   * @warning Must be created by the thread that modifies the registry, while no other thread modifies it.
+   * 
+   * @tparam Components The component types to include in the view
+   * @return auto A snapshot view of the registry for the specified components
+   */
+  template<typename... Components>
+  auto snapshot_view() { return basic_snapshot_view<Components...> { this }; }
+
+  /**
+   * @brief Returns a persistent set of the entities with the specified components that satisfy a predicate.
+   * 
+   * Made for expensive queries used many times per frame, for example "hostile entities in range that
+   * are not stunned". The set keeps the members of every storage in a dense array, iterating it does
+   * not evaluate the predicate. Before it is used, the set evaluates the predicate again only for the
+   * chunks of entities that were touched or written since its last update (see storage::version).
+   * 
+   * The predicate is called with the entity and const references to the components. It must only
+   * depend on the components, since membership is not evaluated again unless they change.
+   * 
+   * @tparam Components The component types to include in the set
+   * @tparam Predicate Callable type
+   * @param predicate Whether or not an entity is part of the set
+   * @return auto An entity set of the registry for the specified components
+   */
+  template<typename... Components, typename Predicate>
+  auto entity_set(const Predicate& predicate) { return basic_entity_set<Components...> { this, predicate }; }
+
+  /**
+   * @brief Returns the amount of storages in the registry.
+   * 
+   * @return size_t Amount of storages.
+   */
+  size_t storages() const { return _shared.shared(); }
+
+  /**
+   * @brief Accesses the storage for the specified archetype.
    * 
    * Getting the archetype's storage is done at compile-time.
    * 
@@ -300,9 +897,106 @@ public:
    * @return auto& The storage of the specified archetype
    */
   template<typename Archetype>
-  auto& access() { return std::get<storage<entity_type, Archetype>>(_pool); }
+  auto& access() { return std::get<storage<entity_type, Archetype, policy_type>>(_pool); }
+
+  /**
+   * @brief Accesses the sparse storage of a sparse component.
+   * 
+   * @warning You should not directly access the sparse storage unless you
+   * know what your doing.
+   * 
+   * @tparam Component The sparse component to get the storage for
+   * @return auto& The sparse storage of the specified component
+   */
+  template<typename Component>
+  auto& sparse()
+  {
+    static_assert(contains_v<Component, sparse_list_type>, "The component is not a sparse component of the policy");
+
+    return std::get<find_v<Component, sparse_list_type>>(_sparse_pool);
+  }
 
 private:
+  /**
+   * @brief Mutex of a storage.
+   * 
+   * Aligned to a cache line when the mutex is not empty to avoid false sharing between
+   * storages that are locked by different threads.
+   */
+  struct alignas(std::is_empty_v<mutex_type> ? alignof(mutex_type) : 64) lock_type
+  {
+    mutex_type mutex;
+  };
+
+  /**
+   * @brief Locks the storage of the specified archetype.
+   * 
+   * With the default policy, this does nothing.
+   * 
+   * @tparam Archetype The archetype to lock the storage for
+   * @return std::unique_lock<mutex_type> Lock that is released when destroyed
+   */
+  template<typename Archetype>
+  std::unique_lock<mutex_type> lock()
+  {
+    return std::unique_lock<mutex_type>(_locks[find_v<Archetype, archetype_list_type>].mutex);
+  }
+
+  /**
+   * @brief Locks the sparse storage of a sparse component.
+   * 
+   * @tparam Component The sparse component to lock the storage of
+   * @return std::unique_lock<mutex_type> Lock that is released when destroyed
+   */
+  template<typename Component>
+  std::unique_lock<mutex_type> sparse_lock()
+  {
+    return std::unique_lock<mutex_type>(_sparse_locks[find_v<Component, sparse_list_type>].mutex);
+  }
+
+  /**
+   * @brief Calls the given function with every sparse storage, while it is locked.
+   * 
+   * @note This method uses recusion to iterate over all the sparse components in the registry.
+   * 
+   * @tparam I Sparse component index used during recursion, always leave it at 0
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke with every sparse storage
+   */
+  template<size_t I = 0, typename Callable>
+  void r_sparse(const Callable& callable)
+  {
+    if constexpr (I < size_v<sparse_list_type>)
+    {
+      {
+        std::lock_guard<mutex_type> lock(_sparse_locks[I].mutex);
+
+        callable(std::get<I>(_sparse_pool));
+      }
+
+      r_sparse<I + 1>(callable);
+    }
+  }
+
+  /**
+   * @brief Copies every sparse storage to a fork.
+   * 
+   * @note This method uses recusion to iterate over all the sparse components in the registry.
+   * 
+   * @tparam I Sparse component index used during recursion, always leave it at 0
+   * @param fork Fork of the registry
+   */
+  template<size_t I = 0>
+  void r_fork_sparse(registry& fork)
+  {
+    if constexpr (I < size_v<sparse_list_type>)
+    {
+      std::get<I>(fork._sparse_pool).assign(std::get<I>(_sparse_pool));
+
+      r_fork_sparse<I + 1>(fork);
+    }
+  }
+
   /**
    * @brief Set the up shared sparse_set
    * 
@@ -324,34 +1018,120 @@ private:
     }
   }
 
-private:
-  pool_type _pool;
-  shared_type _shared;
-  manager_type _manager;
-};
-
-template<typename Entity, typename... Archetypes>
-template<typename... Components>
-class registry<Entity, list<Archetypes...>>::basic_view
-{
-public:
-  using archetype_list_view_type = prune_for_t<archetype_list_type, Components...>;
-
-  static_assert(size_v<archetype_list_view_type> > 0, "There are no archetypes in this view");
-
-public:
   /**
-   * @brief Construct a new basic view object
+   * @brief Reserves every storage for the capacity of a profile.
    * 
-   * @param registry Registry to view
+   * @note This method uses recusion to iterate over all the archetypes in the registry.
+   * 
+   * @tparam I Archetype index used during recursion, always leave it at 0
+   * @param profile Profile to reserve
    */
-  explicit basic_view(registry_type* registry) : _registry { registry } {}
+  template<size_t I = 0>
+  void reserve_storages(const capacity_profile& profile)
+  {
+    using current = at_t<I, archetype_list_type>;
+
+    if constexpr (I < size_v<archetype_list_type>)
+    {
+      if (I < profile.storages.size()) access<current>().reserve(profile.storages[I]);
+
+      reserve_storages<I + 1>(profile);
+    }
+  }
 
   /**
-   * @brief Will change the archetype of an entity.
+   * @brief Does the next slice of maintenance.
    * 
-   * Common components between archetypes will be moved, other components
-   *  will be untouched/uninitialized.
+   * @note This method uses recusion to find the archetype being maintained.
+   * 
+   * @tparam I Archetype index used during recursion, always leave it at 0
+   * @return true If the slice ended a pass of maintenance, false otherwise
+   */
+  template<size_t I = 0>
+  bool maintain_slice()
+  {
+    if constexpr (I < size_v<archetype_list_type>)
+    {
+      if (_maintained_archetype != I) return maintain_slice<I + 1>();
+
+      using current = at_t<I, archetype_list_type>;
+
+      auto lock = this->template lock<current>();
+      auto& storage = access<current>();
+
+      if (_maintained_offset < storage.size())
+      {
+        const size_t last = _maintained_offset + maintenance_slice;
+
+        storage.sort(_maintained_offset, last < storage.size() ? last : storage.size());
+
+        _maintained_offset = last;
+      }
+      else
+      {
+        storage.shrink_to_fit();
+
+        _maintained_archetype++;
+        _maintained_offset = 0;
+      }
+
+      return false;
+    }
+    else
+    {
+      std::lock_guard<mutex_type> lock(_manager_mutex);
+
+      _manager.swap();
+      _manager.shrink_to_fit();
+
+      _maintained_archetype = 0;
+
+      return true;
+    }
+  }
+
+private:
+  pool_type _pool;
+  shared_type _shared;
+  manager_type _manager;
+  std::array<lock_type, sizeof...(Archetypes)> _locks;
+  typename sparse_pools<sparse_list_type>::type _sparse_pool;
+  std::array<lock_type, size_v<sparse_list_type>> _sparse_locks;
+  mutex_type _manager_mutex;
+
+  size_t _maintained_archetype;
+  size_t _maintained_offset;
+
+  loop_states _loop_states;
+};
+
+template<typename Entity, typename... Archetypes, typename Policy>
+template<typename... Components>
+class registry<Entity, list<Archetypes...>, Policy>::basic_view
+{
+public:
+  using archetype_list_view_type = prune_for_t<archetype_list_type, component_t<Components>...>;
+
+  /**
+   * @brief Whether or not the view writes components, components of const types are only read.
+   */
+  static constexpr bool writes = (... || !std::is_const_v<Components>);
+
+  static_assert(size_v<archetype_list_view_type> > 0, "There are no archetypes in this view");
+
+public:
+  /**
+   * @brief Construct a new basic view object
+   * 
+   * @param registry Registry to view
+   */
+  explicit basic_view(registry_type* registry) : _registry { registry } {}
+
+  /**
+   * @brief Will change the archetype of an entity.
+   * 
+   * Common components between archetypes will be moved, other components
+   *  will be untouched/uninitialized.
    * 
    * @warning Attempting to swap archetypes of an entity that doesn't exist in the view results
    * in undefined behaviour.
@@ -368,300 +1148,1528 @@ public:
     static_assert(size_v<prune_for_t<archetype_list_type, SwapComponents...>> > 0,
       "The archetype to swap to does not exist.");
 
-    using new_archetype = archetype<SwapComponents...>;
+    using new_archetype = archetype<SwapComponents...>;
+
+    std::tuple<SwapComponents...> temp;
+
+    r_apply<0>(entity, [this, &temp](auto& s, const entity_type e)
+      {
+        ((try_transfer<SwapComponents>(e, s, temp)), ...);
+
+        s.erase(e);
+      });
+
+    // The source storage is unlocked before locking the new one, this way two threads
+    // swapping entities in opposite directions cannot deadlock.
+    auto lock = _registry->template lock<new_archetype>();
+
+    _registry->template access<new_archetype>()
+      .insert(entity, std::move(std::get<SwapComponents>(temp))...);
+  }
+
+  /**
+   * @brief Erases an entity from the correct storage in the view.
+   * 
+   * Used internally by the registry to destroy entities. 
+   * 
+   * Unsafe and cannot be used externally because this method removes an entity without
+   * releasing the entity back into the entity_manager.
+   * 
+   * @warning Attempting to erase an entity that doesn't exist in the view results
+   * in undefined behaviour
+   * 
+   * @param entity The entity to erase
+   */
+  void destroy(const entity_type entity)
+  {
+    r_apply<0>(entity, [](auto& s, const entity_type e)
+      { s.erase(e); });
+
+    _registry->r_sparse([entity](auto& sparse)
+      {
+        if (sparse.contains(entity)) sparse.erase(entity);
+      });
+
+    std::lock_guard<mutex_type> lock(_registry->_manager_mutex);
+
+    _registry->_manager.release(entity);
+  }
+
+  /**
+   * @brief Creates many entities that are copies of an entity of the view.
+   * 
+   * Used internally by the registry to clone entities.
+   * 
+   * @warning Attempting to clone an entity that doesn't exist in the view results
+   * in undefined behaviour
+   * 
+   * @param entity The entity to copy
+   * @param count Amount of entities to create
+   * @return entity_type The first created entity, the created entities are [first, first + count)
+   */
+  entity_type clone(const entity_type entity, const size_t count)
+  {
+    entity_type first;
+
+    {
+      std::lock_guard<mutex_type> lock(_registry->_manager_mutex);
+      first = _registry->_manager.generate(count);
+    }
+
+    r_apply<0>(entity, [first, count](auto& s, const entity_type e)
+      { s.clone(e, first, count); });
+
+    return first;
+  }
+
+  /**
+   * @brief Iterates over every entity that has the specified components and calls the given function.
+   * 
+   * There is not much of a cost outside of the unpacking cost for iterating over multiple components. 
+   * Actually, specifing more components may even lead to better results in some cases. Go crazy...
+   * 
+   * The provided function must contain every component in the view as an argument. Write-only
+   * components (out<Component>) are passed as out objects that can only be assigned.
+   * 
+   * @tparam Callable Callable type
+   * @param Callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void for_each(const Callable& callable)
+  {
+    r_for_each<0, Callable>(callable);
+  }
+
+  /**
+   * @brief Iterates over every entity in the view that has a sparse component and calls the given function.
+   * 
+   * The provided function must contain every component in the view as an argument, followed by the
+   * sparse component. The sparse storage is walked in dense order, and every entity is found in the
+   * storages of the view, so this is best when few entities have the sparse component.
+   * 
+   * @warning Entities must not be created, destroyed or swapped during the iteration.
+   * 
+   * @tparam Sparse The sparse component type, const to only read it
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Sparse, typename Callable>
+  void for_each_with(const Callable& callable)
+  {
+    auto& sparse = _registry->template sparse<std::remove_const_t<Sparse>>();
+
+    sparse.for_each([this, &callable](const entity_type entity, std::remove_const_t<Sparse>& component)
+      { r_for_each_with<0, Sparse>(entity, component, callable); });
+  }
+
+  /**
+   * @brief Computes the computed components of the view again, for the entities whose inputs changed.
+   * 
+   * Iterating a view already does this for its storages before the iteration. Calling it explicitly
+   * moves the work to a batch pass, for example before the components are read by many views.
+   */
+  void compute()
+  {
+    r_compute<0>();
+  }
+
+  /**
+   * @brief Iterates over every entity in the view whose key is in a range and calls the given function.
+   * 
+   * The key of the component (see zone_key) is summarized per chunk by zone maps, chunks whose zone
+   * does not overlap the range are skipped without reading any of their entities (see storage::overlaps).
+   * Other entities are filtered one by one. The more the keys are correlated with the order of the
+   * entities (for example, entities created together), the more chunks are skipped.
+   * 
+   * @tparam Component The component type of the key, must be in the view
+   * @tparam Callable Callable type
+   * @param range Range of keys of the entities to iterate
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Component, typename Callable>
+  void for_each_where(const range<zone_key_t<Component>>& range, const Callable& callable)
+  {
+    static_assert((std::is_same_v<Component, component_t<Components>> || ...),
+      "The component of the key is not in the view");
+
+    r_for_each_where<0, Component>(range, callable);
+  }
+
+  /**
+   * @brief Iterates over every entity in the view and calls the given function, without blocking writers.
+   * 
+   * Can be called from many threads while a writer creates entities, the memory that is being read is
+   * never freed until the guard is destroyed. Components are passed as const references.
+   * 
+   * @warning The registry must be bound to an epoch_manager (see registry::bind). Entities must not
+   * be destroyed during a read (see storage::read).
+   * 
+   * @tparam Callable Callable type
+   * @param guard Pinned epoch of the reader
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void read(const epoch_manager::guard& guard, const Callable& callable)
+  {
+    r_read<0, Callable>(guard, callable);
+  }
+
+  /**
+   * @brief Iterates over every entity in the view in parallel.
+   * 
+   * The entities are split into chunks that are distributed between the workers of the scheduler.
+   * Every view and callable pair has its own persistent loop state per scheduler, kept by the registry,
+   * so the same chunks are given to the same workers from one call to the next (see loop_states).
+   * 
+   * The cost of the callable is measured on every call and the chunk size of the loop state is
+   * tuned from it, the tuning statistics are available from the loop state.
+   * 
+   * The callable is invoked concurrently, it must be safe to call from multiple threads. The
+   * registry must not be structurally modified (create, destroy, swap_archetype) during the loop.
+   * 
+   * @tparam Callable Callable type
+   * @param scheduler The scheduler to execute the loop on
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void parallel_for_each(scheduler& scheduler, const Callable& callable)
+  {
+    auto& state = _registry->_loop_states.template state<std::pair<basic_view, Callable>>(scheduler);
+
+    state.tuning(true);
+
+    parallel_for_each(scheduler, state, callable);
+  }
+
+  /**
+   * @brief Iterates over every entity in the view in parallel using the specified loop state.
+   * 
+   * If tuning is enabled in the loop state, the time spent in every chunk is measured and the
+   * chunk size is tuned for the next call.
+   * 
+   * @tparam Callable Callable type
+   * @param scheduler The scheduler to execute the loop on
+   * @param state The persistent loop state
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void parallel_for_each(scheduler& scheduler, loop_state& state, const Callable& callable)
+  {
+    const size_t chunk_size = state.chunk_size();
+
+    if (!state.tuning())
+    {
+      scheduler.parallel_for(chunks(chunk_size), state, [this, chunk_size, &callable](size_t, const size_t chunk)
+        { for_each_chunk(chunk, chunk_size, callable); });
+
+      return;
+    }
+
+    scheduler.parallel_for(chunks(chunk_size), state, [this, chunk_size, &callable, &state](const size_t worker, const size_t chunk)
+      {
+        const auto start = std::chrono::steady_clock::now();
+
+        for_each_chunk(chunk, chunk_size, callable);
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        state.measure(worker, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+      });
+
+    state.tune(size());
+  }
+
+  /**
+   * @brief Places the memory of every chunk of the view on the NUMA node of the worker that processes it.
+   * 
+   * Uses the same persistent loop state as parallel_for_each with the same callable, so chunks are
+   * placed where the loop processes them. Affine loops keep giving the same chunks to the same workers,
+   * and workers steal from their own node first, so the chunks stay on that node.
+   * 
+   * Should be called again after the storages of the view grew significantly. Does nothing on a single
+   * node machine.
+   * 
+   * @tparam Callable Callable type
+   * @param scheduler The scheduler that executes the loop
+   * @param callable The callable of the loop
+   */
+  template<typename Callable>
+  void place(scheduler& scheduler, const Callable& callable)
+  {
+    (void)callable; // Only used to find the loop state
+
+    place(scheduler, _registry->_loop_states.template state<std::pair<basic_view, Callable>>(scheduler));
+  }
+
+  /**
+   * @brief Places the memory of every chunk of the view on the NUMA node of the worker that processes it.
+   * 
+   * @param scheduler The scheduler that executes the loop
+   * @param state The persistent loop state
+   */
+  void place(scheduler& scheduler, loop_state& state)
+  {
+    const size_t chunk_size = state.chunk_size();
+    const size_t count = chunks(chunk_size);
+
+    if (count == 0) return;
+
+    state.assign(count, scheduler.workers());
+
+    for (size_t worker = 0; worker < scheduler.workers(); worker++)
+    {
+      for (size_t slot = state.begin(worker); slot < state.end(worker); slot++)
+      {
+        r_place<0>(state.chunk(slot), chunk_size, scheduler.node(worker));
+      }
+    }
+  }
+
+  /**
+   * @brief Transforms every entity in the view and reduces the results in parallel.
+   * 
+   * The result is deterministic, it is bit-identical no matter the amount of workers. Every chunk is
+   * reduced in order, then the results of chunks are combined with a fixed-shape tree (see tree_reduce).
+   * Chunk boundaries only depend on the size of storages.
+   * 
+   * Every view and callables have their own persistent loop state per scheduler, kept by the registry,
+   * which is always deterministic.
+   * 
+   * @tparam Type Result type
+   * @tparam Reduce Reduce type
+   * @tparam Transform Transform type
+   * @param scheduler The scheduler to execute the loop on
+   * @param init Initial value, combined with the result of the chunks
+   * @param reduce Binary operation that combines two results
+   * @param transform The callable that transforms every entity into a result
+   * @return Type The reduced result
+   */
+  template<typename Type, typename Reduce, typename Transform>
+  Type parallel_reduce(scheduler& scheduler, Type init, const Reduce& reduce, const Transform& transform)
+  {
+    auto& state = _registry->_loop_states.template state<std::tuple<basic_view, Reduce, Transform>>(scheduler);
+
+    state.deterministic(true);
+
+    return parallel_reduce(scheduler, state, std::move(init), reduce, transform);
+  }
+
+  /**
+   * @brief Transforms every entity in the view and reduces the results in parallel using the specified loop state.
+   * 
+   * @tparam Type Result type
+   * @tparam Reduce Reduce type
+   * @tparam Transform Transform type
+   * @param scheduler The scheduler to execute the loop on
+   * @param state The persistent loop state
+   * @param init Initial value, combined with the result of the chunks
+   * @param reduce Binary operation that combines two results
+   * @param transform The callable that transforms every entity into a result
+   * @return Type The reduced result
+   */
+  template<typename Type, typename Reduce, typename Transform>
+  Type parallel_reduce(scheduler& scheduler, loop_state& state, Type init, const Reduce& reduce, const Transform& transform)
+  {
+    const size_t chunk_size = state.chunk_size();
+    const size_t count = chunks(chunk_size);
+
+    if (count == 0) return init;
+
+    // Chunks are never empty, every partial is always set
+    std::vector<std::optional<Type>> partials(count);
+
+    scheduler.parallel_for(count, state, [&](size_t, const size_t chunk)
+      {
+        auto& partial = partials[chunk];
+
+        for_each_chunk(chunk, chunk_size, [&](auto&&... arguments)
+          {
+            if (partial) partial = reduce(std::move(*partial), transform(arguments...));
+            else
+              partial.emplace(transform(arguments...));
+          });
+      });
+
+    std::vector<Type> values;
+    values.reserve(count);
+
+    for (auto& partial : partials) values.push_back(std::move(*partial));
+
+    return reduce(std::move(init), tree_reduce(values, reduce));
+  }
+
+  /**
+   * @brief Returns the amount of chunks in the view for the specified chunk size.
+   * 
+   * Chunks never overlap two storages, so the last chunk of every storage may be smaller.
+   * 
+   * @param chunk_size Maximum amount of entities per chunk
+   * @return size_t Amount of chunks in the view
+   */
+  size_t chunks(const size_t chunk_size)
+  {
+    return r_chunks<0>(chunk_size);
+  }
+
+  /**
+   * @brief Iterates over every entity of a single chunk and calls the given function.
+   * 
+   * @tparam Callable Callable type
+   * @param chunk The index of the chunk (smaller than chunks(chunk_size))
+   * @param chunk_size Maximum amount of entities per chunk
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void for_each_chunk(const size_t chunk, const size_t chunk_size, const Callable& callable)
+  {
+    r_for_each_chunk<0, Callable>(chunk, chunk_size, callable);
+  }
+
+  /**
+   * @brief Assigns the same value to the specified component of every entity in the view.
+   * 
+   * Much faster than assigning the component in for_each, the old values are never read and the
+   * columns are filled at memset speed when possible (see storage::fill).
+   * 
+   * @tparam Component The component type to fill
+   * @param value Value to assign
+   */
+  template<typename Component>
+  void fill(const Component& value)
+  {
+    static_assert(contains_v<Component, list<component_t<Components>...>>,
+      "You cannot fill a component type that is not included in the view");
+
+    r_fill<0>(value);
+  }
+
+  /**
+   * @brief Returns a reference of the stored component for the specified entity and component type.
+   * 
+   * You should always prioritize getting your components from iteration.
+   * 
+   * @warning Attempting to unpack an entity that is not in the view results in
+   * undefined behaviour
+   * 
+   * @tparam Component The component type to unpack
+   * @param entity Entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  Component& unpack(const entity_type entity)
+  {
+    static_assert(size_v<prune_for_t<archetype_list_view_type, std::remove_const_t<Component>>> > 0,
+      "You cannot unpack a component type that is not included in the view");
+
+    return r_unpack<Component, 0>(entity);
+  }
+
+  /**
+   * @brief Returns the entity of the view whose component has the specified key.
+   * 
+   * @tparam Component The component type of the key, must be in the view
+   * @param key Key to find
+   * @return entity_type Entity with the key (any of them if many have it), tombstone if there is none
+   */
+  template<typename Component>
+  entity_type find(const index_key_t<Component>& key)
+  {
+    static_assert((std::is_same_v<Component, component_t<Components>> || ...),
+      "The component of the key is not in the view");
+
+    return r_find<0, Component>(key);
+  }
+
+  /**
+   * @brief Returns whether or not the view contains the specified entity.
+   * 
+   * @param entity The entity to check for
+   * @return true If the view contains the entity
+   */
+  bool contains(const entity_type entity)
+  {
+    return r_contains<0>(entity);
+  }
+
+  /**
+   * @brief Returns the amount of entities in the view.
+   * 
+   * Sum of size of storages of all archetypes in the view.
+   * 
+   * @return size_t The amount of entities in the view
+   */
+  size_t size()
+  {
+    return r_size<0>();
+  }
+
+  /**
+   * @brief Returns whether or not the view is empty
+   * 
+   * @return bool True if the view is empty, false otherwise
+   */
+  bool empty()
+  {
+    return r_empty<0>();
+  }
+
+private:
+  // A lot of internal methods use recursion for types. These methods are made private
+  // to avoid using them in wrong way. Safe wrapper methods are public.
+
+  /**
+   * @brief Iterates over every entity that has the specified components and calls the given function.
+   * 
+   * This method uses recursion to iterate over every archetype in the view and then iterates
+   * over all the entities in the archetype storage calling the function and unpacking all the
+   * components in the view.
+   * 
+   * The provided function must contain every component in the view as an argument.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Callable>
+  void r_for_each(const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    // Computed before the write hook, which outdates the computed components of the inputs the callable writes
+    (storage.template compute<component_t<Components>>(0, storage.size()), ...);
+
+    if constexpr (writes) storage.template write<Components...>(0, storage.size());
+
+    const size_t count = storage.size();
+    (void)count; // Unused by views without components
+
+    for (auto it = storage.begin(); it != storage.end(); ++it)
+    {
+      callable(*it, access_from<Components>(it, count)...);
+    }
+
+    if ((out_streams<Components>(count) || ...)) internal::stream_fence();
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each<I + 1>(callable);
+  }
+
+  /**
+   * @brief Calls the given function with an entity that has a sparse component, if it is in the view.
+   * 
+   * This method uses recursion to iterate over every archetype in the view and checks
+   * what archetype storage the entity is contained in.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Sparse The sparse component type
+   * @tparam Callable Callable type
+   * @param entity Entity that has the sparse component
+   * @param component Sparse component of the entity
+   * @param callable The callable to invoke
+   */
+  template<size_t I, typename Sparse, typename Callable>
+  void r_for_each_with(const entity_type entity, Sparse& component, const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    if (storage.contains(entity)) callable(entity, unpack_from<Components>(storage, entity)..., component);
+    else if constexpr (I + 1 < size_v<archetype_list_view_type>)
+      r_for_each_with<I + 1, Sparse>(entity, component, callable);
+  }
+
+  /**
+   * @brief Computes the computed components of every storage in the view again, for the entities whose inputs changed.
+   * 
+   * This method uses recursion to iterate over every archetype in the view.
+   * 
+   * @tparam I Archetype index used during recursion
+   */
+  template<size_t I>
+  void r_compute()
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    (storage.template compute<component_t<Components>>(0, storage.size()), ...);
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_compute<I + 1>();
+  }
+
+  /**
+   * @brief Iterates over every entity in the view whose key is in a range and calls the given function.
+   * 
+   * This method uses recursion to iterate over every archetype in the view, then iterates over the
+   * chunks of the storage that overlap the range.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Component The component type of the key
+   * @tparam Callable Callable type
+   * @param range Range of keys of the entities to iterate
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Component, typename Callable>
+  void r_for_each_where(const range<zone_key_t<Component>>& range, const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    const size_t count = storage.size();
+    const size_t chunk_size = storage.zone_chunk_size;
+
+    for (size_t first = 0; first < count; first += chunk_size)
+    {
+      if (!storage.template overlaps<Component>(first / chunk_size, range)) continue;
+
+      const size_t last = first + chunk_size < count ? first + chunk_size : count;
+
+      (storage.template compute<component_t<Components>>(first, last), ...);
+
+      if constexpr (writes) storage.template write<Components...>(first, last);
+
+      for (auto it = storage.at(last - 1), end = storage.at(first - 1); it != end; ++it)
+      {
+        if (range.contains(zone_key<Component>::key(it.template unpack<const Component>())))
+        {
+          callable(*it, access_from<Components>(it, count)...);
+        }
+      }
+    }
+
+    if ((out_streams<Components>(count) || ...)) internal::stream_fence();
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each_where<I + 1, Component>(range, callable);
+  }
+
+  /**
+   * @brief Assigns the same value to the specified component of every entity in the view.
+   * 
+   * This method uses recursion to fill every storage in the view.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Component The component type to fill
+   * @param value Value to assign
+   */
+  template<size_t I, typename Component>
+  void r_fill(const Component& value)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    storage.fill(0, storage.size(), value);
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_fill<I + 1>(value);
+  }
+
+  /**
+   * @brief Iterates over every entity in the view and calls the given function, without blocking writers.
+   * 
+   * This method uses recursion to iterate over every archetype in the view and reads
+   * every storage.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Callable Callable type
+   * @param guard Pinned epoch of the reader
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Callable>
+  void r_read(const epoch_manager::guard& guard, const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    _registry->template access<current>().template read<std::remove_const_t<Components>...>(guard, callable);
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_read<I + 1>(guard, callable);
+  }
+
+  /**
+   * @brief Returns the amount of chunks in the view for the specified chunk size.
+   * 
+   * This method uses recursion to iterate over every archetype in the view to obtain
+   * the sum of chunks of all storages.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @param chunk_size Maximum amount of entities per chunk
+   * @return size_t Amount of chunks in the view
+   */
+  template<size_t I>
+  size_t r_chunks(const size_t chunk_size)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    if constexpr (I == size_v<archetype_list_view_type>) return 0;
+    else
+      return (_registry->template access<current>().size() + chunk_size - 1) / chunk_size + r_chunks<I + 1>(chunk_size);
+  }
+
+  /**
+   * @brief Iterates over every entity of a single chunk and calls the given function.
+   * 
+   * This method uses recursion to find the storage that contains the chunk, then iterates
+   * over the range of the storage covered by the chunk.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Callable Callable type
+   * @param chunk The index of the chunk relative to the current storage
+   * @param chunk_size Maximum amount of entities per chunk
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Callable>
+  void r_for_each_chunk(const size_t chunk, const size_t chunk_size, const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    const size_t count = (storage.size() + chunk_size - 1) / chunk_size;
+
+    if (chunk < count)
+    {
+      const size_t first = chunk * chunk_size;
+      const size_t last = first + chunk_size < storage.size() ? first + chunk_size : storage.size();
+
+      (storage.template compute<component_t<Components>>(first, last), ...);
+
+      if constexpr (writes) storage.template write<Components...>(first, last);
+
+      const size_t size = storage.size();
+      (void)size; // Unused by views without components
+
+      for (auto it = storage.at(last - 1), end = storage.at(first - 1); it != end; ++it)
+      {
+        callable(*it, access_from<Components>(it, size)...);
+      }
+
+      if ((out_streams<Components>(size) || ...)) internal::stream_fence();
+    }
+    else if constexpr (I + 1 < size_v<archetype_list_view_type>)
+      r_for_each_chunk<I + 1>(chunk - count, chunk_size, callable);
+  }
+
+  /**
+   * @brief Places the memory of a single chunk on a NUMA node.
+   * 
+   * This method uses recursion to find the storage that contains the chunk.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @param chunk The index of the chunk relative to the current storage
+   * @param chunk_size Maximum amount of entities per chunk
+   * @param node The node to place the chunk on
+   */
+  template<size_t I>
+  void r_place(const size_t chunk, const size_t chunk_size, const size_t node)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    const size_t count = (storage.size() + chunk_size - 1) / chunk_size;
+
+    if (chunk < count)
+    {
+      const size_t first = chunk * chunk_size;
+      const size_t last = first + chunk_size < storage.size() ? first + chunk_size : storage.size();
+
+      storage.place(first, last, node);
+    }
+    else if constexpr (I + 1 < size_v<archetype_list_view_type>)
+      r_place<I + 1>(chunk - count, chunk_size, node);
+  }
+
+  /**
+   * @brief Applies an action to the storage in the view that contains the entity.
+   * 
+   * This method uses recursion to iterate over every archetype in the view and checks
+   * what archetype storage the entity is contained in. Once the storage is found, the
+   * action is applied to the storage and the entity.
+   * 
+   * @warning It is assumed that the entity is contained in atleast one of the storages
+   * in the view. If this is not the case, the behaviour of this method in undefined.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Invocable Invocable type (lambda)
+   * @param entity Entity to search and apply action for
+   * @param callable The callable to apply to storage and entity
+   */
+  template<size_t I, typename Callable>
+  void r_apply(const entity_type entity, const Callable& callable)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    auto lock = _registry->template lock<current>();
+
+    // If we assume that the entity is in atleast one of the storages in the view,
+    // we can skip the verification for the last possible storage.
+    if constexpr (I == size_v<archetype_list_view_type> - 1) callable(storage, entity);
+    else if (storage.contains(entity))
+      callable(storage, entity);
+    else
+    {
+      lock.unlock();
+      r_apply<I + 1, Callable>(entity, callable);
+    }
+  }
+
+  /**
+   * @brief Returns a reference of the stored component for the specified entity and component type.
+   * 
+   * This method uses recursion to iterate over every archetype in the view and checks
+   * what archetype storage the entity is contained in. Once the storage is found the desired
+   * component is unpacked and a reference is returned.
+   * 
+   * @warning Attempting to unpack an entity that is not in the view results in
+   * undefined behaviour
+   * 
+   * @tparam Component The component type to unpack
+   * @tparam I Archetype index used during recursion
+   * @param entity Entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component, size_t I>
+  Component& r_unpack(const entity_type entity)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    auto& storage = _registry->template access<current>();
+
+    auto lock = _registry->template lock<current>();
+
+    // If we assume that the entity is in atleast one of the storages in the view,
+    // we can skip the verification for the last possible storage.
+    if constexpr (I == size_v<archetype_list_view_type> - 1)
+      return unpack_from<Component>(storage, entity);
+    else if (storage.contains(entity))
+      return unpack_from<Component>(storage, entity);
+    else
+    {
+      lock.unlock();
+      return r_unpack<Component, I + 1>(entity);
+    }
+  }
+
+  /**
+   * @brief Returns the entity of the view whose component has the specified key.
+   * 
+   * This method uses recursion to look the key up in the index of every storage in the view.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Component The component type of the key
+   * @param key Key to find
+   * @return entity_type Entity with the key (any of them if many have it), tombstone if there is none
+   */
+  template<size_t I, typename Component>
+  entity_type r_find(const index_key_t<Component>& key)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    if constexpr (I == size_v<archetype_list_view_type>) return tombstone;
+    else
+    {
+      entity_type entity;
+
+      {
+        auto lock = _registry->template lock<current>();
+
+        entity = _registry->template access<current>().template lookup<Component>(key);
+      }
+
+      return entity != tombstone ? entity : r_find<I + 1, Component>(key);
+    }
+  }
+
+  /**
+   * @brief Returns whether or not the view contains the specified entity.
+   * 
+   * This method uses recursion to iterate over every archetype in the view to 
+   * and tries to find a storage that contains the entity.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @param entity The entity to check for
+   * @return true If the view contains the entity
+   */
+  template<size_t I>
+  bool r_contains(const entity_type entity)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    {
+      auto lock = _registry->template lock<current>();
+
+      if (_registry->template access<current>().contains(entity)) return true;
+    }
+
+    if constexpr (I + 1 == size_v<archetype_list_view_type>) return false;
+    else
+      return r_contains<I + 1>(entity);
+  }
+
+  /**
+   * @brief Returns the amount of entities in the view.
+   * 
+   * This method uses recursion to iterate over every archetype in the view to obtain
+   * the sum of sizes of storages.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @return size_t The amount of entities in the view
+   */
+  template<size_t I>
+  size_t r_size()
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    if constexpr (I == size_v<archetype_list_view_type>) return 0;
+    else
+    {
+      auto lock = _registry->template lock<current>();
+
+      const size_t size = _registry->template access<current>().size();
+
+      lock.unlock();
+
+      return size + r_size<I + 1>();
+    }
+  }
+
+  /**
+   * @brief Returns whether or not the view is empty
+   * 
+   * This method uses recursion to iterate over every archetype in the view and checks
+   * if the storage is empty.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @return bool True if the view is empty, false otherwise
+   */
+  template<size_t I>
+  bool r_empty()
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    if constexpr (I == size_v<archetype_list_view_type>) return true;
+    else
+    {
+      auto lock = _registry->template lock<current>();
+
+      if (!_registry->template access<current>().empty()) return false;
+
+      lock.unlock();
+
+      return r_empty<I + 1>();
+    }
+  }
+
+  /**
+   * @brief Returns a reference of the stored component, without copying snapshots if the component is const.
+   * 
+   * @tparam Component The component type to unpack (may be const)
+   * @tparam Storage Storage type
+   * @param storage Storage that contains the entity
+   * @param entity Entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component, typename Storage>
+  static Component& unpack_from(Storage& storage, const entity_type entity)
+  {
+    // Computed components are computed again if needed, which writes them
+    if constexpr (is_computed_v<std::remove_const_t<Component>>) return storage.template unpack<std::remove_const_t<Component>>(entity);
+    else if constexpr (std::is_const_v<Component>)
+      return std::as_const(storage).template unpack<std::remove_const_t<Component>>(entity);
+    else
+      return storage.template unpack<Component>(entity);
+  }
+
+  /**
+   * @brief Returns the access to the component at the current position of a storage iterator.
+   * 
+   * Write-only components are accessed through an out object, every other component through a reference.
+   * 
+   * @tparam Component The component type to access (may be const or out)
+   * @tparam Iterator Storage iterator type
+   * @param it Iterator at the current entity
+   * @param count Amount of entities in the storage
+   * @return decltype(auto) Reference to the component, or out object for write-only components
+   */
+  template<typename Component, typename Iterator>
+  static decltype(auto) access_from(Iterator& it, const size_t count)
+  {
+    if constexpr (is_out_v<Component>)
+    {
+      using type = typename Component::component_type;
+
+      return Component { &it.template unpack<type>(), Component::streams(count) };
+    }
+    else
+    {
+      (void)count; // Suppress unused warning
+
+      return it.template unpack<Component>();
+    }
+  }
+
+  /**
+   * @brief Returns whether or not a component is written with non-temporal stores for a storage.
+   * 
+   * @tparam Component The component type (may be const or out)
+   * @param count Amount of entities in the storage
+   * @return true If the component is write-only and streamed
+   */
+  template<typename Component>
+  static constexpr bool out_streams(const size_t count)
+  {
+    if constexpr (is_out_v<Component>) return Component::streams(count);
+    else
+    {
+      (void)count; // Suppress unused warning
+
+      return false;
+    }
+  }
+
+  /**
+   * @brief Attempts to move component data into temp storage for transfer.
+   * 
+   * Used internally as utility.
+   * 
+   * @tparam Component Component type to try to move
+   * @tparam Storage Storage type
+   * @tparam Tuple Temp storage tuple type
+   * @param entity Entity to move component for
+   * @param storage Storage to move component from
+   * @param temp Temp storage to move component into
+   */
+  template<typename Component, typename Storage, typename Tuple>
+  void try_transfer(const entity_type entity, Storage& storage, Tuple& temp)
+  {
+#if _MSC_VER
+    constexpr bool allow = storage.contains_component<Component>;
+#else
+    constexpr bool allow = storage.template contains_component<Component>;
+#endif
+
+    if constexpr (allow)
+    {
+      std::get<Component>(temp) = std::move(storage.template unpack<Component>(entity));
+    }
+    else
+      (void)entity; // Suppress unused warning
+  }
+
+private:
+  registry_type* _registry;
+};
+
+template<typename Entity, typename... Archetypes, typename Policy>
+template<typename... Components>
+class registry<Entity, list<Archetypes...>, Policy>::basic_snapshot_view
+{
+public:
+  using archetype_list_view_type = prune_for_t<archetype_list_type, std::remove_const_t<Components>...>;
+
+  static_assert(size_v<archetype_list_view_type> > 0, "There are no archetypes in this view");
+
+private:
+  template<typename List>
+  struct snapshots;
+
+  template<typename... ViewArchetypes>
+  struct snapshots<list<ViewArchetypes...>>
+  {
+    using type = std::tuple<typename storage<entity_type, ViewArchetypes, policy_type>::snapshot...>;
+  };
+
+public:
+  /**
+   * @brief Construct a new basic snapshot view object
+   * 
+   * Takes a snapshot of every storage in the view.
+   * 
+   * @param registry Registry to take the snapshot of
+   */
+  explicit basic_snapshot_view(registry_type* registry)
+  {
+    r_freeze<0>(registry);
+  }
+
+  /**
+   * @brief Iterates over every entity of the snapshot and calls the given function.
+   * 
+   * The provided function must contain every component in the view as an argument, components
+   * are passed as const references.
+   * 
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<typename Callable>
+  void for_each(const Callable& callable) const
+  {
+    r_for_each<0, Callable>(callable);
+  }
+
+  /**
+   * @brief Returns the amount of entities in the snapshot view.
+   * 
+   * @return size_t The amount of entities in the snapshot view
+   */
+  size_t size() const
+  {
+    return r_size<0>();
+  }
+
+  /**
+   * @brief Returns whether or not the snapshot view is empty
+   * 
+   * @return bool True if the snapshot view is empty, false otherwise
+   */
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+private:
+  /**
+   * @brief Takes a snapshot of every storage in the view.
+   * 
+   * This method uses recursion to iterate over every archetype in the view.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @param registry Registry to take the snapshot of
+   */
+  template<size_t I>
+  void r_freeze(registry_type* registry)
+  {
+    using current = at_t<I, archetype_list_view_type>;
+
+    {
+      auto lock = registry->template lock<current>();
+
+      std::get<I>(_snapshots) = registry->template access<current>().freeze();
+    }
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_freeze<I + 1>(registry);
+  }
+
+  /**
+   * @brief Iterates over every entity of the snapshot and calls the given function.
+   * 
+   * This method uses recursion to iterate over the snapshot of every archetype in the view.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
+   */
+  template<size_t I, typename Callable>
+  void r_for_each(const Callable& callable) const
+  {
+    std::get<I>(_snapshots).template for_each<std::remove_const_t<Components>...>(callable);
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each<I + 1>(callable);
+  }
+
+  /**
+   * @brief Returns the amount of entities in the snapshot view.
+   * 
+   * This method uses recursion to obtain the sum of sizes of the snapshots.
+   * 
+   * @tparam I Archetype index used during recursion
+   * @return size_t The amount of entities in the snapshot view
+   */
+  template<size_t I>
+  size_t r_size() const
+  {
+    if constexpr (I == size_v<archetype_list_view_type>) return 0;
+    else
+      return std::get<I>(_snapshots).size() + r_size<I + 1>();
+  }
+
+private:
+  typename snapshots<archetype_list_view_type>::type _snapshots;
+};
 
-    r_apply<0>(entity, [this](auto& s, const entity_type e)
-      {
-        std::tuple<SwapComponents...> temp;
-        ((try_transfer<SwapComponents>(e, s, temp)), ...);
+template<typename Entity, typename... Archetypes, typename Policy>
+template<typename... Components>
+class registry<Entity, list<Archetypes...>, Policy>::basic_entity_set
+{
+public:
+  using archetype_list_view_type = prune_for_t<archetype_list_type, std::remove_const_t<Components>...>;
+  using predicate_type = std::function<bool(entity_type, const std::remove_const_t<Components>&...)>;
 
-        s.erase(e);
+  /**
+   * @brief Whether or not the set writes components during iteration, components of const types are only read.
+   */
+  static constexpr bool writes = (... || !std::is_const_v<Components>);
 
-        _registry->template access<new_archetype>()
-          .insert(e, std::move(std::get<SwapComponents>(temp))...);
-      });
-  }
+  static_assert(size_v<archetype_list_view_type> > 0, "There are no archetypes in this set");
+  static_assert(!(is_out_v<Components> || ...), "Sets cannot contain write-only components");
 
+private:
   /**
-   * @brief Erases an entity from the correct storage in the view.
-   * 
-   * Used internally by the registry to destroy entities. 
-   * 
-   * Unsafe and cannot be used externally because this method removes an entity without
-   * releasing the entity back into the entity_manager.
-   * 
-   * @warning Attempting to erase an entity that doesn't exist in the view results
-   * in undefined behaviour
-   * 
-   * @param entity The entity to erase
+   * @brief Version of a storage that was never evaluated.
    */
-  void destroy(const entity_type entity)
-  {
-    r_apply<0>(entity, [](auto& s, const entity_type e)
-      { s.erase(e); });
+  static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
 
-    _registry->_manager.release(entity);
-  }
+  /**
+   * @brief Members of the set in a storage.
+   */
+  struct group
+  {
+    uint64_t synced = never; ///< Version of the storage when it was last evaluated
+    std::vector<uint64_t> bits; ///< Whether or not every entity is a member, by dense index
+    std::vector<size_t> members; ///< Dense indexes of the members
+  };
 
+public:
   /**
-   * @brief Iterates over every entity that has the specified components and calls the given function.
+   * @brief Construct a new basic entity set object
    * 
-   * There is not much of a cost outside of the unpacking cost for iterating over multiple components. 
-   * Actually, specifing more components may even lead to better results in some cases. Go crazy...
+   * Nothing is evaluated until the set is first used.
    * 
-   * The provided function must contain every component in the view as an argument.
+   * @param registry Registry of the entities
+   * @param predicate Whether or not an entity is part of the set
+   */
+  basic_entity_set(registry_type* registry, predicate_type predicate)
+    : _registry { registry }, _predicate { std::move(predicate) }
+  {}
+
+  /**
+   * @brief Evaluates the predicate again for the entities that changed since the last update.
    * 
-   * @tparam Callable Callable type
-   * @param Callable The callable to invoke on every iteration
+   * Called by every other method, calling it explicitly moves the work to a chosen point of the frame.
    */
-  template<typename Callable>
-  void for_each(const Callable& callable)
+  void update()
   {
-    r_for_each<0, Callable>(callable);
+    r_update<0>();
   }
 
   /**
-   * @brief Returns a reference of the stored component for the specified entity and component type.
+   * @brief Iterates over every entity in the set and calls the given function.
    * 
-   * You should always prioritize getting your components from iteration.
+   * The provided function must contain every component in the set as an argument, like views.
+   * Entities are visited storage by storage, in the order of the dense arrays.
    * 
-   * @warning Attempting to unpack an entity that is not in the view results in
-   * undefined behaviour
+   * @warning Entities must not be created, destroyed or swapped during the iteration.
    * 
-   * @tparam Component The component type to unpack
-   * @param entity Entity to unpack component for
-   * @return Component& Reference to component belonging to the entity
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
    */
-  template<typename Component>
-  Component& unpack(const entity_type entity)
+  template<typename Callable>
+  void for_each(const Callable& callable)
   {
-    static_assert(size_v<prune_for_t<archetype_list_view_type, Component>> > 0,
-      "You cannot unpack a component type that is not included in the view");
+    update();
 
-    return r_unpack<Component, 0>(entity);
+    r_for_each<0>(callable);
   }
 
   /**
-   * @brief Returns whether or not the view contains the specified entity.
+   * @brief Returns whether or not an entity is part of the set.
    * 
-   * @param entity The entity to check for
-   * @return true If the view contains the entity
+   * @param entity Entity to check
+   * @return true If the entity is part of the set, false otherwise
    */
   bool contains(const entity_type entity)
   {
+    update();
+
     return r_contains<0>(entity);
   }
 
   /**
-   * @brief Returns the amount of entities in the view.
-   * 
-   * Sum of size of storages of all archetypes in the view.
+   * @brief Returns the amount of entities in the set.
    * 
-   * @return size_t The amount of entities in the view
+   * @return size_t The amount of entities in the set
    */
   size_t size()
   {
+    update();
+
     return r_size<0>();
   }
 
   /**
-   * @brief Returns whether or not the view is empty
+   * @brief Returns whether or not the set is empty
    * 
-   * @return bool True if the view is empty, false otherwise
+   * @return bool True if the set is empty, false otherwise
    */
   bool empty()
   {
-    return r_empty<0>();
+    return size() == 0;
   }
 
 private:
-  // A lot of internal methods use recursion for types. These methods are made private
-  // to avoid using them in wrong way. Safe wrapper methods are public.
-
   /**
-   * @brief Iterates over every entity that has the specified components and calls the given function.
-   * 
-   * This method uses recursion to iterate over every archetype in the view and then iterates
-   * over all the entities in the archetype storage calling the function and unpacking all the
-   * components in the view.
+   * @brief Evaluates the predicate again for the chunks of every storage that changed since the last update.
    * 
-   * The provided function must contain every component in the view as an argument.
+   * This method uses recursion to iterate over every archetype in the set.
    * 
    * @tparam I Archetype index used during recursion
-   * @tparam Callable Callable type
-   * @param callable The callable to invoke on every iteration
    */
-  template<size_t I, typename Callable>
-  void r_for_each(const Callable& callable)
+  template<size_t I>
+  void r_update()
   {
     using current = at_t<I, archetype_list_view_type>;
+    using storage_type = storage<entity_type, current, policy_type>;
 
     auto& storage = _registry->template access<current>();
+    group& state = _groups[I];
 
-    for (auto it = storage.begin(); it != storage.end(); ++it)
     {
-      callable(*it, it.template unpack<Components>()...);
+      auto lock = _registry->template lock<current>();
+
+      (storage.template compute<std::remove_const_t<Components>>(0, storage.size()), ...);
+
+      const uint64_t version = storage.version();
+
+      // Members past the end of the storage were erased, even if the storage was not changed since
+      while (!state.members.empty() && state.members.back() >= storage.size()) state.members.pop_back();
+
+      if (version != state.synced)
+      {
+        const size_t size = storage.size();
+
+        state.bits.resize((size + 63) / 64, 0);
+
+        // Entities that were erased from the back are not members anymore
+        if (size % 64) state.bits.back() &= (uint64_t { 1 } << (size % 64)) - 1;
+
+        for (size_t first = 0; first < size; first += storage_type::version_chunk_size)
+        {
+          if (state.synced != never && storage.version(first / storage_type::version_chunk_size) <= state.synced) continue;
+
+          const size_t last = std::min(first + storage_type::version_chunk_size, size);
+
+          for (size_t index = first; index < last; index++)
+          {
+            const auto it = storage.at(index);
+
+            const uint64_t bit = uint64_t { 1 } << (index % 64);
+
+            if (_predicate(*it, it.template unpack<const std::remove_const_t<Components>>()...)) state.bits[index / 64] |= bit;
+            else
+              state.bits[index / 64] &= ~bit;
+          }
+        }
+
+        state.members.clear();
+
+        for (size_t word = 0; word < state.bits.size(); word++)
+        {
+          for (uint64_t bits = state.bits[word]; bits; bits &= bits - 1)
+          {
+            state.members.push_back(word * 64 + static_cast<size_t>(count_trailing_zeros(bits)));
+          }
+        }
+
+        state.synced = version;
+      }
     }
 
-    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each<I + 1>(callable);
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_update<I + 1>();
   }
 
   /**
-   * @brief Applies an action to the storage in the view that contains the entity.
-   * 
-   * This method uses recursion to iterate over every archetype in the view and checks
-   * what archetype storage the entity is contained in. Once the storage is found, the
-   * action is applied to the storage and the entity.
+   * @brief Iterates over the members of every storage and calls the given function.
    * 
-   * @warning It is assumed that the entity is contained in atleast one of the storages
-   * in the view. If this is not the case, the behaviour of this method in undefined.
+   * This method uses recursion to iterate over every archetype in the set.
    * 
    * @tparam I Archetype index used during recursion
-   * @tparam Invocable Invocable type (lambda)
-   * @param entity Entity to search and apply action for
-   * @param callable The callable to apply to storage and entity
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every iteration
    */
   template<size_t I, typename Callable>
-  void r_apply(const entity_type entity, const Callable& callable)
+  void r_for_each(const Callable& callable)
   {
     using current = at_t<I, archetype_list_view_type>;
 
     auto& storage = _registry->template access<current>();
+    const std::vector<size_t>& members = _groups[I].members;
 
-    // If we assume that the entity is in atleast one of the storages in the view,
-    // we can skip the verification for the last possible storage.
-    if constexpr (I == size_v<archetype_list_view_type> - 1) callable(storage, entity);
-    else if (storage.contains(entity))
-      callable(storage, entity);
-    else
-      r_apply<I + 1, Callable>(entity, callable);
+    if (!members.empty())
+    {
+      if constexpr (writes) storage.template write<Components...>(members.front(), members.back() + 1);
+
+      for (const size_t index : members)
+      {
+        auto it = storage.at(index);
+
+        callable(*it, it.template unpack<Components>()...);
+      }
+    }
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) r_for_each<I + 1>(callable);
   }
 
   /**
-   * @brief Returns a reference of the stored component for the specified entity and component type.
-   * 
-   * This method uses recursion to iterate over every archetype in the view and checks
-   * what archetype storage the entity is contained in. Once the storage is found the desired
-   * component is unpacked and a reference is returned.
+   * @brief Returns whether or not an entity is a member in any storage of the set.
    * 
-   * @warning Attempting to unpack an entity that is not in the view results in
-   * undefined behaviour
+   * This method uses recursion to iterate over every archetype in the set.
    * 
-   * @tparam Component The component type to unpack
    * @tparam I Archetype index used during recursion
-   * @param entity Entity to unpack component for
-   * @return Component& Reference to component belonging to the entity
+   * @param entity Entity to check
+   * @return true If the entity is part of the set, false otherwise
    */
-  template<typename Component, size_t I>
-  Component& r_unpack(const entity_type entity)
+  template<size_t I>
+  bool r_contains(const entity_type entity)
   {
     using current = at_t<I, archetype_list_view_type>;
 
     auto& storage = _registry->template access<current>();
 
-    // If we assume that the entity is in atleast one of the storages in the view,
-    // we can skip the verification for the last possible storage.
-    if constexpr (I == size_v<archetype_list_view_type> - 1)
-      return storage.template unpack<Component>(entity);
-    else if (storage.contains(entity))
-      return storage.template unpack<Component>(entity);
+    if (storage.contains(entity))
+    {
+      const size_t index = storage.index(entity);
+
+      return (_groups[I].bits[index / 64] >> (index % 64)) & 1;
+    }
+
+    if constexpr (I + 1 < size_v<archetype_list_view_type>) return r_contains<I + 1>(entity);
     else
-      return r_unpack<Component, I + 1>(entity);
+      return false;
   }
 
   /**
-   * @brief Returns whether or not the view contains the specified entity.
+   * @brief Returns the amount of entities in the set.
    * 
-   * This method uses recursion to iterate over every archetype in the view to 
-   * and tries to find a storage that contains the entity.
+   * This method uses recursion to obtain the sum of the members of every storage.
    * 
    * @tparam I Archetype index used during recursion
-   * @param entity The entity to check for
-   * @return true If the view contains the entity
+   * @return size_t The amount of entities in the set
    */
   template<size_t I>
-  bool r_contains(const entity_type entity)
+  size_t r_size() const
   {
-    using current = at_t<I, archetype_list_view_type>;
+    if constexpr (I == size_v<archetype_list_view_type>) return 0;
+    else
+      return _groups[I].members.size() + r_size<I + 1>();
+  }
+
+  /**
+   * @brief Returns the index of the lowest set bit.
+   * 
+   * @param bits Bits, must not be zero
+   * @return int Index of the lowest set bit
+   */
+  static int count_trailing_zeros(const uint64_t bits)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int result = 0;
 
-    if (_registry->template access<current>().contains(entity)) return true;
+    while (((bits >> result) & 1) == 0) result++;
 
-    if constexpr (I + 1 == size_v<archetype_list_view_type>) return false;
-    else
-      return r_contains<I + 1>(entity);
+    return result;
+#endif
   }
 
+private:
+  registry_type* _registry;
+  predicate_type _predicate;
+  std::array<group, size_v<archetype_list_view_type>> _groups;
+};
+
+template<typename Entity, typename... Archetypes, typename Policy>
+template<typename Archetype>
+class registry<Entity, list<Archetypes...>, Policy>::basic_appender
+{
+public:
+  using storage_type = storage<entity_type, Archetype, policy_type>;
+
   /**
-   * @brief Returns the amount of entities in the view.
+   * @brief Construct a new basic appender object
    * 
-   * This method uses recursion to iterate over every archetype in the view to obtain
-   * the sum of sizes of storages.
+   * @param registry Registry to create entities in
+   * @param count Amount of entities to reserve
+   */
+  basic_appender(registry_type* registry, const size_t count)
+    : _registry { registry },
+      _lock { registry->template lock<Archetype>() },
+      _entities { generate(registry, count) },
+      _next { 0 },
+      _appender { registry->template access<Archetype>().append(count, last(_entities)) }
+  {}
+
+  /**
+   * @brief Destroy the basic appender object
    * 
-   * @tparam I Archetype index used during recursion
-   * @return size_t The amount of entities in the view
+   * Commits the created entities and releases the unused identifiers.
    */
-  template<size_t I>
-  size_t r_size()
+  ~basic_appender()
   {
-    using current = at_t<I, archetype_list_view_type>;
+    const size_t used = _next.load(std::memory_order_relaxed);
 
-    if constexpr (I == size_v<archetype_list_view_type>) return 0;
-    else
-      return _registry->template access<current>().size() + r_size<I + 1>();
+    std::lock_guard<mutex_type> lock(_registry->_manager_mutex);
+
+    for (size_t i = used; i < _entities.size(); i++) _registry->_manager.release(_entities[i]);
   }
 
+  basic_appender(const basic_appender&) = delete;
+  basic_appender(basic_appender&&) = delete;
+  basic_appender& operator=(const basic_appender&) = delete;
+  basic_appender& operator=(basic_appender&&) = delete;
+
   /**
-   * @brief Returns whether or not the view is empty
+   * @brief Creates an entity and initializes it with the given components.
    * 
-   * This method uses recursion to iterate over every archetype in the view and checks
-   * if the storage is empty.
+   * This method is thread-safe and lock-free.
    * 
-   * @tparam I Archetype index used during recursion
-   * @return bool True if the view is empty, false otherwise
+   * @warning Creating more entities than the amount reserved results in undefined behaviour.
+   * 
+   * @tparam Components The exact component types of the archetype
+   * @param components The components to initialize with
+   * @return entity_type The created entity's identifier
    */
-  template<size_t I>
-  bool r_empty()
+  template<typename... Components>
+  entity_type create(const Components&... components)
   {
-    using current = at_t<I, archetype_list_view_type>;
+    static_assert(size_v<Archetype> == sizeof...(Components) && contains_all_v<Archetype, Components...>,
+      "Appender archetype does not match the provided components");
 
-    if constexpr (I == size_v<archetype_list_view_type>) return true;
-    else if (!_registry->template access<current>().empty())
-      return false;
-    else
-      return r_empty<I + 1>();
+    const size_t index = _next.fetch_add(1, std::memory_order_relaxed);
+
+    assert(index < _entities.size() && "Created more entities than reserved");
+
+    const entity_type entity = _entities[index];
+
+    _appender.insert(entity, components...);
+
+    return entity;
   }
 
   /**
-   * @brief Attempts to move component data into temp storage for transfer.
+   * @brief Returns the amount of entities that can still be created.
    * 
-   * Used internally as utility.
-   * 
-   * @tparam Component Component type to try to move
-   * @tparam Storage Storage type
-   * @tparam Tuple Temp storage tuple type
-   * @param entity Entity to move component for
-   * @param storage Storage to move component from
-   * @param temp Temp storage to move component into
+   * @return size_t Amount of reserved entities left
    */
-  template<typename Component, typename Storage, typename Tuple>
-  void try_transfer(const entity_type entity, Storage& storage, Tuple& temp)
+  [[nodiscard]] size_t remaining() const { return _appender.remaining(); }
+
+private:
+  static std::vector<entity_type> generate(registry_type* registry, const size_t count)
   {
-#if _MSC_VER
-    constexpr bool allow = storage.contains_component<Component>;
-#else
-    constexpr bool allow = storage.template contains_component<Component>;
-#endif
+    std::vector<entity_type> entities(count);
 
-    if constexpr (allow)
-    {
-      std::get<Component>(temp) = std::move(storage.template unpack<Component>(entity));
-    }
-    else
-      (void)entity; // Suppress unused warning
+    std::lock_guard<mutex_type> lock(registry->_manager_mutex);
+
+    for (auto& entity : entities) entity = registry->_manager.generate();
+
+    return entities;
+  }
+
+  static entity_type last(const std::vector<entity_type>& entities)
+  {
+    return entities.empty() ? 0 : *std::max_element(entities.begin(), entities.end());
   }
 
 private:
   registry_type* _registry;
+  std::unique_lock<mutex_type> _lock;
+  std::vector<entity_type> _entities;
+  std::atomic<size_t> _next;
+  typename storage_type::appender _appender;
 };
 } // namespace xecs
 
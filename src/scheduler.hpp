@@ -0,0 +1,855 @@
+#ifndef XECS_SCHEDULER_HPP
+#define XECS_SCHEDULER_HPP
+
+#include "numa.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace xecs
+{
+/**
+ * @brief How the chunks of a parallel loop are assigned to workers.
+ */
+enum class assignment
+{
+  affine, ///< Every worker keeps the same chunks from one frame to the next
+  random ///< Chunks are shuffled between workers every frame (mostly for comparaison)
+};
+
+/**
+ * @brief Statistics of the chunk size tuning of a parallel loop.
+ */
+struct loop_statistics
+{
+  size_t executions; ///< Amount of executions that were measured
+  size_t entities; ///< Amount of entities of the last execution
+  uint64_t nanoseconds; ///< Time spent in chunks during the last execution, summed over every worker
+  double cost; ///< Smoothed cost of an entity in nanoseconds
+  size_t chunk_size; ///< Current amount of entities per chunk
+  size_t adjustments; ///< Amount of times the chunk size was changed
+};
+
+/**
+ * @brief Persistent state of a parallel loop.
+ * 
+ * A parallel loop is executed many times (usually once per frame), the loop state remembers
+ * which worker processed which chunks the last time. As long as the amount of chunks does not
+ * change too much, every worker will be given the same range of chunks again, so the data
+ * it processed last frame is probably still in its cache.
+ * 
+ * Work stealing is only used to correct imbalance, a worker will always finish its own range
+ * before stealing from others.
+ */
+class loop_state final
+{
+public:
+  using size_type = size_t;
+
+  /**
+   * @brief Default amount of entities per chunk.
+   * 
+   * A chunk of two 16 byte components is 32kb, this fits in the L1/L2 of most processors.
+   */
+  static constexpr size_type default_chunk_size = 1024;
+
+  /**
+   * @brief Default amount of time a chunk should take when the chunk size is tuned.
+   * 
+   * Long enough for the cost of scheduling a chunk (a few hundred nanoseconds) to be negligible.
+   */
+  static constexpr uint64_t default_chunk_duration = 50000;
+
+  /**
+   * @brief Construct a new loop state object
+   */
+  loop_state()
+    : _chunks(0), _chunk_size(default_chunk_size), _policy(assignment::affine), _seed(0), _deterministic(false),
+      _tuning(false), _min_chunk_size(64), _max_chunk_size(65536), _chunk_duration(default_chunk_duration), _statistics()
+  {
+    _statistics.chunk_size = _chunk_size;
+  }
+
+  /**
+   * @brief Computes the chunk ranges of every worker for the next execution of the loop.
+   * 
+   * With affine assignment, the previous ranges are kept if the amount of chunks did not change by
+   * more than an eighth. New chunks are given to the last worker and stealing corrects the imbalance.
+   * Otherwise, the chunks are evenly split between workers.
+   * 
+   * @param chunks Amount of chunks to execute
+   * @param workers Amount of workers that will execute the loop
+   */
+  void assign(const size_type chunks, const size_type workers)
+  {
+    const bool stable = _bounds.size() == workers + 1
+      && _policy == assignment::affine
+      && (chunks > _chunks ? chunks - _chunks : _chunks - chunks) * 8 <= _chunks;
+
+    if (stable)
+    {
+      for (auto& bound : _bounds) bound = bound < chunks ? bound : chunks;
+
+      _bounds.back() = chunks;
+    }
+    else
+    {
+      _bounds.resize(workers + 1);
+
+      for (size_type i = 0; i <= workers; i++) _bounds[i] = (chunks * i) / workers;
+    }
+
+    if (_order.size() != chunks)
+    {
+      _order.resize(chunks);
+
+      for (size_type i = 0; i < chunks; i++) _order[i] = static_cast<uint32_t>(i);
+    }
+
+    if (_policy == assignment::random)
+    {
+      std::shuffle(_order.begin(), _order.end(), std::minstd_rand(static_cast<uint32_t>(++_seed)));
+    }
+
+    if (_samples.size() != workers) _samples = std::vector<sample>(workers);
+
+    _chunks = chunks;
+  }
+
+  /**
+   * @brief Adds the time a worker spent executing a chunk.
+   * 
+   * This method is thread-safe as long as every worker only measures its own chunks.
+   * 
+   * @param worker Worker index
+   * @param nanoseconds Time spent executing the chunk
+   */
+  void measure(const size_type worker, const uint64_t nanoseconds) { _samples[worker].nanoseconds += nanoseconds; }
+
+  /**
+   * @brief Updates the chunk size from the time measured during the last execution of the loop.
+   * 
+   * The cost of an entity is smoothed over the executions, and the chunk size is chosen so a chunk
+   * takes about the chunk duration while every worker still has a few chunks to balance the load.
+   * The chunk size is a power of two inside the bounds, and only changes once the ideal size is off
+   * by more than a factor of two, so a stable loop keeps the same chunks (and the same cache affinity).
+   * 
+   * Does nothing if tuning is disabled.
+   * 
+   * @param entities Amount of entities the loop iterated
+   */
+  void tune(const size_type entities)
+  {
+    uint64_t nanoseconds = 0;
+
+    for (auto& sample : _samples)
+    {
+      nanoseconds += sample.nanoseconds;
+      sample.nanoseconds = 0;
+    }
+
+    if (!tuning() || entities == 0) return;
+
+    const double cost = static_cast<double>(nanoseconds) / static_cast<double>(entities);
+
+    _statistics.executions++;
+    _statistics.entities = entities;
+    _statistics.nanoseconds = nanoseconds;
+    _statistics.cost = _statistics.executions == 1 ? cost : _statistics.cost * 0.75 + cost * 0.25;
+
+    // Keep atleast four chunks per worker for stealing to correct imbalance
+    const double balanced = static_cast<double>(entities) / static_cast<double>(_samples.size() * 4);
+
+    double ideal = _statistics.cost > 0 ? static_cast<double>(_chunk_duration) / _statistics.cost : balanced;
+    ideal = std::min(ideal, balanced);
+
+    const double current = static_cast<double>(_chunk_size);
+
+    if (ideal >= current * 0.5 && ideal < current * 2) return;
+
+    size_type chunk_size = 1;
+
+    while (chunk_size * 2 <= ideal) chunk_size *= 2;
+
+    chunk_size = std::clamp(chunk_size, _min_chunk_size, _max_chunk_size);
+
+    if (chunk_size != _chunk_size)
+    {
+      _chunk_size = chunk_size;
+
+      _statistics.chunk_size = chunk_size;
+      _statistics.adjustments++;
+    }
+  }
+
+  /**
+   * @brief Returns the first chunk slot assigned to the worker.
+   * 
+   * @param worker Worker index
+   * @return size_type First chunk slot of the worker
+   */
+  [[nodiscard]] size_type begin(const size_type worker) const { return _bounds[worker]; }
+
+  /**
+   * @brief Returns one past the last chunk slot assigned to the worker.
+   * 
+   * @param worker Worker index
+   * @return size_type One past the last chunk slot of the worker
+   */
+  [[nodiscard]] size_type end(const size_type worker) const { return _bounds[worker + 1]; }
+
+  /**
+   * @brief Returns the chunk to execute for a slot.
+   * 
+   * With affine assignment the slot is the chunk itself.
+   * 
+   * @param slot Chunk slot
+   * @return size_type Chunk index
+   */
+  [[nodiscard]] size_type chunk(const size_type slot) const { return _order[slot]; }
+
+  /**
+   * @brief Returns the amount of entities per chunk.
+   * 
+   * @return size_type Amount of entities per chunk
+   */
+  [[nodiscard]] size_type chunk_size() const { return _chunk_size; }
+
+  /**
+   * @brief Sets the amount of entities per chunk.
+   * 
+   * @param chunk_size Amount of entities per chunk
+   */
+  void chunk_size(const size_type chunk_size)
+  {
+    _chunk_size = chunk_size ? chunk_size : 1;
+    _statistics.chunk_size = _chunk_size;
+  }
+
+  /**
+   * @brief Returns whether or not the chunk size is tuned automatically.
+   * 
+   * Deterministic loops are never tuned.
+   * 
+   * @return true If the chunk size is tuned
+   */
+  [[nodiscard]] bool tuning() const { return _tuning && !_deterministic; }
+
+  /**
+   * @brief Sets whether or not the chunk size is tuned automatically.
+   * 
+   * The current chunk size is used as the starting point.
+   * 
+   * @param tuning Whether or not to tune the chunk size
+   */
+  void tuning(const bool tuning) { _tuning = tuning; }
+
+  /**
+   * @brief Sets the bounds of the tuned chunk size.
+   * 
+   * @param min Minimum amount of entities per chunk
+   * @param max Maximum amount of entities per chunk
+   */
+  void bounds(const size_type min, const size_type max)
+  {
+    _min_chunk_size = min ? min : 1;
+    _max_chunk_size = max > _min_chunk_size ? max : _min_chunk_size;
+  }
+
+  /**
+   * @brief Sets the amount of time a chunk should take when the chunk size is tuned.
+   * 
+   * @param nanoseconds Duration of a chunk in nanoseconds
+   */
+  void chunk_duration(const uint64_t nanoseconds) { _chunk_duration = nanoseconds ? nanoseconds : 1; }
+
+  /**
+   * @brief Returns the statistics of the chunk size tuning.
+   * 
+   * @return const loop_statistics& Tuning statistics
+   */
+  [[nodiscard]] const loop_statistics& statistics() const { return _statistics; }
+
+  /**
+   * @brief Returns the assignment policy of the loop.
+   * 
+   * @return assignment The assignment policy
+   */
+  [[nodiscard]] assignment policy() const { return _policy; }
+
+  /**
+   * @brief Sets the assignment policy of the loop.
+   * 
+   * @param policy The assignment policy
+   */
+  void policy(const assignment policy) { _policy = policy; }
+
+  /**
+   * @brief Returns whether or not the chunk boundaries of the loop are deterministic.
+   * 
+   * @return true If the loop is deterministic
+   */
+  [[nodiscard]] bool deterministic() const { return _deterministic; }
+
+  /**
+   * @brief Sets whether or not the chunk boundaries of the loop are deterministic.
+   * 
+   * Chunk boundaries of a deterministic loop only depend on the chunk size and the size of
+   * storages, never on the amount of workers or on timings. The chunk size of a deterministic
+   * loop is never changed automatically.
+   * 
+   * @param deterministic Whether or not the loop is deterministic
+   */
+  void deterministic(const bool deterministic) { _deterministic = deterministic; }
+
+private:
+  /**
+   * @brief Time spent by a worker in chunks, aligned so workers never share a cache line.
+   */
+  struct alignas(64) sample
+  {
+    uint64_t nanoseconds = 0;
+  };
+
+private:
+  std::vector<size_type> _bounds;
+  std::vector<uint32_t> _order;
+
+  size_type _chunks;
+  size_type _chunk_size;
+
+  assignment _policy;
+  uint32_t _seed;
+  bool _deterministic;
+
+  bool _tuning;
+  size_type _min_chunk_size;
+  size_type _max_chunk_size;
+  uint64_t _chunk_duration;
+  std::vector<sample> _samples;
+  loop_statistics _statistics;
+};
+
+/**
+ * @brief Combines values with a fixed-shape binary tree.
+ * 
+ * Values are combined pairwise, neighbours first, then neighbours of the results and so on.
+ * The shape of the tree only depends on the amount of values, so the result is always the
+ * same for the same values, even for non-associative operations (floating-point addition).
+ * 
+ * The values are combined in place.
+ * 
+ * @warning There must be atleast one value.
+ * 
+ * @tparam Type Value type
+ * @tparam Reduce Binary operation type
+ * @param values Values to combine
+ * @param reduce Binary operation used to combine two values
+ * @return Type Combined value
+ */
+template<typename Type, typename Reduce>
+Type tree_reduce(std::vector<Type>& values, const Reduce& reduce)
+{
+  const size_t count = values.size();
+
+  for (size_t stride = 1; stride < count; stride *= 2)
+  {
+    for (size_t i = 0; i + stride < count; i += 2 * stride)
+    {
+      values[i] = reduce(std::move(values[i]), std::move(values[i + stride]));
+    }
+  }
+
+  return std::move(values[0]);
+}
+
+/**
+ * @brief Pool of worker threads used to execute parallel loops.
+ * 
+ * The scheduler is a fork-join pool. The thread that starts a parallel loop participates as the
+ * first worker and returns once every chunk has been executed.
+ * 
+ * Every worker owns a contiguous range of chunks given by the loop state. Workers take chunks from
+ * the front of their own range and, once it is empty, steal chunks from the back of the ranges of
+ * other workers. Stealing from the back keeps the chunks that are stolen as far as possible from the
+ * ones the owner is about to process.
+ * 
+ * Worker threads can be pinned to cores, this way a worker, and therefore the chunks it owns,
+ * always stays on the same core (only supported on linux, ignored elsewhere).
+ * 
+ * Independent tasks can also be submitted to the scheduler, idle workers execute them in
+ * submission order. This is what allows the scheduler to be used by senders.
+ * 
+ * @warning Parallel loops must always be started from the same thread, and never from a task.
+ */
+class scheduler final
+{
+public:
+  using size_type = size_t;
+
+  /**
+   * @brief Intrusive task that can be submitted to the scheduler.
+   * 
+   * Tasks are not owned by the scheduler, they must stay alive until they are executed.
+   */
+  struct task
+  {
+    void (*execute)(task*);
+    task* next;
+  };
+
+private:
+  /**
+   * @brief Range of chunk slots owned by a worker.
+   * 
+   * The begining and end are packed in a single atomic so that the owner and thieves
+   * can both take chunks without locks. Aligned to avoid false sharing.
+   */
+  struct alignas(64) range
+  {
+    std::atomic<uint64_t> bounds;
+  };
+
+  /**
+   * @brief Type erased parallel loop.
+   */
+  struct job
+  {
+    void (*invoke)(const void*, size_type, size_type);
+    const void* callable;
+    const loop_state* state;
+  };
+
+public:
+  /**
+   * @brief Construct a new scheduler object
+   * 
+   * Workers are given cpus node by node, so consecutive workers are on the same NUMA node. Since
+   * affine loops give consecutive ranges of chunks to consecutive workers, the chunks of a node
+   * are always processed by the workers of that node (see basic_view::place).
+   * 
+   * @param workers Amount of workers including the calling thread (hardware concurrency by default)
+   * @param pin Whether or not worker threads are pinned to cores
+   */
+  explicit scheduler(size_type workers = std::thread::hardware_concurrency(), const bool pin = true)
+    : _id(next_id()), _workers(workers ? workers : 1), _ranges(new range[_workers]), _job(), _head(NULL), _tail(NULL), _generation(0), _pending(0), _stop(false)
+  {
+    const auto& topology = numa_topology::system();
+
+    _cpus.reserve(_workers);
+    _nodes.reserve(_workers);
+
+    for (size_type i = 0; i < _workers; i++)
+    {
+      _cpus.push_back(topology.cpus()[i % topology.cpus().size()]);
+      _nodes.push_back(topology.node(_cpus.back()));
+    }
+
+    _threads.reserve(_workers - 1);
+
+    for (size_type i = 1; i < _workers; i++)
+    {
+      _threads.emplace_back([this, i]()
+        { work(i); });
+
+      if (pin) this->pin(_threads.back(), _cpus[i]);
+    }
+  }
+
+  /**
+   * @brief Destroy the scheduler object
+   * 
+   * Joins all worker threads.
+   */
+  ~scheduler()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+
+    _wake.notify_all();
+
+    for (auto& thread : _threads) thread.join();
+  }
+
+  scheduler(const scheduler&) = delete;
+  scheduler(scheduler&&) = delete;
+  scheduler& operator=(const scheduler&) = delete;
+  scheduler& operator=(scheduler&&) = delete;
+
+  /**
+   * @brief Executes the callable for every chunk in parallel.
+   * 
+   * Blocks until all chunks have been executed. The callable is invoked with the index
+   * of the worker and the index of the chunk.
+   * 
+   * @tparam Callable Callable type
+   * @param chunks Amount of chunks
+   * @param state Persistent state of the loop
+   * @param callable Callable to invoke for every chunk
+   */
+  template<typename Callable>
+  void parallel_for(const size_type chunks, loop_state& state, const Callable& callable)
+  {
+    if (chunks == 0) return;
+
+    state.assign(chunks, _workers);
+
+    for (size_type i = 0; i < _workers; i++)
+    {
+      _ranges[i].bounds.store(pack(state.begin(i), state.end(i)), std::memory_order_relaxed);
+    }
+
+    _job = { [](const void* ptr, const size_type worker, const size_type chunk)
+      { (*static_cast<const Callable*>(ptr))(worker, chunk); },
+      &callable,
+      &state };
+
+    if (!_threads.empty())
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending = _threads.size();
+        ++_generation;
+      }
+
+      _wake.notify_all();
+    }
+
+    run(0);
+
+    if (!_threads.empty())
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _done.wait(lock, [this]()
+        { return _pending == 0; });
+    }
+  }
+
+  /**
+   * @brief Executes the callable for every chunk in parallel.
+   * 
+   * Uses a temporary loop state, so chunks are evenly split between workers.
+   * 
+   * @tparam Callable Callable type
+   * @param chunks Amount of chunks
+   * @param callable Callable to invoke for every chunk
+   */
+  template<typename Callable>
+  void parallel_for(const size_type chunks, const Callable& callable)
+  {
+    loop_state state;
+    parallel_for(chunks, state, callable);
+  }
+
+  /**
+   * @brief Submits a task to be executed by a worker thread.
+   * 
+   * Tasks are executed in submission order. If the scheduler has no worker threads,
+   * the task is executed immediately on the calling thread.
+   * 
+   * This method is thread-safe.
+   * 
+   * @param task Task to execute
+   */
+  void submit(task* task)
+  {
+    if (_threads.empty())
+    {
+      task->execute(task);
+      return;
+    }
+
+    task->next = NULL;
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+
+      if (_tail) _tail->next = task;
+      else
+        _head = task;
+
+      _tail = task;
+    }
+
+    _wake.notify_one();
+  }
+
+  /**
+   * @brief Returns the identifier of the scheduler.
+   * 
+   * Unlike addresses, identifiers are never reused by other schedulers (see loop_states).
+   * 
+   * @return uint64_t Identifier of the scheduler
+   */
+  [[nodiscard]] uint64_t id() const { return _id; }
+
+  /**
+   * @brief Returns the amount of workers, including the thread that starts loops.
+   * 
+   * @return size_type Amount of workers
+   */
+  [[nodiscard]] size_type workers() const { return _workers; }
+
+  /**
+   * @brief Returns the NUMA node of a worker.
+   * 
+   * @param worker Worker index
+   * @return size_type Node of the worker
+   */
+  [[nodiscard]] size_type node(const size_type worker) const { return _nodes[worker]; }
+
+private:
+  /**
+   * @brief Returns a new scheduler identifier.
+   * 
+   * @return uint64_t Identifier that was never returned before
+   */
+  static uint64_t next_id()
+  {
+    static std::atomic<uint64_t> ids { 0 };
+
+    return ids.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  static constexpr uint64_t pack(const size_type begin, const size_type end)
+  {
+    return static_cast<uint64_t>(begin) | (static_cast<uint64_t>(end) << 32);
+  }
+
+  /**
+   * @brief Takes a chunk slot from the front of a range.
+   * 
+   * @param worker Owner of the range
+   * @param slot Taken slot
+   * @return true If a slot was taken, false if the range is empty
+   */
+  bool pop_front(const size_type worker, size_type& slot)
+  {
+    auto& bounds = _ranges[worker].bounds;
+    uint64_t current = bounds.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+      const auto begin = current & 0xFFFFFFFF, end = current >> 32;
+
+      if (begin >= end) return false;
+
+      if (bounds.compare_exchange_weak(current, pack(begin + 1, end), std::memory_order_relaxed))
+      {
+        slot = begin;
+        return true;
+      }
+    }
+  }
+
+  /**
+   * @brief Takes a chunk slot from the back of a range.
+   * 
+   * @param victim Owner of the range
+   * @param slot Taken slot
+   * @return true If a slot was taken, false if the range is empty
+   */
+  bool pop_back(const size_type victim, size_type& slot)
+  {
+    auto& bounds = _ranges[victim].bounds;
+    uint64_t current = bounds.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+      const auto begin = current & 0xFFFFFFFF, end = current >> 32;
+
+      if (begin >= end) return false;
+
+      if (bounds.compare_exchange_weak(current, pack(begin, end - 1), std::memory_order_relaxed))
+      {
+        slot = end - 1;
+        return true;
+      }
+    }
+  }
+
+  /**
+   * @brief Executes the current job as the specified worker.
+   * 
+   * @param worker Worker index
+   */
+  void run(const size_type worker)
+  {
+    const job current = _job;
+    size_type slot;
+
+    while (pop_front(worker, slot)) current.invoke(current.callable, worker, current.state->chunk(slot));
+
+    // Steal from workers of the same node first, their chunks are in local memory
+    for (size_type i = 1; i < _workers; i++)
+    {
+      const auto victim = (worker + i) % _workers;
+
+      if (_nodes[victim] != _nodes[worker]) continue;
+
+      while (pop_back(victim, slot)) current.invoke(current.callable, worker, current.state->chunk(slot));
+    }
+
+    for (size_type i = 1; i < _workers; i++)
+    {
+      const auto victim = (worker + i) % _workers;
+
+      while (pop_back(victim, slot)) current.invoke(current.callable, worker, current.state->chunk(slot));
+    }
+  }
+
+  /**
+   * @brief Main loop of worker threads.
+   * 
+   * Parallel loops have priority over tasks since a thread is waiting for them. Remaining
+   * tasks are still executed when the scheduler is stopped.
+   * 
+   * @param worker Worker index
+   */
+  void work(const size_type worker)
+  {
+    size_type generation = 0;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (true)
+    {
+      _wake.wait(lock, [&]()
+        { return _stop || _head || _generation != generation; });
+
+      if (_generation != generation)
+      {
+        generation = _generation;
+
+        lock.unlock();
+        run(worker);
+        lock.lock();
+
+        if (--_pending == 0) _done.notify_one();
+      }
+      else if (_head)
+      {
+        task* current = _head;
+
+        _head = current->next;
+        if (!_head) _tail = NULL;
+
+        lock.unlock();
+        current->execute(current);
+        lock.lock();
+      }
+      else
+        return; // Stopped
+    }
+  }
+
+  /**
+   * @brief Pins a worker thread to a core.
+   * 
+   * @param thread Worker thread
+   * @param cpu Core to pin to
+   */
+  static void pin(std::thread& thread, const size_type cpu)
+  {
+#if defined(__linux__)
+    if (cpu >= CPU_SETSIZE) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set);
+#else
+    (void)thread; // Suppress unused warning
+    (void)cpu;
+#endif
+  }
+
+private:
+  const uint64_t _id;
+  size_type _workers;
+  std::unique_ptr<range[]> _ranges;
+  std::vector<std::thread> _threads;
+  std::vector<size_type> _cpus;
+  std::vector<size_type> _nodes;
+
+  job _job;
+
+  task* _head;
+  task* _tail;
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _done;
+  size_type _generation;
+  size_type _pending;
+  bool _stop;
+};
+
+/**
+ * @brief Persistent states of the parallel loop sites of an owner (usually a registry).
+ * 
+ * Loop sites are identified by a type (usually the view and the callable) and by the scheduler they
+ * run on, the state of a site is created the first time it is requested. States are destroyed with
+ * their owner and schedulers are identified by their id, so an owner or a scheduler created at the
+ * address of a destroyed one never gets its tuned states.
+ * 
+ * This class is thread-safe, but a state must only be used by one loop at a time.
+ */
+class loop_states final
+{
+public:
+  /**
+   * @brief Construct a new loop states object
+   */
+  loop_states() = default;
+
+  loop_states(const loop_states&) = delete;
+  loop_states(loop_states&&) = delete;
+  loop_states& operator=(const loop_states&) = delete;
+  loop_states& operator=(loop_states&&) = delete;
+
+  /**
+   * @brief Returns the persistent state of a parallel loop site.
+   * 
+   * @tparam Site Type identifying the loop site
+   * @param scheduler Scheduler the loop runs on
+   * @return loop_state& Persistent state of the loop site
+   */
+  template<typename Site>
+  loop_state& state(const scheduler& scheduler)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _states[{ scheduler.id(), &site_key<Site> }];
+  }
+
+private:
+  template<typename Site>
+  static inline const char site_key = 0;
+
+private:
+  std::map<std::pair<uint64_t, const void*>, loop_state> _states;
+  std::mutex _mutex;
+};
+} // namespace xecs
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef XECS_SPARSE_STORAGE_HPP
+#define XECS_SPARSE_STORAGE_HPP
+
+#include "policy.hpp"
+#include "storage.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace xecs
+{
+/**
+ * @brief Sparse set of a single component, for components that are added and removed all the time.
+ * 
+ * Components like OnFire or Selected are toggled constantly. In an archetype, every toggle moves the
+ * entity and all its components to another storage (see swap_archetype), and every combination of
+ * toggled components needs its own archetype. Components listed in the sparse_components of the policy
+ * are stored here instead, outside of the archetypes: adding or removing them is O(1) and never moves
+ * the other components of the entity.
+ * 
+ * The sparse set uses the same entity identifiers as the registry, its index is the sparse array type
+ * of the policy (so it is paged for concurrent policies and uses small indexes for bounded policies).
+ * 
+ * @tparam Entity unsigned integer entity identifier to store
+ * @tparam Component Component type to store
+ * @tparam Policy compile-time configuration (see default_policy)
+ */
+template<typename Entity, typename Component, typename Policy = default_policy>
+class sparse_storage final
+{
+public:
+  using entity_type = Entity;
+  using component_type = Component;
+  using size_type = size_t;
+
+private:
+  using sparse_array_type = typename Policy::template sparse_type<Entity>;
+  using index_type = typename sparse_array_type::index_type;
+
+  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
+    "Entity type must be an unsigned integer");
+
+public:
+  /**
+   * @brief Construct a new sparse storage object
+   */
+  sparse_storage() = default;
+
+  sparse_storage(const sparse_storage&) = delete;
+  sparse_storage(sparse_storage&&) = delete;
+  sparse_storage& operator=(const sparse_storage&) = delete;
+  sparse_storage& operator=(sparse_storage&&) = delete;
+
+  /**
+   * @brief Inserts the component of an entity.
+   * 
+   * @warning Undefined behaviour if the entity already has the component.
+   * 
+   * @param entity Entity to insert
+   * @param component Component of the entity
+   */
+  void insert(const entity_type entity, const Component& component)
+  {
+    assert(_dense.size() <= sparse_array_type::max_index && "Too many entities for the index type of the sparse array");
+
+    _sparse.assure(entity);
+    _sparse[entity] = static_cast<index_type>(_dense.size());
+
+    _dense.push_back(entity);
+    _components.push_back(component);
+  }
+
+  /**
+   * @brief Erases the component of an entity, the last component takes its place.
+   * 
+   * @warning Undefined behaviour if the entity does not have the component.
+   * 
+   * @param entity Entity to erase
+   */
+  void erase(const entity_type entity)
+  {
+    const size_type index = _sparse[entity];
+    const entity_type back_entity = _dense.back();
+
+    _dense[index] = back_entity;
+    _components[index] = std::move(_components.back());
+    _sparse[back_entity] = static_cast<index_type>(index);
+
+    _dense.pop_back();
+    _components.pop_back();
+  }
+
+  /**
+   * @brief Returns whether or not an entity has the component.
+   * 
+   * @param entity Entity to check
+   * @return true If the entity has the component, false otherwise
+   */
+  [[nodiscard]] bool contains(const entity_type entity) const
+  {
+    size_type index;
+
+    return entity < _sparse.capacity() && (index = _sparse[entity]) < _dense.size() && _dense[index] == entity;
+  }
+
+  /**
+   * @brief Returns the component of an entity.
+   * 
+   * @warning Undefined behaviour if the entity does not have the component.
+   * 
+   * @param entity Entity to unpack the component of
+   * @return Component& Component of the entity
+   */
+  [[nodiscard]] Component& unpack(const entity_type entity) { return _components[_sparse[entity]]; }
+
+  /*! @copydoc unpack */
+  [[nodiscard]] const Component& unpack(const entity_type entity) const { return _components[_sparse[entity]]; }
+
+  /**
+   * @brief Calls the given function with every entity and its component, in dense order.
+   * 
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every entity
+   */
+  template<typename Callable>
+  void for_each(const Callable& callable)
+  {
+    for (size_type i = 0; i < _dense.size(); i++) callable(_dense[i], _components[i]);
+  }
+
+  /**
+   * @brief Copies every component of another sparse storage.
+   * 
+   * @param other Sparse storage to copy
+   */
+  void assign(const sparse_storage& other)
+  {
+    _dense = other._dense;
+    _components = other._components;
+
+    index();
+  }
+
+  /**
+   * @brief Gives new identifiers to every entity (see storage::renumber).
+   * 
+   * @param table Table of new identifiers indexed by old identifier
+   * @param count Amount of identifiers in use after renumbering, the index is shrunk to fit them
+   */
+  void renumber(const entity_type* table, const entity_type count)
+  {
+    for (auto& entity : _dense) entity = table[entity];
+
+    _sparse.shrink(count);
+
+    index();
+  }
+
+  /**
+   * @brief Erases every component.
+   */
+  void clear()
+  {
+    _dense.clear();
+    _components.clear();
+  }
+
+  /**
+   * @brief Returns the amount of entities that have the component.
+   * 
+   * @return size_type Amount of entities
+   */
+  [[nodiscard]] size_type size() const { return _dense.size(); }
+
+  /**
+   * @brief Returns whether or not no entity has the component.
+   * 
+   * @return true If the storage is empty, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return _dense.empty(); }
+
+private:
+  /**
+   * @brief Points the index of every entity to its position in the dense array.
+   */
+  void index()
+  {
+    for (size_type i = 0; i < _dense.size(); i++)
+    {
+      _sparse.assure(_dense[i]);
+      _sparse[_dense[i]] = static_cast<index_type>(i);
+    }
+  }
+
+private:
+  sparse_array_type _sparse;
+  std::vector<entity_type> _dense;
+  std::vector<Component> _components;
+};
+} // namespace xecs
+
+#endif
@@ -1,16 +1,31 @@
 #ifndef XECS_STORAGE_HPP
 #define XECS_STORAGE_HPP
 
+#include "access.hpp"
 #include "archetype.hpp"
-
+#include "buffer.hpp"
+#include "computed.hpp"
+#include "cow_memory.hpp"
+#include "epoch.hpp"
+#include "index.hpp"
+#include "numa.hpp"
+#include "policy.hpp"
+#include "zone.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace xecs
 {
@@ -29,34 +44,44 @@ namespace xecs
  * Paging is not nessesary here because if implmented correctly there should only be one sparse_array
  * per entity_manager.
  * 
+ * The indexes are dense indexes, so they only need to be as large as the largest storage, not as large
+ * as the entity identifiers. A smaller index type makes the array (and lookups) proportionally smaller.
+ * 
  * @tparam Entity unsigned int entity identifier
+ * @tparam Index unsigned int index type (entity type by default)
  */
-template<typename Entity>
+template<typename Entity, typename Index>
 class sparse_array final
 {
 public:
   using entity_type = Entity;
+  using index_type = Index;
   using size_type = size_t;
-  using array_type = entity_type*;
+  using array_type = index_type*;
   using shared_count_type = uint16_t;
 
   static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
     "Entity type must be an unsigned integer");
 
+  static_assert(std::numeric_limits<index_type>::is_integer && !std::numeric_limits<index_type>::is_signed,
+    "Index type must be an unsigned integer");
+
+  /**
+   * @brief Largest index that can be stored.
+   */
+  static constexpr size_type max_index = std::numeric_limits<index_type>::max();
+
   /**
    * @brief Construct a new sparse array object
    */
   sparse_array()
-    : _array(NULL), _capacity(0), _shared(0)
+    : _array(NULL), _capacity(0), _shared(0), _mapped(false)
   {}
 
   /**
    * @brief Destroy the sparse array object
    */
-  ~sparse_array()
-  {
-    if (_array) free(_array);
-  }
+  ~sparse_array() { deallocate(_capacity); }
 
   sparse_array(const sparse_array&) = delete;
   sparse_array(sparse_array&&) = delete;
@@ -75,12 +100,14 @@ public:
   {
     if (entity >= _capacity)
     {
-      const auto linear = entity + (1024 / sizeof(entity_type)); // 1kb
+      const auto linear = entity + (1024 / sizeof(index_type)); // 1kb
       const auto exponential = _capacity << 1; // Double capacity
 
+      const size_type previous = _capacity;
+
       _capacity = entity >= exponential ? linear : exponential;
 
-      _array = static_cast<array_type>(std::realloc(_array, _capacity * sizeof(entity_type)));
+      reallocate(previous);
     }
   }
 
@@ -90,10 +117,10 @@ public:
    * @param page Page index
    * @return page_type Array of indexes
    */
-  entity_type operator[](const entity_type entity) const { return _array[entity]; }
+  index_type operator[](const entity_type entity) const { return _array[entity]; }
 
   /*! @copydoc operator[] */
-  entity_type& operator[](const entity_type entity) { return _array[entity]; }
+  index_type& operator[](const entity_type entity) { return _array[entity]; }
 
   /**
    * @brief Returns the capacity of the sparse_array.
@@ -105,6 +132,59 @@ public:
    */
   size_type capacity() const { return _capacity; }
 
+  /**
+   * @brief Shrinks the sparse_array so that it only contains entities smaller than the specified capacity.
+   * 
+   * Does nothing if the sparse_array is already smaller.
+   * 
+   * @param capacity New capacity of the sparse_array
+   */
+  void shrink(const size_type capacity)
+  {
+    if (capacity >= _capacity) return;
+
+    const size_type previous = _capacity;
+
+    _capacity = capacity;
+
+    if (_capacity == 0)
+    {
+      deallocate(previous);
+      _array = NULL;
+    }
+    else
+      reallocate(previous);
+  }
+
+  /**
+   * @brief Makes an empty sparse_array a copy-on-write fork of this sparse_array.
+   * 
+   * Large arrays are shared page by page until they are written (see cow_memory), small arrays are copied.
+   * The array is allocated with realloc until it is first forked, the first fork moves it to memory that can
+   * be shared and costs as much as a copy.
+   * 
+   * @param fork Sparse array to make a fork of this sparse_array
+   */
+  void fork(sparse_array& fork)
+  {
+    assert(fork._capacity == 0 && "Sparse array to fork into is not empty");
+
+    const size_type size = _capacity * sizeof(index_type);
+
+    if (!_mapped) _mapped = cow_memory::share(_array, size);
+
+    if (_mapped) fork._array = static_cast<array_type>(cow_memory::duplicate(_array, size));
+    else
+    {
+      fork._array = static_cast<array_type>(std::malloc(size));
+
+      if (_array) std::memcpy(fork._array, _array, size);
+    }
+
+    fork._capacity = _capacity;
+    fork._mapped = _mapped;
+  }
+
   /**
    * @brief Signals that a storage is sharing this sparse_array
    */
@@ -121,344 +201,2804 @@ public:
    */
   shared_count_type shared() const { return _shared; }
 
+private:
+  /**
+   * @brief Resizes the array from the previous capacity to the current capacity.
+   * 
+   * @param previous Capacity of the array
+   */
+  void reallocate(const size_type previous)
+  {
+    if (_mapped) _array = static_cast<array_type>(cow_memory::reallocate(_array, previous * sizeof(index_type), _capacity * sizeof(index_type)));
+    else
+      _array = static_cast<array_type>(std::realloc(_array, _capacity * sizeof(index_type)));
+  }
+
+  /**
+   * @brief Frees the array.
+   * 
+   * @param capacity Capacity of the array
+   */
+  void deallocate(const size_type capacity)
+  {
+    if (_mapped) cow_memory::deallocate(_array, capacity * sizeof(index_type));
+    else
+      free(_array);
+  }
+
 private:
   array_type _array;
   size_type _capacity;
   shared_count_type _shared;
+  bool _mapped;
 };
 
 /**
- * @brief Collection of entites of an archetype and its components.
- * 
- * The storage is essentially a sparse set fine-tuned for our needs. This is not a general
- * purpose sparse set.
- * 
- * Sparse sets are a well documented data structure. Basically, it allows us to have very fast O(1) random insertion,
- * deletion and much more. But most importantly, our data is stored contigioustly in memory, so we can iterate
- * on it as fast as you can a vector.
- * 
- * Sparse sets work by having two arrays, a densly packed one and the sparse one (sparse_array). The sparse array 
- * is used access data with a level of indirection and is used to make operations like insert and erase O(1). The
- * dense array is what we iterate on and it is always densly packed. For more information on a sparse set just look it
- * up, its very widely used.
- * 
- * Our storage is built on top of a sparse set and allows us to store all the components of an archetype.
- * So instead of having one sparse set per component, we have one sparse set per archetype. This means that all the
- * components of an archetype are stored in the correct order. This is a huge part of our ecs implementation,
- * this allows us to always iterate on multiple components perfectly contiguously without any holes or branching checks.
- * There is very little extra cost for iterating over more than one component.
- * 
- * @note Supports storing non-trivial types, however this is not recommended for performance.
+ * @brief Sparse array that stores indexes in a fixed amount of bytes.
  * 
- * @warning Order is never guaranted.
+ * Same as the sparse_array, but every index takes exactly Bytes bytes, which allows index sizes
+ * that are not a native integer size. With three bytes, 16 million entities per storage can be
+ * indexed while taking 25% less memory than 32 bit indexes.
  * 
- * @tparam Entity unsigned integer entity identifier to store
- * @tparam Archetype list of components to store
+ * @tparam Entity unsigned int entity identifier
+ * @tparam Bytes Amount of bytes of every index (at most 8)
  */
-template<typename Entity, typename Archetype>
-class storage;
-
-template<typename Entity, typename... Components>
-class storage<Entity, archetype<Components...>> final
+template<typename Entity, size_t Bytes>
+class packed_sparse_array final
 {
 public:
   using entity_type = Entity;
+  using index_type = std::conditional_t<(Bytes <= sizeof(uint32_t)), uint32_t, uint64_t>;
   using size_type = size_t;
-
-  template<typename Component>
-  static constexpr bool contains_component = contains_v<Component, list<Components...>>;
-
-private:
-  using dense_type = entity_type*;
-  using page_type = entity_type*;
-  using sparse_type = sparse_array<Entity>*;
-  using component_pool_type = std::tuple<Components*...>;
+  using shared_count_type = uint16_t;
 
   static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
     "Entity type must be an unsigned integer");
 
-public:
-  class iterator;
+  static_assert(Bytes > 0 && Bytes <= sizeof(uint64_t), "Indexes must be between 1 and 8 bytes");
 
   /**
-   * @brief Construct a new storage object
+   * @brief Largest index that can be stored.
    */
-  storage()
-    : _dense(NULL), _size(0), _capacity(0)
-  {
-    // Uses new, but normally when using shared sparse arrays it will be allocated on the stack
-    _sparse = new sparse_array<entity_type>();
-
-    // Allocate nothing by default
-    ((access<Components>() = NULL), ...);
-  }
+  static constexpr size_type max_index = Bytes == sizeof(uint64_t) ? std::numeric_limits<uint64_t>::max()
+                                                                   : (uint64_t { 1 } << (Bytes * 8)) - 1;
 
   /**
-   * @brief Destroy the storage object
+   * @brief Reference to an index of the array.
+   * 
+   * Reads and writes the bytes of the index.
    */
-  ~storage()
+  class reference
   {
-    // We only manage our sparse_array memory if its not shared
-    if (_sparse->shared()) _sparse->unshare();
-    else
-      delete _sparse;
+  public:
+    explicit reference(unsigned char* bytes) : _bytes(bytes) {}
 
-    // We assume that if dense is NULL, the other arrays are NULL since
-    // they grow together.
-    if (_dense)
+    reference(const reference&) = default;
+
+    operator index_type() const { return load(_bytes); }
+
+    reference& operator=(const index_type value)
     {
-      free(_dense);
-      (deallocate<Components>(), ...);
+      for (size_type i = 0; i < Bytes; i++) _bytes[i] = static_cast<unsigned char>(value >> (i * 8));
+
+      return *this;
     }
-  }
 
-  storage(const storage&) = delete;
-  storage(storage&&) = delete;
-  storage& operator=(const storage&) = delete;
-  storage& operator=(storage&&) = delete;
+    reference& operator=(const reference& other) { return *this = static_cast<index_type>(other); }
+
+  private:
+    unsigned char* _bytes;
+  };
 
   /**
-   * @brief Inserts a entity and all its components at once.
+   * @brief Construct a new packed sparse array object
+   */
+  packed_sparse_array()
+    : _array(NULL), _capacity(0), _shared(0), _mapped(false)
+  {}
+
+  /**
+   * @brief Destroy the packed sparse array object
+   */
+  ~packed_sparse_array() { deallocate(_capacity); }
+
+  packed_sparse_array(const packed_sparse_array&) = delete;
+  packed_sparse_array(packed_sparse_array&&) = delete;
+  packed_sparse_array& operator=(const packed_sparse_array&) = delete;
+  packed_sparse_array& operator=(packed_sparse_array&&) = delete;
+
+  /**
+   * @brief Assures that the sparse array can contain the entity.
    * 
-   * Entities are always inserted in the back of the array, however they are not
-   * guarented to stay there, and can be moved around by other operations.
+   * @param entity Entity to assure
+   */
+  void assure(const entity_type entity)
+  {
+    if (entity >= _capacity)
+    {
+      const auto linear = entity + (1024 / Bytes); // 1kb
+      const auto exponential = _capacity << 1; // Double capacity
+
+      const size_type previous = _capacity;
+
+      _capacity = entity >= exponential ? linear : exponential;
+
+      reallocate(previous);
+    }
+  }
+
+  /**
+   * @brief Returns the index for the entity.
    * 
-   * You can directly add the components with this method. However, components will be copied. 
-   * This is not nessesary and can be done later very efficiently using the unpack method. 
-   * Also, the order of the components dont matter, as long as they are all unique and part of the archetype.
+   * @param entity Entity to get the index for
+   * @return index_type Index of the entity
+   */
+  index_type operator[](const entity_type entity) const { return load(_array + static_cast<size_type>(entity) * Bytes); }
+
+  /*! @copydoc operator[] */
+  reference operator[](const entity_type entity) { return reference { _array + static_cast<size_type>(entity) * Bytes }; }
+
+  /**
+   * @brief Returns the capacity of the sparse array.
    * 
-   * This operation is usually O(1) and is pretty cheap. Some insert operations may be slower
-   * if any internal array need a resize.
+   * @return size_type Capacity of the sparse array
+   */
+  size_type capacity() const { return _capacity; }
+
+  /**
+   * @brief Shrinks the sparse array so that it only contains entities smaller than the specified capacity.
    * 
-   * @warning Undefined behaviour if the entity already exists. If you dont know
-   * if the entity exists, call the contains method first.
+   * @param capacity New capacity of the sparse array
+   */
+  void shrink(const size_type capacity)
+  {
+    if (capacity >= _capacity) return;
+
+    const size_type previous = _capacity;
+
+    _capacity = capacity;
+
+    if (_capacity == 0)
+    {
+      deallocate(previous);
+      _array = NULL;
+    }
+    else
+      reallocate(previous);
+  }
+
+  /**
+   * @brief Makes an empty sparse array a copy-on-write fork of this sparse array (see sparse_array::fork).
    * 
-   * @tparam IncludedComponents Types of components to insert with (optional).
-   * @param entity Entity to insert
-   * @param components Components to insert alongside entity
+   * @param fork Sparse array to make a fork of this sparse array
    */
-  template<typename... IncludedComponents>
-  void insert(const entity_type entity, const IncludedComponents&... components)
+  void fork(packed_sparse_array& fork)
   {
-    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
-      "One or more included components do not belong to the archetype");
-    static_assert(unique_types_v<IncludedComponents...>,
-      "Included components are not unique");
+    assert(fork._capacity == 0 && "Sparse array to fork into is not empty");
 
-    if (_size == _capacity) grow();
-    _sparse->assure(entity);
+    const size_type size = _capacity * Bytes;
 
-    _dense[_size] = entity;
+    if (!_mapped) _mapped = cow_memory::share(_array, size);
 
-    // Call the constructors if needed
-    (construct<Components>(_size), ...);
+    if (_mapped) fork._array = static_cast<unsigned char*>(cow_memory::duplicate(_array, size));
+    else
+    {
+      fork._array = static_cast<unsigned char*>(std::malloc(size));
 
-    ((access<IncludedComponents>()[_size] = components), ...);
+      if (_array) std::memcpy(fork._array, _array, size);
+    }
 
-    (*_sparse)[entity] = static_cast<entity_type>(_size++);
+    fork._capacity = _capacity;
+    fork._mapped = _mapped;
   }
 
   /**
-   * @brief Erases an entity from the storage.
-   * 
-   * Erasing entities is essentially just poping an entity from the back of the array and moving
-   * it to the location of the entity to erase.
-   * 
-   * This is a very cheap O(1) operation.
-   * 
-   * @warning Undefined behaviour if the entity does not exist. If you dont know
-   * if the entity exists, call the contains method first.
-   * 
-   * @param entity Entity to erase
+   * @brief Signals that a storage is sharing this sparse array
    */
-  void erase(const entity_type entity)
-  {
-    const auto back_entity = _dense[--_size];
-    const auto index = (*_sparse)[entity];
+  void share() { ++_shared; }
 
-    (*_sparse)[back_entity] = index;
-    _dense[index] = back_entity;
+  /**
+   * @brief Signals that a storage is unsharing this sparse array
+   */
+  void unshare() { --_shared; }
 
-    // Call the destructors if needed
-    (destroy<Components>(index), ...);
+  /**
+   * @brief Returns the amount of storages that are sharing this sparse array
+   * @return shared_count_type Amount of storages that share this sparse array
+   */
+  shared_count_type shared() const { return _shared; }
 
-    // Moves the component data to the new location
-    ((access<Components>()[index] = std::move(access<Components>()[_size])), ...);
+private:
+  static index_type load(const unsigned char* bytes)
+  {
+    index_type value = 0;
+
+    // Compiles to a single load and mask on little endian machines
+    for (size_type i = 0; i < Bytes; i++) value |= static_cast<index_type>(bytes[i]) << (i * 8);
+
+    return value;
   }
 
   /**
-   * @brief Returns whether or not an entity is present in the storage.
+   * @brief Resizes the array from the previous capacity to the current capacity.
    * 
-   * This operation is a very cheap O(1) operation.
+   * @param previous Capacity of the array
+   */
+  void reallocate(const size_type previous)
+  {
+    if (_mapped) _array = static_cast<unsigned char*>(cow_memory::reallocate(_array, previous * Bytes, _capacity * Bytes));
+    else
+      _array = static_cast<unsigned char*>(std::realloc(_array, _capacity * Bytes));
+  }
+
+  /**
+   * @brief Frees the array.
    * 
-   * @param entity Entity to check
-   * @return true If entity is present in storage, false otherwise
+   * @param capacity Capacity of the array
    */
-  bool contains(const entity_type entity) const
+  void deallocate(const size_type capacity)
   {
-    size_type index;
+    if (_mapped) cow_memory::deallocate(_array, capacity * Bytes);
+    else
+      free(_array);
+  }
 
-    // We must access the dense array here because our sparse arrays may be shared, therefor we need
-    // to make sure entity index is valid.
-    return entity < _sparse->capacity() && (index = (*_sparse)[entity]) < _size && _dense[index] == entity;
+private:
+  unsigned char* _array;
+  size_type _capacity;
+  shared_count_type _shared;
+  bool _mapped;
+};
+
+/**
+ * @brief Sparse array that can grow while being used by other threads.
+ * 
+ * Same as the sparse_array, but the indexes are stored in pages of fixed size. Growing
+ * only allocates new pages and never moves existing ones, so references to indexes stay
+ * valid while other threads grow the array.
+ * 
+ * The page directory is replaced when it is full, old directories are kept until the array
+ * is destroyed since other threads may still be reading them. Directories grow exponentially
+ * so this is never more than twice the size of the current directory.
+ * 
+ * Pages are allocated by slabs of consecutive pages, which are shared with forks page by page
+ * once the array is forked (see cow_memory).
+ * 
+ * Indexes are accessed with relaxed atomic operations, this way storages on different
+ * threads can check if they contain any entity without data races.
+ * 
+ * @tparam Entity unsigned int entity identifier
+ * @tparam Index unsigned int index type (entity type by default)
+ */
+template<typename Entity, typename Index>
+class concurrent_sparse_array final
+{
+public:
+  using entity_type = Entity;
+  using index_type = Index;
+  using size_type = size_t;
+  using shared_count_type = uint16_t;
+
+  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
+    "Entity type must be an unsigned integer");
+
+  static_assert(std::numeric_limits<index_type>::is_integer && !std::numeric_limits<index_type>::is_signed,
+    "Index type must be an unsigned integer");
+
+  /**
+   * @brief Largest index that can be stored.
+   */
+  static constexpr size_type max_index = std::numeric_limits<index_type>::max();
+
+  /**
+   * @brief Amount of indexes per page (must be a power of two).
+   */
+  static constexpr size_type page_size = 4096;
+
+  /**
+   * @brief Amount of pages per slab.
+   */
+  static constexpr size_type slab_pages = 16;
+
+private:
+  using slot_type = std::atomic<index_type>;
+  using page_type = slot_type*;
+  using directory_type = page_type*;
+
+  static_assert(std::is_trivially_destructible_v<slot_type>, "Slots of a slab are never destroyed");
+
+  /**
+   * @brief Size of a slab in bytes.
+   */
+  static constexpr size_type slab_size = slab_pages * page_size * sizeof(slot_type);
+
+public:
+  /**
+   * @brief Reference to an index of the array.
+   * 
+   * Reads and writes the index atomically.
+   */
+  class reference
+  {
+  public:
+    explicit reference(slot_type* slot) : _slot(slot) {}
+
+    reference(const reference&) = default;
+
+    operator index_type() const { return _slot->load(std::memory_order_relaxed); }
+
+    reference& operator=(const index_type value)
+    {
+      _slot->store(value, std::memory_order_relaxed);
+      return *this;
+    }
+
+    reference& operator=(const reference& other) { return *this = static_cast<index_type>(other); }
+
+  private:
+    slot_type* _slot;
+  };
+
+  /**
+   * @brief Construct a new concurrent sparse array object
+   */
+  concurrent_sparse_array()
+    : _directory(NULL), _pages(0), _directory_capacity(0), _shared(0), _mapped(false)
+  {}
+
+  /**
+   * @brief Destroy the concurrent sparse array object
+   */
+  ~concurrent_sparse_array()
+  {
+    for (auto slab : _slabs) deallocate(slab);
+
+    delete[] _directory.load(std::memory_order_relaxed);
+
+    for (auto retired : _retired) delete[] retired;
+  }
+
+  concurrent_sparse_array(const concurrent_sparse_array&) = delete;
+  concurrent_sparse_array(concurrent_sparse_array&&) = delete;
+  concurrent_sparse_array& operator=(const concurrent_sparse_array&) = delete;
+  concurrent_sparse_array& operator=(concurrent_sparse_array&&) = delete;
+
+  /**
+   * @brief Assures that the sparse array can contain the entity.
+   * 
+   * If the sparse array cannot contain the entity, new pages are allocated. Only
+   * threads that need to grow the array take a lock.
+   * 
+   * This method is thread-safe.
+   * 
+   * @param entity Entity to assure
+   */
+  void assure(const entity_type entity)
+  {
+    const size_type page = static_cast<size_type>(entity) / page_size;
+
+    if (page < _pages.load(std::memory_order_acquire)) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const size_type pages = _pages.load(std::memory_order_relaxed);
+
+    if (page < pages) return;
+
+    directory_type directory = _directory.load(std::memory_order_relaxed);
+
+    if (page >= _directory_capacity)
+    {
+      const auto exponential = _directory_capacity << 1; // Double capacity
+
+      _directory_capacity = page >= exponential ? page + 16 : exponential;
+
+      directory_type grown = new page_type[_directory_capacity];
+
+      if (directory)
+      {
+        std::memcpy(static_cast<void*>(grown), directory, pages * sizeof(page_type));
+        _retired.push_back(directory);
+      }
+
+      directory = grown;
+      _directory.store(directory, std::memory_order_release);
+    }
+
+    for (size_type i = pages; i <= page; i++)
+    {
+      // Slabs are zero, pages of a slab are zeroed when they are shrunk
+      if (i / slab_pages == _slabs.size())
+      {
+        slot_type* slab = static_cast<slot_type*>(_mapped ? cow_memory::allocate(slab_size) : std::calloc(1, slab_size));
+
+        for (size_type j = 0; j < slab_pages * page_size; j++) new (slab + j) slot_type;
+
+        _slabs.push_back(slab);
+      }
+
+      directory[i] = _slabs[i / slab_pages] + (i % slab_pages) * page_size;
+    }
+
+    _pages.store(page + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Returns the index for the entity.
+   * 
+   * @param entity Entity to get the index for
+   * @return entity_type Index of the entity
+   */
+  index_type operator[](const entity_type entity) const { return reference { slot(entity) }; }
+
+  /*! @copydoc operator[] */
+  reference operator[](const entity_type entity) { return reference { slot(entity) }; }
+
+  /**
+   * @brief Returns the capacity of the sparse array.
+   * 
+   * This method is thread-safe.
+   * 
+   * @return size_type Capacity of the sparse array
+   */
+  size_type capacity() const { return _pages.load(std::memory_order_acquire) * page_size; }
+
+  /**
+   * @brief Frees the pages that are not needed to contain entities smaller than the specified capacity.
+   * 
+   * @warning Not thread-safe, no other thread may use the sparse array.
+   * 
+   * @param capacity New minimum capacity of the sparse array
+   */
+  void shrink(const size_type capacity)
+  {
+    const size_type needed = (capacity + page_size - 1) / page_size;
+    const size_type pages = _pages.load(std::memory_order_relaxed);
+
+    if (needed >= pages) return;
+
+    directory_type directory = _directory.load(std::memory_order_relaxed);
+
+    const size_type slabs = (needed + slab_pages - 1) / slab_pages;
+
+    // Pages of the last slab that is kept are zeroed, the other slabs are freed
+    for (size_type i = needed; i < std::min(pages, slabs * slab_pages); i++)
+    {
+      for (size_type j = 0; j < page_size; j++) directory[i][j].store(0, std::memory_order_relaxed);
+    }
+
+    for (size_type i = slabs; i < _slabs.size(); i++) deallocate(_slabs[i]);
+
+    _slabs.resize(slabs);
+
+    _pages.store(needed, std::memory_order_release);
+  }
+
+  /**
+   * @brief Makes an empty sparse array a copy-on-write fork of this sparse array.
+   * 
+   * Slabs are shared page by page until they are written (see cow_memory), only the page directory is copied.
+   * Slabs are allocated with calloc until the array is first forked, the first fork moves them to memory that
+   * can be shared and costs as much as a copy.
+   * 
+   * @warning Not thread-safe, no other thread may use either sparse array.
+   * 
+   * @param fork Sparse array to make a fork of this sparse array
+   */
+  void fork(concurrent_sparse_array& fork)
+  {
+    assert(fork._pages.load(std::memory_order_relaxed) == 0 && "Sparse array to fork into is not empty");
+
+    const size_type pages = _pages.load(std::memory_order_relaxed);
+
+    if (pages == 0) return;
+
+    if (!_mapped) _mapped = map();
+
+    for (auto slab : _slabs)
+    {
+      if (_mapped) fork._slabs.push_back(static_cast<slot_type*>(cow_memory::duplicate(slab, slab_size)));
+      else
+      {
+        fork._slabs.push_back(static_cast<slot_type*>(std::malloc(slab_size)));
+        std::memcpy(static_cast<void*>(fork._slabs.back()), static_cast<const void*>(slab), slab_size);
+      }
+    }
+
+    directory_type directory = new page_type[_directory_capacity];
+
+    for (size_type i = 0; i < pages; i++) directory[i] = fork._slabs[i / slab_pages] + (i % slab_pages) * page_size;
+
+    fork._mapped = _mapped;
+    fork._directory_capacity = _directory_capacity;
+    fork._directory.store(directory, std::memory_order_relaxed);
+    fork._pages.store(pages, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Signals that a storage is sharing this sparse array
+   */
+  void share() { ++_shared; }
+
+  /**
+   * @brief Signals that a storage is unsharing this sparse array
+   */
+  void unshare() { --_shared; }
+
+  /**
+   * @brief Returns the amount of storages that are sharing this sparse array
+   * @return shared_count_type Amount of storages that share this sparse array
+   */
+  shared_count_type shared() const { return _shared; }
+
+private:
+  slot_type* slot(const entity_type entity) const
+  {
+    return _directory.load(std::memory_order_acquire)[entity / page_size] + (entity & (page_size - 1));
+  }
+
+  /**
+   * @brief Moves every slab to memory that can be shared with forks, and the pages of the directory with them.
+   * 
+   * @return true If every slab was moved, false if they could not all be allocated (they are then all kept)
+   */
+  bool map()
+  {
+    std::vector<slot_type*> slabs;
+
+    for (size_type i = 0; i < _slabs.size(); i++)
+    {
+      slabs.push_back(static_cast<slot_type*>(cow_memory::allocate(slab_size)));
+
+      if (!slabs.back())
+      {
+        slabs.pop_back();
+
+        for (auto slab : slabs) cow_memory::deallocate(slab, slab_size);
+
+        return false;
+      }
+    }
+
+    directory_type directory = _directory.load(std::memory_order_relaxed);
+
+    for (size_type i = 0; i < _pages.load(std::memory_order_relaxed); i++)
+    {
+      directory[i] = slabs[i / slab_pages] + (i % slab_pages) * page_size;
+    }
+
+    for (size_type i = 0; i < _slabs.size(); i++)
+    {
+      std::memcpy(static_cast<void*>(slabs[i]), static_cast<const void*>(_slabs[i]), slab_size);
+      std::free(_slabs[i]);
+    }
+
+    _slabs = std::move(slabs);
+
+    return true;
+  }
+
+  /**
+   * @brief Frees a slab.
+   * 
+   * @param slab Slab to free
+   */
+  void deallocate(slot_type* slab)
+  {
+    if (_mapped) cow_memory::deallocate(slab, slab_size);
+    else
+      std::free(slab);
+  }
+
+private:
+  std::atomic<directory_type> _directory;
+  std::atomic<size_type> _pages;
+  size_type _directory_capacity;
+  std::vector<directory_type> _retired;
+  std::vector<slot_type*> _slabs;
+  std::mutex _mutex;
+  shared_count_type _shared;
+  bool _mapped;
+};
+
+/**
+ * @brief Sparse array whose memory is inline, for registries that never allocate.
+ * 
+ * The array always contains every entity smaller than the maximum, so it never grows. The index type is
+ * the smallest that can store the maximum.
+ * 
+ * @warning Using entities larger than the maximum is undefined behaviour (asserted).
+ * 
+ * @tparam Entity unsigned int entity identifier
+ * @tparam MaxEntities Maximum amount of entity identifiers
+ */
+template<typename Entity, size_t MaxEntities>
+class fixed_sparse_array final
+{
+public:
+  using entity_type = Entity;
+  using index_type = std::conditional_t<(MaxEntities <= (size_t { 1 } << 8)), uint8_t,
+    std::conditional_t<(MaxEntities <= (size_t { 1 } << 16)), uint16_t,
+      std::conditional_t<(MaxEntities <= (size_t { 1 } << 31) * 2), uint32_t, Entity>>>;
+  using size_type = size_t;
+  using shared_count_type = uint16_t;
+
+  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
+    "Entity type must be an unsigned integer");
+
+  static_assert(MaxEntities > 0, "Fixed sparse arrays must contain atleast one entity");
+
+  /**
+   * @brief Largest index that can be stored.
+   */
+  static constexpr size_type max_index = std::numeric_limits<index_type>::max();
+
+  /**
+   * @brief Construct a new fixed sparse array object
+   */
+  fixed_sparse_array()
+    : _array(), _shared(0)
+  {}
+
+  fixed_sparse_array(const fixed_sparse_array&) = delete;
+  fixed_sparse_array(fixed_sparse_array&&) = delete;
+  fixed_sparse_array& operator=(const fixed_sparse_array&) = delete;
+  fixed_sparse_array& operator=(fixed_sparse_array&&) = delete;
+
+  /**
+   * @brief Assures that the sparse array can contain the entity, it always can.
+   * 
+   * @param entity Entity to assure
+   */
+  void assure(const entity_type entity)
+  {
+    assert(entity < MaxEntities && "Entity is larger than the maximum of the fixed sparse array");
+
+    (void)entity; // Suppress unused warning
+  }
+
+  /**
+   * @brief Returns the index of an entity.
+   * 
+   * @param entity Entity to get the index of
+   * @return index_type Index of the entity
+   */
+  index_type operator[](const entity_type entity) const { return _array[entity]; }
+
+  /*! @copydoc operator[] */
+  index_type& operator[](const entity_type entity) { return _array[entity]; }
+
+  /**
+   * @brief Returns the capacity of the sparse_array, the maximum amount of entities.
+   * 
+   * @return size_type Capacity of the sparse_array
+   */
+  size_type capacity() const { return MaxEntities; }
+
+  /**
+   * @brief Does nothing, the memory is inline.
+   * 
+   * @param capacity New capacity of the sparse_array
+   */
+  void shrink(const size_type capacity)
+  {
+    (void)capacity; // Suppress unused warning
+  }
+
+  /**
+   * @brief Makes a sparse array a copy of this sparse array, the memory is inline.
+   * 
+   * @param fork Sparse array to make a copy of this sparse array
+   */
+  void fork(fixed_sparse_array& fork) { std::memcpy(fork._array, _array, sizeof(_array)); }
+
+  /**
+   * @brief Signals that a storage is sharing this sparse_array
+   */
+  void share() { ++_shared; }
+
+  /**
+   * @brief Signals that a storage is no longer sharing this sparse_array
+   */
+  void unshare() { --_shared; }
+
+  /**
+   * @brief Returns the amount of storages sharing this sparse_array.
+   * 
+   * @return shared_count_type Amount of storages
+   */
+  shared_count_type shared() const { return _shared; }
+
+private:
+  index_type _array[MaxEntities];
+  shared_count_type _shared;
+};
+
+/**
+ * @brief Collection of entites of an archetype and its components.
+ * 
+ * The storage is essentially a sparse set fine-tuned for our needs. This is not a general
+ * purpose sparse set.
+ * 
+ * Sparse sets are a well documented data structure. Basically, it allows us to have very fast O(1) random insertion,
+ * deletion and much more. But most importantly, our data is stored contigioustly in memory, so we can iterate
+ * on it as fast as you can a vector.
+ * 
+ * Sparse sets work by having two arrays, a densly packed one and the sparse one (sparse_array). The sparse array 
+ * is used access data with a level of indirection and is used to make operations like insert and erase O(1). The
+ * dense array is what we iterate on and it is always densly packed. For more information on a sparse set just look it
+ * up, its very widely used.
+ * 
+ * Our storage is built on top of a sparse set and allows us to store all the components of an archetype.
+ * So instead of having one sparse set per component, we have one sparse set per archetype. This means that all the
+ * components of an archetype are stored in the correct order. This is a huge part of our ecs implementation,
+ * this allows us to always iterate on multiple components perfectly contiguously without any holes or branching checks.
+ * There is very little extra cost for iterating over more than one component.
+ * 
+ * @note Supports storing non-trivial types, however this is not recommended for performance.
+ * 
+ * @warning Order is never guaranted.
+ * 
+ * @tparam Entity unsigned integer entity identifier to store
+ * @tparam Archetype list of components to store
+ * @tparam Policy compile-time configuration (see default_policy)
+ */
+template<typename Entity, typename Archetype, typename Policy = default_policy>
+class storage;
+
+template<typename Entity, typename... Components, typename Policy>
+class storage<Entity, archetype<Components...>, Policy> final
+{
+public:
+  using entity_type = Entity;
+  using size_type = size_t;
+
+  template<typename Component>
+  static constexpr bool contains_component = contains_v<Component, list<Components...>>;
+
+private:
+  using dense_type = entity_type*;
+  using page_type = entity_type*;
+  using sparse_array_type = typename Policy::template sparse_type<Entity>;
+  using sparse_type = sparse_array_type*;
+  using index_type = typename sparse_array_type::index_type;
+  using component_pool_type = std::tuple<Components*...>;
+
+  /**
+   * @brief Arrays published to readers when bound to an epoch_manager.
+   */
+  struct block
+  {
+    dense_type dense;
+    component_pool_type pool;
+    size_type capacity;
+  };
+
+  static_assert(std::numeric_limits<entity_type>::is_integer && !std::numeric_limits<entity_type>::is_signed,
+    "Entity type must be an unsigned integer");
+
+  /**
+   * @brief Arrays that snapshots read untouched chunks from.
+   * 
+   * While the storage uses the arrays, they are owned by the storage. When the storage grows
+   * or is destroyed while snapshots still use them, the ownership is given to the snapshots.
+   */
+  struct base
+  {
+    dense_type dense;
+    component_pool_type pool;
+    size_type capacity;
+    size_type count;
+    bool owned;
+    epoch_manager* epochs;
+
+    void own(const size_type constructed, epoch_manager* retire_to)
+    {
+      count = constructed;
+      epochs = retire_to;
+      owned = true;
+    }
+
+    ~base()
+    {
+      if (owned) release(dense, pool, capacity, count, epochs);
+    }
+  };
+
+  /**
+   * @brief Copy of a chunk made before it was first written.
+   */
+  struct chunk_copy
+  {
+    dense_type dense;
+    component_pool_type pool;
+    size_type count;
+
+    ~chunk_copy() { release(dense, pool, count, count, NULL); }
+  };
+
+  /**
+   * @brief Point-in-time state of the storage shared by snapshots.
+   */
+  struct frozen
+  {
+    size_type size;
+    std::shared_ptr<base> live;
+    std::unique_ptr<std::atomic<chunk_copy*>[]> chunks;
+    std::unique_ptr<std::atomic<uint32_t>[]> readers;
+
+    frozen(const size_type size, std::shared_ptr<base> live)
+      : size(size), live(std::move(live)),
+        chunks(new std::atomic<chunk_copy*>[(size + snapshot_chunk_size - 1) / snapshot_chunk_size]()),
+        readers(new std::atomic<uint32_t>[(size + snapshot_chunk_size - 1) / snapshot_chunk_size]())
+    {}
+
+    ~frozen()
+    {
+      for (size_type i = 0; i * snapshot_chunk_size < size; i++) delete chunks[i].load(std::memory_order_relaxed);
+    }
+  };
+
+  /**
+   * @brief Zone maps of a component, one zone per chunk. Nothing for components without a key.
+   * 
+   * @tparam Component Component type
+   */
+  template<typename Component, typename = void>
+  struct zones
+  {
+    using type = std::nullptr_t;
+  };
+
+  template<typename Component>
+  struct zones<Component, std::enable_if_t<has_zone_key_v<Component>>>
+  {
+    using type = std::vector<zone<zone_key_t<Component>>>;
+  };
+
+  /**
+   * @brief Whether or not atleast one component of the archetype has zone maps.
+   */
+  static constexpr bool zoned = (has_zone_key_v<Components> || ...);
+
+  /**
+   * @brief Secondary hash index of a component. Nothing for components without an index key.
+   * 
+   * The key of every entity when it was last indexed is kept, in dense order, to find the keys
+   * that changed and to remove the keys of erased entities.
+   * 
+   * @tparam Component Component type
+   */
+  template<typename Component, typename = void>
+  struct lookups
+  {
+    using type = std::nullptr_t;
+  };
+
+  template<typename Component>
+  struct lookups<Component, std::enable_if_t<has_index_key_v<Component>>>
+  {
+    struct type
+    {
+      hash_index<index_key_t<Component>, entity_type> map;
+      std::vector<std::pair<entity_type, index_key_t<Component>>> keys;
+    };
+  };
+
+  /**
+   * @brief Whether or not atleast one component of the archetype has a secondary hash index.
+   */
+  static constexpr bool indexed = (has_index_key_v<Components> || ...);
+
+  /**
+   * @brief Arena of the elements of a buffer component. Nothing for other components.
+   * 
+   * @tparam Component Component type
+   */
+  template<typename Component, typename = void>
+  struct arenas
+  {
+    using type = std::nullptr_t;
+  };
+
+  template<typename Component>
+  struct arenas<Component, std::enable_if_t<is_buffer_v<Component>>>
+  {
+    using type = typename Component::arena_type;
+  };
+
+  /**
+   * @brief Whether or not atleast one component of the archetype is a buffer.
+   */
+  static constexpr bool buffered = (is_buffer_v<Components> || ...);
+
+  /**
+   * @brief Alignment of the columns of a single allocation: a cache line, or more for over-aligned components.
+   */
+  static constexpr size_type column_alignment = std::max({ size_type { 64 }, alignof(entity_type), alignof(Components)... });
+
+  /**
+   * @brief Returns the size of a column of a single allocation, rounded up so that the next column is aligned.
+   * 
+   * @param capacity Amount of elements in the column
+   * @param size Size of an element
+   * @return size_type Size of the column in bytes
+   */
+  static constexpr size_type column_size(const size_type capacity, const size_type size)
+  {
+    return (capacity * size + column_alignment - 1) / column_alignment * column_alignment;
+  }
+
+  /**
+   * @brief Compile-time capacity of the storage, zero if the storage grows (see fixed_policy).
+   */
+  static constexpr size_type fixed_capacity = Policy::template capacity<archetype<Components...>>;
+
+  /**
+   * @brief Whether or not the dense arrays are inline, with a compile-time capacity.
+   */
+  static constexpr bool fixed = fixed_capacity != 0;
+
+  /**
+   * @brief Returns the size of a block that holds the dense entity array and every column, one after the other.
+   * 
+   * @param capacity Amount of entities the block can hold
+   * @return size_type Size of the block in bytes
+   */
+  static constexpr size_type block_size(const size_type capacity)
+  {
+    return column_size(capacity, sizeof(entity_type)) + (size_type { 0 } + ... + column_size(capacity, sizeof(Components)));
+  }
+
+  /**
+   * @brief Inline memory of the dense arrays of a fixed capacity storage, laid out like a single allocation.
+   */
+  struct alignas(column_alignment) fixed_memory
+  {
+    unsigned char bytes[block_size(fixed_capacity)];
+  };
+
+  /**
+   * @brief Whether or not the dense arrays can be shared with forks page by page (see cow_memory).
+   * 
+   * Only with a shared pages policy. Buffers point to the arenas of their storage and pages are shared
+   * as bytes, so only storages of trivially copyable components that grow are shared.
+   */
+  static constexpr bool shareable = Policy::shared_pages && !fixed && !buffered && column_alignment <= 4096 && (std::is_trivially_copyable_v<Components> && ...);
+
+  /**
+   * @brief Returns whether or not the dense arrays of the specified capacity are a block of a cow_memory.
+   * 
+   * Small arrays are cheaper to copy than to share, they are allocated like any other.
+   * 
+   * @param capacity Amount of entities the arrays can hold
+   * @return true If the arrays are mapped, false otherwise
+   */
+  static bool mapped(const size_type capacity)
+  {
+    if constexpr (shareable) return cow_memory::shares(block_size(capacity));
+    else
+    {
+      (void)capacity; // Suppress unused warning
+
+      return false;
+    }
+  }
+
+  /**
+   * @brief Nothing, for storages that grow.
+   */
+  struct growable_memory
+  {};
+
+  /**
+   * @brief Array of per chunk values that threads writing different ranges can store to at once.
+   * 
+   * Neighbour ranges of a parallel loop can share a chunk, std::vector cannot hold atomics. Stores
+   * and loads are relaxed, resize and assign are not thread-safe.
+   * 
+   * @tparam Type Type of the values
+   */
+  template<typename Type>
+  class atomic_array final
+  {
+  public:
+    atomic_array() : _values(NULL), _size(0), _capacity(0) {}
+    ~atomic_array() { delete[] _values; }
+
+    atomic_array(const atomic_array&) = delete;
+    atomic_array(atomic_array&&) = delete;
+    atomic_array& operator=(const atomic_array&) = delete;
+    atomic_array& operator=(atomic_array&&) = delete;
+
+    /**
+     * @brief Resizes the array, new values are set to the specified value.
+     * 
+     * The capacity atleast doubles, so growing one chunk at a time is amortized.
+     * 
+     * @param size New size of the array
+     * @param value Value of the new elements
+     */
+    void resize(const size_type size, const Type value)
+    {
+      if (size > _capacity)
+      {
+        const size_type capacity = size > _capacity * 2 ? size : _capacity * 2;
+
+        std::atomic<Type>* values = new std::atomic<Type>[capacity];
+
+        for (size_type i = 0; i < _size; i++) values[i].store(load(i), std::memory_order_relaxed);
+
+        delete[] _values;
+
+        _values = values;
+        _capacity = capacity;
+      }
+
+      for (size_type i = _size; i < size; i++) store(i, value);
+
+      _size = size;
+    }
+
+    /**
+     * @brief Copies the values of another array.
+     * 
+     * @param other Array to copy
+     */
+    void assign(const atomic_array& other)
+    {
+      _size = 0;
+
+      resize(other._size, Type {});
+
+      for (size_type i = 0; i < _size; i++) store(i, other.load(i));
+    }
+
+    /**
+     * @brief Returns the value at an index.
+     * 
+     * @param i Index of the value
+     * @return Type The value
+     */
+    [[nodiscard]] Type load(const size_type i) const { return _values[i].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sets the value at an index.
+     * 
+     * @param i Index of the value
+     * @param value New value
+     */
+    void store(const size_type i, const Type value) { _values[i].store(value, std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the amount of values in the array.
+     * 
+     * @return size_type Amount of values
+     */
+    [[nodiscard]] size_type size() const { return _size; }
+
+  private:
+    std::atomic<Type>* _values;
+    size_type _size;
+    size_type _capacity;
+  };
+
+  /**
+   * @brief Whether or not atleast one component of the archetype is computed.
+   */
+  static constexpr bool computing = (is_computed_v<Components> || ...);
+
+  static_assert((size_t { 0 } + ... + size_t { is_computed_v<Components> }) <= 8,
+    "An archetype cannot contain more than 8 computed components");
+
+  /**
+   * @brief Whether or not the inputs of a component are all in the archetype, always true for components that are not computed.
+   * 
+   * @tparam Component Component type
+   */
+  template<typename Component, typename = void>
+  struct computable : std::true_type
+  {};
+
+  template<typename Component>
+  struct computable<Component, std::enable_if_t<is_computed_v<Component>>> : computable<typename computed<Component>::inputs>
+  {};
+
+  template<typename... Inputs>
+  struct computable<list<Inputs...>> : contains_all<list<Components...>, Inputs...>
+  {};
+
+  static_assert((computable<Components>::value && ...),
+    "The inputs of a computed component must all be in the archetype");
+
+  /**
+   * @brief Returns the outdated flag of a computed component.
+   * 
+   * @tparam Component Computed component type
+   * @return uint8_t Bit of the component in the outdated flags of an entity
+   */
+  template<typename Component>
+  static constexpr uint8_t computed_bit()
+  {
+    constexpr bool flags[] = { is_computed_v<Components>... };
+
+    size_type bit = 0;
+
+    for (size_type i = 0; i < find_v<Component, list<Components...>>; i++) bit += flags[i];
+
+    return static_cast<uint8_t>(1u << bit);
+  }
+
+  /**
+   * @brief Returns the outdated flag of a component if it is computed from any of the written components.
+   * 
+   * @tparam Component Component type
+   * @tparam Written Types of written components, possibly const or write-only (out)
+   * @return uint8_t Bit of the component, zero if it does not depend on the written components
+   */
+  template<typename Component, typename... Written>
+  static constexpr uint8_t dependent_bit()
+  {
+    if constexpr ((... || (!std::is_const_v<Written> && depends_on_v<Component, component_t<Written>>)))
+    {
+      return computed_bit<Component>();
+    }
+    else
+      return 0;
+  }
+
+  /**
+   * @brief Outdated flags of the computed components that depend on the written components.
+   * 
+   * @tparam Written Types of written components, possibly const or write-only (out)
+   */
+  template<typename... Written>
+  static constexpr uint8_t outdated_by = (uint8_t { 0 } | ... | dependent_bit<Components, Written...>());
+
+public:
+  class iterator;
+  class appender;
+  class snapshot;
+
+  /**
+   * @brief Amount of entities copied at once when a snapshot chunk is first written.
+   */
+  static constexpr size_type snapshot_chunk_size = 1024;
+
+  /**
+   * @brief Amount of entities summarized by a single zone of a zone map.
+   */
+  static constexpr size_type zone_chunk_size = 256;
+
+  /**
+   * @brief Amount of entities that share a change version (see version).
+   */
+  static constexpr size_type version_chunk_size = 256;
+
+  /**
+   * @brief Construct a new storage object
+   */
+  storage()
+    : _dense(NULL), _size(0), _capacity(0), _high_water(0), _epochs(NULL), _block(NULL), _published(0), _frozen_count(0), _changed(true),
+      _reindex(true), _version(0)
+  {
+    // Uses new, but normally when using shared sparse arrays it will be allocated on the stack
+    _sparse = new sparse_array_type();
+
+    // Allocate nothing by default
+    ((access<Components>() = NULL), ...);
+
+    if constexpr (fixed)
+    {
+      // Every column starts on its own cache line, like a single allocation
+      unsigned char* memory = _memory.bytes;
+
+      _dense = reinterpret_cast<dense_type>(memory);
+      memory += column_size(fixed_capacity, sizeof(entity_type));
+
+      ((access<Components>() = reinterpret_cast<Components*>(memory), memory += column_size(fixed_capacity, sizeof(Components))), ...);
+
+      _capacity = fixed_capacity;
+      _high_water = fixed_capacity;
+
+      track(fixed_capacity);
+    }
+  }
+
+  /**
+   * @brief Destroy the storage object
+   */
+  ~storage()
+  {
+    // We only manage our sparse_array memory if its not shared
+    if (_sparse->shared()) _sparse->unshare();
+    else
+      delete _sparse;
+
+    // Inline arrays are never shared, only the components are destroyed
+    if constexpr (fixed) (destroy<Components>(access<Components>(), _size), ...);
+    else if (_base && _base.use_count() > 1)
+      _base->own(_size, _epochs); // Snapshots that still read the arrays become their owners
+    else
+      release(_dense, _pool, _capacity, _size, NULL);
+
+    delete _block.load(std::memory_order_relaxed);
+  }
+
+  storage(const storage&) = delete;
+  storage(storage&&) = delete;
+  storage& operator=(const storage&) = delete;
+  storage& operator=(storage&&) = delete;
+
+  /**
+   * @brief Inserts a entity and all its components at once.
+   * 
+   * Entities are always inserted in the back of the array, however they are not
+   * guarented to stay there, and can be moved around by other operations.
+   * 
+   * You can directly add the components with this method. However, components will be copied. 
+   * This is not nessesary and can be done later very efficiently using the unpack method. 
+   * Also, the order of the components dont matter, as long as they are all unique and part of the archetype.
+   * 
+   * This operation is usually O(1) and is pretty cheap. Some insert operations may be slower
+   * if any internal array need a resize.
+   * 
+   * @warning Undefined behaviour if the entity already exists. If you dont know
+   * if the entity exists, call the contains method first.
+   * 
+   * @tparam IncludedComponents Types of components to insert with (optional).
+   * @param entity Entity to insert
+   * @param components Components to insert alongside entity
+   */
+  template<typename... IncludedComponents>
+  void insert(const entity_type entity, const IncludedComponents&... components)
+  {
+    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
+      "One or more included components do not belong to the archetype");
+    static_assert(unique_types_v<IncludedComponents...>,
+      "Included components are not unique");
+
+    if (_size == _capacity) grow();
+    _sparse->assure(entity);
+
+    touch(_size, _size + 1);
+
+    _dense[_size] = entity;
+
+    // Call the constructors if needed
+    (construct<Components>(_size), ...);
+
+    ((access<IncludedComponents>()[_size] = components), ...);
+
+    if constexpr (buffered) (adopt<Components>(_size, _size + 1), ...);
+
+    assert(_size <= sparse_array_type::max_index && "Too many entities for the index type of the sparse array");
+
+    (*_sparse)[entity] = static_cast<index_type>(_size++);
+
+    publish();
+  }
+
+  /**
+   * @brief Inserts a block of entities, [first, first + count), that all have the same components.
+   * 
+   * The storage grows once for the whole block, then every column is filled with its value
+   * (see fill, trivially copyable components are filled with memset, streaming stores or a
+   * vectorized loop). Components that are not included are default constructed, like insert.
+   * 
+   * @warning Undefined behaviour if any of the entities already exists.
+   * 
+   * @tparam IncludedComponents Types of components to insert with (optional).
+   * @param first First entity of the block
+   * @param count Amount of entities to insert
+   * @param components Components of every inserted entity
+   */
+  template<typename... IncludedComponents>
+  void broadcast(const entity_type first, const size_type count, const IncludedComponents&... components)
+  {
+    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
+      "One or more included components do not belong to the archetype");
+    static_assert(unique_types_v<IncludedComponents...>,
+      "Included components are not unique");
+
+    if (count == 0) return;
+
+    if (_size + count > _capacity)
+    {
+      const size_type grown = (_capacity * 3) / 2 + 8;
+
+      resize(_size + count > grown ? _size + count : grown);
+    }
+
+    _sparse->assure(static_cast<entity_type>(first + count - 1));
+
+    const size_type offset = _size;
+
+    touch(offset, offset + count);
+
+    assert(offset + count - 1 <= sparse_array_type::max_index && "Too many entities for the index type of the sparse array");
+
+    for (size_type i = 0; i < count; i++)
+    {
+      const entity_type entity = static_cast<entity_type>(first + i);
+
+      _dense[offset + i] = entity;
+      (*_sparse)[entity] = static_cast<index_type>(offset + i);
+    }
+
+    _size += count;
+
+    const auto values = std::forward_as_tuple(components...);
+
+    (broadcast_column<Components>(offset, _size, values), ...);
+
+    if constexpr (buffered) (adopt<Components>(offset, _size), ...);
+
+    publish();
+  }
+
+  /**
+   * @brief Inserts a block of entities, [first, first + count), that are copies of an entity of the storage.
+   * 
+   * Same as broadcast, with the components of the entity.
+   * 
+   * @warning Undefined behaviour if the entity does not exist or if any of the entities of the block already exists.
+   * 
+   * @param entity Entity to copy the components of
+   * @param first First entity of the block
+   * @param count Amount of entities to insert
+   */
+  void clone(const entity_type entity, const entity_type first, const size_type count)
+  {
+    const size_type index = (*_sparse)[entity];
+
+    // Growing moves the components of the entity, they must be copied first
+    const std::tuple<Components...> copy { access<Components>()[index]... };
+
+    broadcast(first, count, std::get<Components>(copy)...);
+  }
+
+  /**
+   * @brief Reserves space for many entities that will be inserted concurrently.
+   * 
+   * This is the synchronization point of concurrent insertion. The dense arrays are grown to fit
+   * the specified amount of entities and the sparse_array is grown to contain the largest entity,
+   * then an appender is returned. Threads can insert into the appender without any locks until it
+   * is committed.
+   * 
+   * @warning The storage must not be used in any other way while the appender exists.
+   * 
+   * @param count Amount of entities to reserve space for
+   * @param last Largest entity that will be inserted
+   * @return appender Appender that inserts into the reserved space
+   */
+  appender append(const size_type count, const entity_type last)
+  {
+    reserve(_size + count);
+    _sparse->assure(last);
+
+    touch(_size, _size + count);
+
+    return appender { this, count };
+  }
+
+  /**
+   * @brief Erases an entity from the storage.
+   * 
+   * Erasing entities is essentially just poping an entity from the back of the array and moving
+   * it to the location of the entity to erase.
+   * 
+   * This is a very cheap O(1) operation.
+   * 
+   * @warning Undefined behaviour if the entity does not exist. If you dont know
+   * if the entity exists, call the contains method first.
+   * 
+   * @param entity Entity to erase
+   */
+  void erase(const entity_type entity)
+  {
+    const entity_type back_entity = _dense[--_size];
+    const size_type index = (*_sparse)[entity];
+
+    touch(index, index + 1);
+    touch(_size, _size + 1);
+
+    (*_sparse)[back_entity] = static_cast<index_type>(index);
+    _dense[index] = back_entity;
+
+    // Call the destructors if needed
+    (destroy<Components>(index), ...);
+
+    if constexpr (buffered) (release_buffer<Components>(index), ...);
+
+    // Moves the component data to the new location
+    ((access<Components>()[index] = std::move(access<Components>()[_size])), ...);
+
+    publish();
+  }
+
+  /**
+   * @brief Returns whether or not an entity is present in the storage.
+   * 
+   * This operation is a very cheap O(1) operation.
+   * 
+   * @param entity Entity to check
+   * @return true If entity is present in storage, false otherwise
+   */
+  bool contains(const entity_type entity) const
+  {
+    size_type index;
+
+    // We must access the dense array here because our sparse arrays may be shared, therefor we need
+    // to make sure entity index is valid.
+    return entity < _sparse->capacity() && (index = (*_sparse)[entity]) < _size && _dense[index] == entity;
+  }
+
+  /**
+   * @brief Returns the dense index of an entity.
+   * 
+   * @warning Undefined behaviour if the entity does not exist.
+   * 
+   * @param entity Entity to find the index of
+   * @return size_type Index of the entity in the dense arrays
+   */
+  [[nodiscard]] size_type index(const entity_type entity) const { return (*_sparse)[entity]; }
+
+  /**
+   * @brief Returns a reference of the stored component for the specified entity and component type.
+   * 
+   * This operation simply optains the index of the entity and access the dense array that holds
+   * the component of requested type.
+   * 
+   * Very cheap operation, however unpacking from the iterator doesn't require recalculating the index
+   * every time, so try to prioritize that (even if its a very cheap to find the index).
+   * 
+   * Computed components are computed again first if an input changed (see computed).
+   * 
+   * @tparam Component Type of component to unpack
+   * @param entity Entity to unpack component for
+   * @return Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  Component& unpack(const entity_type entity)
+  {
+    static_assert(contains_v<Component, list<Components...>>,
+      "The component your trying to unpack does not belong to the archetype");
+
+    const size_type index = (*_sparse)[entity];
+
+    write<Component>(index, index + 1);
+
+    if constexpr (is_computed_v<Component>) compute<Component>(index, index + 1);
+
+    return access<Component>()[index];
+  }
+
+  /**
+   * @brief Returns a const reference of the stored component for the specified entity and component type.
+   * 
+   * Same as unpack, but the component is only read, so snapshots never need to copy it.
+   * 
+   * @tparam Component Type of component to unpack
+   * @param entity Entity to unpack component for
+   * @return const Component& Reference to component belonging to the entity
+   */
+  template<typename Component>
+  const Component& unpack(const entity_type entity) const
+  {
+    static_assert(contains_v<Component, list<Components...>>,
+      "The component your trying to unpack does not belong to the archetype");
+
+    return std::get<Component*>(_pool)[(*_sparse)[entity]];
+  }
+
+  /**
+   * @brief Resizes every internal dense array to be as small as possible.
+   * 
+   * This is good to call every once in a while to optimize memory usage.
+   * 
+   * @note This does not resize the sparse_array
+   */
+  void shrink_to_fit()
+  {
+    if (_size != _capacity) resize(_size);
+  }
+
+  /**
+   * @brief Sorts the entities in the range [first, last) by identifier.
+   * 
+   * Components are moved with their entities. Iterating entities in identifier order accesses the
+   * sparse array in order, which is friendlier to the cache. Sorting is done in ranges so it can be
+   * spread over many calls, the ranges are sorted independently and are never merged.
+   * 
+   * The permutation is computed in a scratch buffer that is kept between calls.
+   * 
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   */
+  void sort(const size_type first, const size_type last)
+  {
+    if (last > _size || first + 2 > last) return;
+
+    if (std::is_sorted(_dense + first, _dense + last)) return;
+
+    touch(first, last);
+
+    const size_type count = last - first;
+
+    _order.resize(count);
+
+    for (size_type i = 0; i < count; i++) _order[i] = first + i;
+
+    std::sort(_order.begin(), _order.end(), [this](const size_type lhs, const size_type rhs)
+      { return _dense[lhs] < _dense[rhs]; });
+
+    // Follow every cycle of the permutation, each swap puts one entity at its place. Placed
+    // entities are marked by pointing them to themselves
+    for (size_type start = 0; start < count; start++)
+    {
+      if (_order[start] == first + start) continue;
+
+      size_type current = start;
+
+      while (true)
+      {
+        const size_type next = _order[current] - first;
+
+        _order[current] = first + current;
+
+        if (next == start) break;
+
+        swap(first + current, first + next);
+
+        current = next;
+      }
+    }
+  }
+
+  /**
+   * @brief Returns a read-only, point-in-time snapshot of the storage.
+   * 
+   * Taking a snapshot does not copy anything. Instead, writers copy a chunk of the storage
+   * (see snapshot_chunk_size) the first time they write it while the snapshot exists. Chunks
+   * that are never written are read directly from the storage. If the storage grows, the old
+   * arrays are kept by the snapshot instead of being copied.
+   * 
+   * Snapshots taken without any write in between share the same state.
+   * 
+   * @note Writes through iterators are not seen by snapshots, call touch before writing.
+   * 
+   * @return snapshot Snapshot of the storage
+   */
+  snapshot freeze()
+  {
+    static_assert(!fixed, "Fixed capacity storages cannot outlive their snapshots, they do not support them");
+
+    std::lock_guard<std::mutex> lock(_snapshot_mutex);
+
+    prune();
+
+    if (!_changed && !_frozen.empty())
+    {
+      if (auto latest = _frozen.back().lock()) return snapshot { std::move(latest) };
+    }
+
+    if (!_base) _base = std::make_shared<base>(base { _dense, _pool, _capacity, 0, false, NULL });
+
+    auto state = std::make_shared<frozen>(_size, _base);
+
+    _frozen.push_back(state);
+    _frozen_count.store(_frozen.size(), std::memory_order_relaxed);
+    _changed = false;
+
+    return snapshot { std::move(state) };
+  }
+
+  /**
+   * @brief Signals that the entities in the range [first, last) are about to be written.
+   * 
+   * Copies the chunks of the range for every snapshot that still reads them from the
+   * storage. Insert, erase and unpack already do this, only direct writes (through iterators)
+   * need to call it.
+   * 
+   * When there are no snapshots, this is a single check.
+   * 
+   * Can be called from many threads for different ranges, neighbour ranges may share a version chunk.
+   * 
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   */
+  void touch(const size_type first, const size_type last)
+  {
+    if (_frozen_count.load(std::memory_order_relaxed) != 0) copy_on_write(first, last);
+
+    if constexpr (zoned || indexed) stale(first, last);
+    if constexpr (computing) outdate(first, last, outdated_by<Components...>);
+
+    change(first, last);
+  }
+
+  /**
+   * @brief Signals that the specified components of the entities in the range [first, last) are about to be written.
+   * 
+   * Same as touch, but zone maps and indexes are only invalidated if a written component has a key (see
+   * zone_key and index_key). Only the computed components that depend on a written component are outdated
+   * (see computed). Const components are skipped and write-only components (out) are written, so the components of a view can be given as is.
+   * 
+   * Can be called from many threads for different ranges, neighbour ranges may share a version chunk.
+   * 
+   * @tparam Written Types of components to write
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   */
+  template<typename... Written>
+  void write(const size_type first, const size_type last)
+  {
+    if (_frozen_count.load(std::memory_order_relaxed) != 0) copy_on_write(first, last);
+
+    if constexpr (((has_zone_key_v<component_t<Written>> || has_index_key_v<component_t<Written>>) || ...)) stale(first, last);
+    if constexpr (outdated_by<Written...> != 0) outdate(first, last, outdated_by<Written...>);
+
+    if constexpr ((!std::is_const_v<Written> || ...)) change(first, last);
+  }
+
+  /**
+   * @brief Returns the version of the storage, incremented every time entities are touched or written.
+   * 
+   * Together with the version of every chunk, this is the change tracking used by incremental queries:
+   * a chunk changed since a previous version of the storage if its version is larger.
+   * 
+   * @return uint64_t Version of the last change
+   */
+  [[nodiscard]] uint64_t version() const { return _version.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Returns the version of the last change to a chunk of version_chunk_size entities.
+   * 
+   * @param chunk Index of the chunk, must contain atleast one entity
+   * @return uint64_t Version of the last change to the chunk
+   */
+  [[nodiscard]] uint64_t version(const size_type chunk) const { return _versions.load(chunk); }
+
+  /**
+   * @brief Returns whether or not a chunk may contain entities whose key is in a range.
+   * 
+   * Every component with a key (see zone_key) has a zone map: the smallest and largest key of every
+   * chunk of zone_chunk_size entities. Zone maps are maintained lazily, writes mark the zones of their
+   * chunks as stale (see touch and write) and stale zones are computed again here, when they are needed.
+   * A chunk whose zone does not overlap the range does not contain any entity in the range, and can be
+   * skipped entirely.
+   * 
+   * @warning Not thread-safe. Writes through iterators must call touch or write to be seen.
+   * 
+   * @tparam Component The component type of the key
+   * @param chunk Index of the chunk
+   * @param range Range of keys
+   * @return true If the chunk may contain an entity in the range, false if it does not contain any
+   */
+  template<typename Component>
+  bool overlaps(const size_type chunk, const range<zone_key_t<Component>>& range)
+  {
+    static_assert(has_zone_key_v<Component>, "Component does not have a zone key");
+
+    refresh(chunk);
+
+    const auto& zone = std::get<find_v<Component, list<Components...>>>(_zones)[chunk];
+
+    return range.overlaps(zone.low, zone.high);
+  }
+
+  /**
+   * @brief Returns the entity whose component has the specified key.
+   * 
+   * Every component with an index key (see index_key) has a secondary hash index. Indexes are maintained
+   * lazily: writes mark their chunks as stale (see touch and write), and the keys of stale chunks are
+   * indexed again by the next lookup. A lookup after no writes is a single hash map lookup.
+   * 
+   * @warning Not thread-safe. Writes through iterators must call touch or write to be seen.
+   * 
+   * @tparam Component The component type of the key
+   * @param key Key to find
+   * @return entity_type Entity with the key (any of them if many have it), the largest entity identifier if there is none
+   */
+  template<typename Component>
+  entity_type lookup(const index_key_t<Component>& key)
+  {
+    static_assert(has_index_key_v<Component>, "Component does not have an index key");
+
+    reindex();
+
+    return std::get<find_v<Component, list<Components...>>>(_lookups).map.find(key);
+  }
+
+  /**
+   * @brief Computes a computed component again for the entities in the range [first, last) whose inputs changed.
+   * 
+   * Writes to inputs (see touch and write) mark the computed components that depend on them as outdated,
+   * only outdated components are computed. Can be called from many threads for different ranges.
+   * 
+   * Does nothing for components that are not computed.
+   * 
+   * @tparam Component The component type to compute
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   */
+  template<typename Component>
+  void compute(const size_type first, const size_type last)
+  {
+    if constexpr (is_computed_v<Component>)
+    {
+      constexpr uint8_t bit = computed_bit<Component>();
+
+      bool written = false;
+
+      for (size_type i = first; i < last; i++)
+      {
+        if ((_outdated[i] & bit) == 0) continue;
+
+        if (!written)
+        {
+          write<Component>(i, last);
+          written = true;
+        }
+
+        compute_at<Component>(i, typename computed<Component>::inputs {});
+
+        _outdated[i] &= static_cast<uint8_t>(~bit);
+      }
+    }
+    else
+    {
+      (void)first; // Suppress unused warning
+      (void)last;
+    }
+  }
+
+  /**
+   * @brief Makes an empty storage a copy-on-write fork of this storage.
+   * 
+   * With a shared pages policy, large dense arrays are shared page by page (see cow_memory): the first write
+   * to a page, by either storage, copies that page for that storage only. Pages that are never written are never
+   * copied. Forking costs a few system calls, plus one copy of every page written since the last fork, so the
+   * first fork of a storage copies all of it.
+   * 
+   * Other storages, small arrays, arrays of components that are not trivially copyable, buffers and fixed
+   * capacity storages are copied instead.
+   * 
+   * @note The sparse_array is not forked, the fork must share a sparse_array with the same indexes.
+   * 
+   * @warning The fork must be a new storage. Must not be called while either storage is written.
+   * 
+   * @param fork Storage to make a fork of this storage
+   */
+  void fork(storage& fork)
+  {
+    assert(fork._capacity == 0 && fork._size == 0 && "Storage to fork into is not new");
+
+    if (_dense && mapped(_capacity))
+    {
+      // Components are trivially copyable, the fork is a bytewise copy of the block
+      fork._dense = partition(static_cast<char*>(cow_memory::duplicate(_dense, block_size(_capacity))), _capacity, fork._pool);
+      fork._capacity = _capacity;
+      fork._high_water = _capacity;
+    }
+    else
+    {
+      // Buffers of the fork must use the arenas of the fork
+      fork.resize(_size);
+
+      if (_size != 0)
+      {
+        std::memcpy(fork._dense, _dense, _size * sizeof(entity_type));
+        (relocate<Components>(fork._pool), ...);
+      }
+    }
+
+    if constexpr (computing)
+    {
+      fork._outdated.assign(_outdated.begin(), _outdated.begin() + fork._capacity);
+    }
+
+    if constexpr (buffered) (rebind<Components>(fork), ...);
+
+    fork._versions.assign(_versions);
+    fork._version.store(_version.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    fork._size = _size;
+  }
+
+  /**
+   * @brief Grows every internal dense array to fit atleast the specified amount of entities.
+   * 
+   * @param capacity Minimum capacity of the storage
+   */
+  void reserve(const size_type capacity)
+  {
+    if (capacity > _capacity) resize(capacity);
+  }
+
+  /**
+   * @brief Binds the memory of the entities in the range [first, last) to a NUMA node.
+   * 
+   * The dense arrays are bound page by page, so only large ranges are affected. Memory is bound
+   * until the storage grows or shrinks, placement should be done again after that.
+   * 
+   * Does nothing on a single node machine.
+   * 
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   * @param node Node to bind to
+   */
+  void place(const size_type first, const size_type last, const size_t node)
+  {
+    numa_bind(_dense + first, (last - first) * sizeof(entity_type), node);
+    ((numa_bind(access<Components>() + first, (last - first) * sizeof(Components), node)), ...);
+  }
+
+  /**
+   * @brief Assigns the same value to the component of every entity in the range [first, last).
+   * 
+   * Components whose bytes are all the same (zero for example) are filled with memset. Large columns of
+   * other trivially copyable components are written with non-temporal stores (see out), so the old
+   * values are never read.
+   * 
+   * @tparam Component The component type to fill
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   * @param value Value to assign
+   */
+  template<typename Component>
+  void fill(const size_type first, const size_type last, const Component& value)
+  {
+    if (first >= last) return;
+
+    write<Component>(first, last);
+
+    Component* array = access<Component>() + first;
+
+    const size_type count = last - first;
+
+    if constexpr (std::is_trivially_copyable_v<Component>)
+    {
+      unsigned char bytes[sizeof(Component)];
+      std::memcpy(bytes, &value, sizeof(Component));
+
+      if (std::all_of(bytes, bytes + sizeof(Component), [&bytes](const unsigned char byte)
+            { return byte == bytes[0]; }))
+      {
+        std::memset(static_cast<void*>(array), bytes[0], count * sizeof(Component));
+        return;
+      }
+    }
+
+    if constexpr (internal::streamable_v<Component>)
+    {
+      if (out<Component>::streams(count))
+      {
+        for (size_type i = 0; i < count; i++) internal::stream(array + i, value);
+
+        internal::stream_fence();
+        return;
+      }
+    }
+
+    std::fill_n(array, count, value);
+  }
+
+  /**
+   * @brief Gives the entities of the storage the identifiers [first, first + size), in dense order.
+   * 
+   * The sparse array is updated for the new identifiers, the entries of the old identifiers are left
+   * as is. Components stay at the same position.
+   * 
+   * @warning New identifiers must be unique between every storage that shares the sparse array.
+   * 
+   * @param first First new identifier
+   * @param table Table of new identifiers indexed by old identifier, filled for every entity of the storage
+   */
+  void renumber(const entity_type first, entity_type* table)
+  {
+    touch(0, _size);
+
+    for (size_type i = 0; i < _size; i++)
+    {
+      const entity_type entity = static_cast<entity_type>(first + i);
+
+      table[_dense[i]] = entity;
+
+      _dense[i] = entity;
+      (*_sparse)[entity] = static_cast<index_type>(i);
+    }
+  }
+
+  /**
+   * @brief Binds an epoch_manager to this storage so that it can be read while it grows.
+   * 
+   * Once bound, growing the storage never reallocates the dense arrays in place. New arrays are
+   * allocated and the old ones are retired to the epoch_manager, then freed once every reader has left
+   * its epoch. Readers that use the read method never block writers and never read freed memory.
+   * 
+   * @warning Must be called while there are no readers. The epoch_manager must outlive the storage.
+   * 
+   * @param epochs The epoch_manager to retire memory to
+   */
+  void bind(epoch_manager* epochs)
+  {
+    static_assert(!fixed, "Fixed capacity storages never move their arrays, they cannot be bound to an epoch_manager");
+
+    _epochs = epochs;
+
+    delete _block.exchange(new block { _dense, _pool, _capacity }, std::memory_order_release);
+
+    publish();
+  }
+
+  /**
+   * @brief Iterates over every entity and calls the given function with the specified components.
+   * 
+   * This method can be called by any amount of threads while a single writer inserts and grows the
+   * storage. Inserts only write past the size that the read started with, so the entities seen are
+   * the ones present when the read started.
+   * 
+   * @warning The storage must be bound to an epoch_manager and the guard must be from the same
+   * epoch_manager. Components that are modified during the read are not synchronized. Erasing
+   * during a read is undefined behaviour: the last entity is moved into the erased slot in place,
+   * so the read may skip it, see it twice or see a partly written slot.
+   * 
+   * @tparam IncludedComponents Types of components to read
+   * @tparam Callable Callable type
+   * @param guard Pinned epoch of the reader
+   * @param callable The callable to invoke on every entity
+   */
+  template<typename... IncludedComponents, typename Callable>
+  void read(const epoch_manager::guard& guard, const Callable& callable) const
+  {
+    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
+      "One or more included components do not belong to the archetype");
+
+    assert(_epochs && "Storage is not bound to an epoch manager");
+
+    (void)guard; // Only required to prove that the epoch is pinned
+
+    // The size must be loaded first, every block published after it contains atleast as many entities
+    const size_type size = _published.load(std::memory_order_acquire);
+    const block* current = _block.load(std::memory_order_seq_cst);
+
+    for (size_type i = size < current->capacity ? size : current->capacity; i-- > 0;)
+    {
+      callable(current->dense[i], static_cast<const IncludedComponents&>(std::get<IncludedComponents*>(current->pool)[i])...);
+    }
+  }
+
+  /**
+   * @brief Binds the shared sparse_array to this storage.
+   * 
+   * Sharing sparse_arrays between storages that operate on entities distributed by the
+   * same entity_manager is recommended for performance and memory usage.
+   * 
+   * @warning Attemping to share a sparse array while already containing entities
+   * will no nothing.
+   * 
+   * @param sparse The sparse_array to share with this storage
+   */
+  void share(sparse_type sparse)
+  {
+    if (_size != 0) return;
+
+    if (_sparse->shared()) _sparse->unshare();
+    else
+      // If the sparse_array is not shared that means we current have the default sparse_array
+      // allocated at initialization and we must delete it.
+      delete _sparse;
+
+    _sparse = sparse;
+    sparse->share();
+  }
+
+  /**
+   * @brief clears the entire storage
+   * 
+   * As cheap of an operation as you can get (sets size to zero).
+   */
+  void clear()
+  {
+    if constexpr (zoned || indexed) stale(0, _size);
+
+    if constexpr (buffered) (clear_arena<Components>(), ...);
+
+    change(0, _size);
+
+    _size = 0;
+
+    publish();
+  }
+
+  /**
+   * @brief Returns an iterator of the first entity of the dense array.
+   * 
+   * If the storage is empty the begining with be equal to the end.
+   * 
+   * @return iterator Dense array iterator begining
+   */
+  iterator begin() { return { this, _size - 1 }; }
+
+  /**
+   * @brief Returns an iterator at the last entity of the dense array.
+   * 
+   * If the storage is empty the begining with be equal to the end.
+   * 
+   * @return iterator Dense array iterator end
+   */
+  iterator end() { return { this, static_cast<size_type>(-1) }; }
+
+  /**
+   * @brief Returns an iterator at the specified index of the dense array.
+   * 
+   * Iterators move towards the begining of the dense array, so a sub-range [first, last)
+   * can be iterated from at(last - 1) to at(first - 1). The iterator at(-1) is equal to the end.
+   * 
+   * @param index Index in the dense array
+   * @return iterator Dense array iterator at index
+   */
+  iterator at(const size_type index) { return { this, index }; }
+
+  /**
+   * @brief Returns the amount of entites current held by the storage.
+   * 
+   * @return size_type Amount of entities currently in storage
+   */
+  [[nodiscard]] size_type size() const { return _size; }
+
+  /**
+   * @brief Returns the current entity capacity of the storage.
+   * 
+   * If this is equal to the size, the next insert operation if no entites
+   * are removed will result in a resize of all internal dense arrays.
+   * 
+   * @return size_type Current capacity of entities in storage
+   */
+  [[nodiscard]] size_type capacity() const { return _capacity; }
+
+  /**
+   * @brief Returns the largest capacity the storage ever had.
+   * 
+   * Reserving this capacity up front avoids every growth the storage went through.
+   * 
+   * @return size_type High-water mark of the capacity
+   */
+  [[nodiscard]] size_type high_water() const { return _high_water; }
+
+  /**
+   * @brief Returns whether or not the storage is empty.
+   * 
+   * The storage is empty when there are not entities currently being
+   * stored in it.
+   * 
+   * @return true If the storage is empty, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return _size == 0; }
+
+private:
+  /**
+   * @brief Grows the sparse set allocated space.
+   * 
+   * This grows the dense entity array and all the dense component arrays.
+   * 
+   * Growth is exponential with a small linear amount.
+   */
+  void grow()
+  {
+    // This is essentially _capacity * 1.5 + 8
+    // Note: Must try to find optimal growth rate for better reallocation
+    resize((_capacity * 3) / 2 + 8);
+  }
+
+  /**
+   * @brief Resizes every internal dense array to the specified capacity.
+   * 
+   * When bound to an epoch_manager, the arrays are relocated instead of reallocated.
+   * 
+   * @param capacity New capacity of the storage
+   */
+  void resize(const size_type capacity)
+  {
+    // Inline arrays never move, they always have the fixed capacity
+    if constexpr (fixed)
+    {
+      assert(capacity <= fixed_capacity && "Too many entities for the fixed capacity of the storage");
+
+      (void)capacity; // Suppress unused warning
+
+      return;
+    }
+
+    const size_type previous = _capacity;
+
+    _capacity = capacity;
+
+    if (capacity > _high_water) _high_water = capacity;
+
+    track(capacity);
+
+    // Snapshots that still read the arrays become their owners
+    const bool handed = _base && _base.use_count() > 1;
+
+    if (_epochs || handed) relocate(handed, previous);
+    else if (Policy::single_allocation || mapped(previous) || mapped(capacity))
+    {
+      // Sub-arrays cannot be reallocated separately, move every column to a new allocation
+      component_pool_type pool;
+      dense_type dense = allocate(_capacity, pool);
+
+      if (_dense)
+      {
+        std::memcpy(dense, _dense, _size * sizeof(entity_type));
+        (transfer<Components>(pool), ...);
+
+        deallocate(_dense, _pool, previous);
+      }
+
+      _dense = dense;
+      _pool = pool;
+    }
+    else
+    {
+      // Grow all arrays together
+      _dense = static_cast<dense_type>(std::realloc(_dense, _capacity * sizeof(entity_type)));
+      (reallocate<Components>(), ...);
+    }
+
+    if (handed) _base->own(_size, _epochs);
+
+    _base.reset();
+  }
+
+  /**
+   * @brief Moves every dense array to new memory and retires the old memory.
+   * 
+   * The old arrays are left untouched so that readers can keep reading them. The new
+   * arrays are published to readers once they are all filled.
+   * 
+   * @param handed Whether the old arrays are given to snapshots instead of being retired
+   * @param previous Capacity of the old arrays
+   */
+  void relocate(const bool handed, const size_type previous)
+  {
+    component_pool_type pool;
+    dense_type dense = allocate(_capacity, pool);
+
+    if (_dense)
+    {
+      std::memcpy(dense, _dense, _size * sizeof(entity_type));
+      (relocate<Components>(pool), ...);
+
+      if (!handed) release(_dense, _pool, previous, _size, _epochs);
+    }
+
+    _dense = dense;
+    _pool = pool;
+
+    if (_epochs) _epochs->retire_object(_block.exchange(new block { _dense, _pool, _capacity }, std::memory_order_seq_cst));
+  }
+
+  /**
+   * @brief Copies the dense array for the specified component type to new memory.
+   * 
+   * Non-trivial components are copied instead of moved, readers may still be reading the old ones.
+   * 
+   * @tparam Component The component type of the dense array to relocate.
+   * @param pool New dense arrays
+   */
+  template<typename Component>
+  void relocate(component_pool_type& pool)
+  {
+    Component* old_array = access<Component>();
+    Component* new_array = std::get<Component*>(pool);
+
+    if constexpr (std::is_trivially_copyable_v<Component>)
+    {
+      std::memcpy(static_cast<void*>(new_array), old_array, _size * sizeof(Component));
+    }
+    else
+    {
+      for (size_t i = 0; i < _size; i++) new (new_array + i) Component(old_array[i]);
+    }
+  }
+
+  /**
+   * @brief Moves the dense array for the specified component type to new memory.
+   * 
+   * The old components are destroyed, but the old array is not freed. Like reallocate, components
+   * that are trivially move assignable are simply copied bytewise.
+   * 
+   * @tparam Component The component type of the dense array to move.
+   * @param pool New dense arrays
+   */
+  template<typename Component>
+  void transfer(component_pool_type& pool)
+  {
+    Component* old_array = access<Component>();
+    Component* new_array = std::get<Component*>(pool);
+
+    if constexpr (std::is_trivially_copyable_v<Component> || std::is_trivially_move_assignable_v<Component>)
+    {
+      std::memcpy(static_cast<void*>(new_array), old_array, _size * sizeof(Component));
+    }
+    else
+    {
+      for (size_t i = 0; i < _size; i++)
+      {
+        new (new_array + i) Component(std::move(old_array[i]));
+
+        old_array[i].~Component();
+      }
+    }
+  }
+
+  /**
+   * @brief Allocates dense arrays for the specified capacity.
+   * 
+   * With a single allocation policy, the dense entity array and every component column are
+   * parts of the same block, in that order, every column starting on its own cache line (see partition).
+   * Large arrays that can be shared with forks are always a block of a cow_memory (see mapped).
+   * 
+   * @param capacity Amount of entities the arrays can hold
+   * @param pool Component arrays, set to the allocated columns
+   * @return dense_type Dense entity array
+   */
+  static dense_type allocate(const size_type capacity, component_pool_type& pool)
+  {
+    if (mapped(capacity)) return partition(static_cast<char*>(cow_memory::allocate(block_size(capacity))), capacity, pool);
+
+    if constexpr (Policy::single_allocation)
+    {
+      if (capacity == 0)
+      {
+        ((std::get<Components*>(pool) = NULL), ...);
+        return NULL;
+      }
+
+      // Malloc only aligns to the largest fundamental alignment, the block must start on a column boundary
+#if _MSC_VER
+      char* memory = static_cast<char*>(_aligned_malloc(block_size(capacity), column_alignment));
+#else
+      char* memory = static_cast<char*>(std::aligned_alloc(column_alignment, block_size(capacity)));
+#endif
+
+      return partition(memory, capacity, pool);
+    }
+    else
+    {
+      ((std::get<Components*>(pool) = static_cast<Components*>(std::malloc(capacity * sizeof(Components)))), ...);
+
+      return static_cast<dense_type>(std::malloc(capacity * sizeof(entity_type)));
+    }
+  }
+
+  /**
+   * @brief Splits a block into the dense entity array and every column.
+   * 
+   * @param memory Block of atleast block_size(capacity) bytes, aligned to the column alignment
+   * @param capacity Amount of entities the block can hold
+   * @param pool Component arrays, set to the columns of the block
+   * @return dense_type Dense entity array, the start of the block
+   */
+  static dense_type partition(char* memory, const size_type capacity, component_pool_type& pool)
+  {
+    size_type offset = column_size(capacity, sizeof(entity_type));
+    ((std::get<Components*>(pool) = reinterpret_cast<Components*>(memory + offset), offset += column_size(capacity, sizeof(Components))), ...);
+
+    return reinterpret_cast<dense_type>(memory);
+  }
+
+  /**
+   * @brief Frees dense arrays without destroying their components.
+   * 
+   * @param dense Dense entity array
+   * @param pool Dense component arrays
+   * @param capacity Capacity the arrays were allocated with
+   */
+  static void deallocate(dense_type dense, const component_pool_type& pool, const size_type capacity)
+  {
+    if (mapped(capacity)) cow_memory::deallocate(dense, block_size(capacity));
+    else if constexpr (Policy::single_allocation)
+    {
+      (void)pool; // Suppress unused warning
+
+#if _MSC_VER
+      _aligned_free(dense);
+#else
+      free(dense);
+#endif
+    }
+    else
+    {
+      free(dense);
+      (free(std::get<Components*>(pool)), ...);
+    }
+  }
+
+
+  /**
+   * @brief Copies the chunks of the range for every snapshot that still reads them from the storage.
+   * 
+   * After a chunk copy is published, waits for the readers that were already reading the
+   * chunk from the storage, this is at most the time to read one chunk.
+   * 
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   */
+  void copy_on_write(const size_type first, const size_type last)
+  {
+    std::lock_guard<std::mutex> lock(_snapshot_mutex);
+
+    _changed = true;
+
+    prune();
+
+    for (auto& weak : _frozen)
+    {
+      auto state = weak.lock();
+
+      // Snapshots that own their arrays do not read the storage anymore
+      if (!state || state->live != _base) continue;
+
+      const size_type end = last < state->size ? last : state->size;
+
+      for (size_type chunk = first / snapshot_chunk_size; chunk * snapshot_chunk_size < end; chunk++)
+      {
+        if (state->chunks[chunk].load(std::memory_order_relaxed)) continue;
+
+        const size_type offset = chunk * snapshot_chunk_size;
+        const size_type count = state->size - offset < snapshot_chunk_size ? state->size - offset : snapshot_chunk_size;
+
+        auto copy = new chunk_copy { NULL, {}, count };
+
+        copy->dense = allocate(count, copy->pool);
+
+        std::memcpy(copy->dense, _dense + offset, count * sizeof(entity_type));
+
+        (copy_chunk<Components>(copy->pool, offset, count), ...);
+
+        state->chunks[chunk].store(copy, std::memory_order_seq_cst);
+
+        while (state->readers[chunk].load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+      }
+    }
+  }
+
+  /**
+   * @brief Copies a range of the dense array of the specified component type into a chunk copy.
+   * 
+   * @tparam Component The component type of the dense array to copy
+   * @param pool Dense arrays of the chunk copy
+   * @param offset First index of the range
+   * @param count Amount of components to copy
+   */
+  template<typename Component>
+  void copy_chunk(component_pool_type& pool, const size_type offset, const size_type count)
+  {
+    Component* copy = std::get<Component*>(pool);
+
+    if constexpr (std::is_trivially_copyable_v<Component>)
+    {
+      std::memcpy(static_cast<void*>(copy), access<Component>() + offset, count * sizeof(Component));
+    }
+    else
+    {
+      for (size_type i = 0; i < count; i++) new (copy + i) Component(access<Component>()[offset + i]);
+    }
+  }
+
+  /**
+   * @brief Initializes the components of the specified component type in the range [first, last).
+   * 
+   * Included components are copied from their value, other components are default constructed.
+   * 
+   * @tparam Component The component type of the dense array to initialize
+   * @tparam Tuple Tuple of references to the included components
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   * @param values References to the included components
+   */
+  template<typename Component, typename Tuple>
+  void broadcast_column(const size_type first, const size_type last, const Tuple& values)
+  {
+    if constexpr (contains_v<const Component&, Tuple>)
+    {
+      const Component& value = std::get<const Component&>(values);
+
+      if constexpr (std::is_trivially_copyable_v<Component>) fill(first, last, value);
+      else
+      {
+        for (size_type i = first; i < last; i++) new (access<Component>() + i) Component(value);
+      }
+    }
+    else
+    {
+      (void)values; // Suppress unused warning
+
+      for (size_type i = first; i < last; i++) construct<Component>(i);
+    }
+  }
+
+  /**
+   * @brief Marks the zones and the indexed keys of the chunks of the range [first, last) as stale.
+   * 
+   * Called by parallel writes, neighbour ranges may share a zone chunk.
+   * 
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   */
+  void stale(const size_type first, const size_type last)
+  {
+    const size_type end = (last + zone_chunk_size - 1) / zone_chunk_size;
+
+    for (size_type chunk = first / zone_chunk_size; chunk < end && chunk < _fresh.size(); chunk++) _fresh.store(chunk, 0);
+    for (size_type chunk = first / zone_chunk_size; chunk < end && chunk < _indexed.size(); chunk++) _indexed.store(chunk, 0);
+
+    if constexpr (indexed) _reindex.store(true, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Computes the zones of a chunk for every component with a key, if they are stale.
+   * 
+   * @param chunk Index of the chunk
+   */
+  void refresh(const size_type chunk)
+  {
+    if (chunk >= _fresh.size()) _fresh.resize(chunk + 1, 0);
+
+    if (_fresh.load(chunk)) return;
+
+    const size_type first = chunk * zone_chunk_size;
+    const size_type last = first + zone_chunk_size < _size ? first + zone_chunk_size : _size;
+
+    (refresh<Components>(chunk, first, last), ...);
+
+    _fresh.store(chunk, 1);
+  }
+
+  /**
+   * @brief Computes the zone of a chunk for the specified component type.
+   * 
+   * Does nothing for components without a key.
+   * 
+   * @tparam Component The component type of the key
+   * @param chunk Index of the chunk
+   * @param first First index of the chunk
+   * @param last Index after the last index of the chunk
+   */
+  template<typename Component>
+  void refresh(const size_type chunk, const size_type first, const size_type last)
+  {
+    if constexpr (has_zone_key_v<Component>)
+    {
+      auto& zones = std::get<find_v<Component, list<Components...>>>(_zones);
+
+      if (chunk >= zones.size()) zones.resize(chunk + 1);
+
+      auto& zone = zones[chunk];
+
+      if (first >= last) return;
+
+      zone.low = zone.high = zone_key<Component>::key(access<Component>()[first]);
+
+      for (size_type i = first + 1; i < last; i++) internal::widen(zone.low, zone.high, zone_key<Component>::key(access<Component>()[i]));
+    }
+    else
+    {
+      (void)chunk; // Suppress unused warning
+      (void)first;
+      (void)last;
+    }
+  }
+
+  /**
+   * @brief Indexes the keys of every stale chunk, for every component with an index key.
+   */
+  void reindex()
+  {
+    if (!_reindex.load(std::memory_order_relaxed)) return;
+
+    _reindex.store(false, std::memory_order_relaxed);
+
+    const size_type chunks = (_size + zone_chunk_size - 1) / zone_chunk_size;
+
+    if (_indexed.size() < chunks) _indexed.resize(chunks, 0);
+
+    (reindex<Components>(chunks), ...);
+
+    for (size_type chunk = 0; chunk < chunks; chunk++) _indexed.store(chunk, 1);
+  }
+
+  /**
+   * @brief Indexes the keys of every stale chunk for the specified component type.
+   * 
+   * Changed keys are all removed before the new keys are added, so that entities can exchange keys.
+   * Does nothing for components without an index key.
+   * 
+   * @tparam Component The component type of the key
+   * @param chunks Amount of chunks in the storage
+   */
+  template<typename Component>
+  void reindex(const size_type chunks)
+  {
+    if constexpr (has_index_key_v<Component>)
+    {
+      auto& [map, keys] = std::get<find_v<Component, list<Components...>>>(_lookups);
+
+      const size_type previous = keys.size();
+
+      // Entities that were erased
+      for (size_type i = _size; i < previous; i++) map.erase(keys[i].second, keys[i].first);
+
+      const size_type kept = _size < previous ? _size : previous;
+
+      for (size_type chunk = 0; chunk < chunks; chunk++)
+      {
+        if (_indexed.load(chunk)) continue;
+
+        const size_type last = (chunk + 1) * zone_chunk_size < kept ? (chunk + 1) * zone_chunk_size : kept;
+
+        for (size_type i = chunk * zone_chunk_size; i < last; i++)
+        {
+          if (keys[i].first != _dense[i] || !(keys[i].second == index_key<Component>::key(access<Component>()[i])))
+          {
+            map.erase(keys[i].second, keys[i].first);
+          }
+        }
+      }
+
+      keys.resize(_size);
+
+      for (size_type chunk = 0; chunk < chunks; chunk++)
+      {
+        if (_indexed.load(chunk)) continue;
+
+        const size_type last = (chunk + 1) * zone_chunk_size < _size ? (chunk + 1) * zone_chunk_size : _size;
+
+        for (size_type i = chunk * zone_chunk_size; i < last; i++)
+        {
+          auto key = index_key<Component>::key(access<Component>()[i]);
+
+          if (i >= previous || keys[i].first != _dense[i] || !(keys[i].second == key))
+          {
+            map.insert(key, _dense[i]);
+            keys[i] = { _dense[i], std::move(key) };
+          }
+        }
+      }
+    }
+    else
+      (void)chunks; // Suppress unused warning
+  }
+
+  /**
+   * @brief Resizes the change tracking arrays that have one element per entity or per chunk.
+   * 
+   * @param capacity New capacity of the storage
+   */
+  void track(const size_type capacity)
+  {
+    if constexpr (computing) _outdated.resize(capacity, 0);
+
+    _versions.resize((capacity + version_chunk_size - 1) / version_chunk_size, 0);
   }
 
   /**
-   * @brief Returns a reference of the stored component for the specified entity and component type.
-   * 
-   * This operation simply optains the index of the entity and access the dense array that holds
-   * the component of requested type.
+   * @brief Gives the chunks of the range [first, last) a new version.
    * 
-   * Very cheap operation, however unpacking from the iterator doesn't require recalculating the index
-   * every time, so try to prioritize that (even if its a very cheap to find the index).
-   * 
-   * @tparam Component Type of component to unpack
-   * @param entity Entity to unpack component for
-   * @return Component& Reference to component belonging to the entity
+   * @param first First index of the range
+   * @param last Index after the last index of the range
    */
-  template<typename Component>
-  Component& unpack(const entity_type entity)
+  void change(const size_type first, const size_type last)
   {
-    static_assert(contains_v<Component, list<Components...>>,
-      "The component your trying to unpack does not belong to the archetype");
+    const uint64_t version = _version.fetch_add(1, std::memory_order_acq_rel) + 1;
 
-    return access<Component>()[(*_sparse)[entity]];
+    const size_type end = (last + version_chunk_size - 1) / version_chunk_size;
+
+    for (size_type chunk = first / version_chunk_size; chunk < end && chunk < _versions.size(); chunk++) _versions.store(chunk, version);
   }
 
   /**
-   * @brief Resizes every internal dense array to be as small as possible.
+   * @brief Marks computed components of the entities in the range [first, last) as outdated.
    * 
-   * This is good to call every once in a while to optimize memory usage.
-   * 
-   * @note This does not resize the sparse_array
+   * @param first First index of the range
+   * @param last Index after the last index of the range
+   * @param bits Outdated flags of the computed components
    */
-  void shrink_to_fit()
+  void outdate(const size_type first, const size_type last, const uint8_t bits)
   {
-    if (_size != _capacity)
-    {
-      _capacity = _size;
+    const size_type end = last < _outdated.size() ? last : _outdated.size();
 
-      _dense = static_cast<dense_type>(std::realloc(_dense, _capacity * sizeof(entity_type)));
-      (reallocate<Components>(), ...);
-    }
+    for (size_type i = first; i < end; i++) _outdated[i] |= bits;
   }
 
   /**
-   * @brief Binds the shared sparse_array to this storage.
-   * 
-   * Sharing sparse_arrays between storages that operate on entities distributed by the
-   * same entity_manager is recommended for performance and memory usage.
+   * @brief Gives the buffers of the entities in the range [first, last) their own blocks in the arena of the storage.
    * 
-   * @warning Attemping to share a sparse array while already containing entities
-   * will no nothing.
+   * Inserted buffers are copies, their blocks belong to other entities (maybe of other storages).
    * 
-   * @param sparse The sparse_array to share with this storage
+   * @tparam Component Component type, does nothing if it is not a buffer
+   * @param first First index of the range
+   * @param last Index after the last index of the range
    */
-  void share(sparse_type sparse)
+  template<typename Component>
+  void adopt(const size_type first, const size_type last)
   {
-    if (_size != 0) return;
+    if constexpr (is_buffer_v<Component>)
+    {
+      auto& arena = std::get<find_v<Component, list<Components...>>>(_arenas);
 
-    if (_sparse->shared()) _sparse->unshare();
+      for (size_type i = first; i < last; i++) access<Component>()[i].adopt(&arena);
+    }
     else
-      // If the sparse_array is not shared that means we current have the default sparse_array
-      // allocated at initialization and we must delete it.
-      delete _sparse;
-
-    _sparse = sparse;
-    sparse->share();
+    {
+      (void)first; // Suppress unused warning
+      (void)last; // Suppress unused warning
+    }
   }
 
   /**
-   * @brief clears the entire storage
+   * @brief Releases the block of the buffer of the entity at the specified index.
    * 
-   * As cheap of an operation as you can get (sets size to zero).
+   * @tparam Component Component type, does nothing if it is not a buffer
+   * @param index Index of the entity
    */
-  void clear() { _size = 0; }
+  template<typename Component>
+  void release_buffer(const size_type index)
+  {
+    if constexpr (is_buffer_v<Component>) access<Component>()[index].release();
+    else
+      (void)index; // Suppress unused warning
+  }
 
   /**
-   * @brief Returns an iterator of the first entity of the dense array.
-   * 
-   * If the storage is empty the begining with be equal to the end.
+   * @brief Releases every block of the arena of a buffer component.
    * 
-   * @return iterator Dense array iterator begining
+   * @tparam Component Component type, does nothing if it is not a buffer
    */
-  iterator begin() { return { this, _size - 1 }; }
+  template<typename Component>
+  void clear_arena()
+  {
+    if constexpr (is_buffer_v<Component>) std::get<find_v<Component, list<Components...>>>(_arenas).clear();
+  }
 
   /**
-   * @brief Returns an iterator at the last entity of the dense array.
-   * 
-   * If the storage is empty the begining with be equal to the end.
+   * @brief Copies the arena of a buffer component to a fork, then makes the buffers of the fork use the copy.
    * 
-   * @return iterator Dense array iterator end
+   * @tparam Component Component type, does nothing if it is not a buffer
+   * @param fork Fork of this storage, with copies of the columns
    */
-  iterator end() { return { this, static_cast<size_type>(-1) }; }
+  template<typename Component>
+  void rebind(storage& fork)
+  {
+    if constexpr (is_buffer_v<Component>)
+    {
+      auto& arena = std::get<find_v<Component, list<Components...>>>(fork._arenas);
+
+      arena.assign(std::get<find_v<Component, list<Components...>>>(_arenas));
+
+      for (size_type i = 0; i < _size; i++) fork.template access<Component>()[i].rebind(&arena);
+    }
+    else
+      (void)fork; // Suppress unused warning
+  }
 
   /**
-   * @brief Returns the amount of entites current held by the storage.
+   * @brief Computes a computed component of the entity at the specified index from its inputs.
    * 
-   * @return size_type Amount of entities currently in storage
+   * @tparam Component The component type to compute
+   * @tparam Inputs Input component types
+   * @param index Index of the entity
    */
-  [[nodiscard]] size_type size() const { return _size; }
+  template<typename Component, typename... Inputs>
+  void compute_at(const size_type index, list<Inputs...>)
+  {
+    computed<Component>::compute(access<Component>()[index], std::as_const(access<Inputs>()[index])...);
+  }
 
   /**
-   * @brief Returns the current entity capacity of the storage.
-   * 
-   * If this is equal to the size, the next insert operation if no entites
-   * are removed will result in a resize of all internal dense arrays.
+   * @brief Removes the snapshots that were destroyed.
    * 
-   * @return size_type Current capacity of entities in storage
+   * Once there are no snapshots left, the storage stops copying on write.
    */
-  [[nodiscard]] size_type capacity() const { return _capacity; }
+  void prune()
+  {
+    for (size_type i = 0; i < _frozen.size();)
+    {
+      if (_frozen[i].expired())
+      {
+        _frozen[i] = std::move(_frozen.back());
+        _frozen.pop_back();
+      }
+      else
+        i++;
+    }
+
+    _frozen_count.store(_frozen.size(), std::memory_order_relaxed);
+  }
 
   /**
-   * @brief Returns whether or not the storage is empty.
+   * @brief Destroys and frees dense arrays, or retires them if an epoch_manager is specified.
    * 
-   * The storage is empty when there are not entities currently being
-   * stored in it.
-   * 
-   * @return true If the storage is empty, false otherwise
+   * @param dense Dense entity array
+   * @param pool Dense component arrays
+   * @param capacity Capacity the arrays were allocated with
+   * @param count Amount of constructed components
+   * @param epochs The epoch_manager to retire to, NULL to free immediately
    */
-  [[nodiscard]] bool empty() const { return _size == 0; }
+  static void release(dense_type dense, const component_pool_type& pool, const size_type capacity, const size_type count, epoch_manager* epochs)
+  {
+    if (Policy::single_allocation || mapped(capacity))
+    {
+      // Columns are not separate allocations, the whole block is released at once
+      if (epochs) epochs->retire_object(new base { dense, pool, capacity, count, true, NULL });
+      else
+      {
+        (destroy<Components>(std::get<Components*>(pool), count), ...);
+        deallocate(dense, pool, capacity);
+      }
+    }
+    else if (epochs)
+    {
+      epochs->retire(static_cast<void*>(dense));
+      (epochs->retire(std::get<Components*>(pool), count), ...);
+    }
+    else
+    {
+      free(dense);
+      (release<Components>(std::get<Components*>(pool), count), ...);
+    }
+  }
 
-private:
   /**
-   * @brief Grows the sparse set allocated space.
-   * 
-   * This grows the dense entity array and all the dense component arrays.
+   * @brief Destroys and frees a dense component array.
    * 
-   * Growth is exponential with a small linear amount.
+   * @tparam Component The component type of the array
+   * @param array The array to free
+   * @param count Amount of constructed components
    */
-  void grow()
+  template<typename Component>
+  static void release(Component* array, const size_type count)
   {
-    // This is essentially _capacity * 1.5 + 8
-    // Note: Must try to find optimal growth rate for better reallocation
-    _capacity = (_capacity * 3) / 2 + 8;
+    if (!array) return;
+
+    destroy(array, count);
 
-    // Grow all arrays together
-    _dense = static_cast<dense_type>(std::realloc(_dense, _capacity * sizeof(entity_type)));
-    (reallocate<Components>(), ...);
+    free(array);
   }
 
   /**
-   * @brief Deallocates the dense array for the specified component type.
-   * 
-   * Uses free under the hood. If the destructor is not trivial, it will call it 
-   * explicitly.
+   * @brief Destroys the components of a dense component array without freeing it.
    * 
-   * @tparam Component The component type of the dense array to deallocate.
+   * @tparam Component The component type of the array
+   * @param array The array of components
+   * @param count Amount of constructed components
    */
   template<typename Component>
-  void deallocate()
+  static void destroy(Component* array, const size_type count)
   {
     if constexpr (!std::is_trivially_destructible_v<Component>)
     {
-      for (size_t i = 0; i < _size; i++)
-      {
-        access<Component>()[i].~Component();
-      }
+      for (size_type i = 0; i < count; i++) array[i].~Component();
+    }
+    else
+    {
+      (void)array; // Suppress unused warning
+      (void)count;
     }
+  }
 
-    free(access<Component>());
+  /**
+   * @brief Publishes the size of the storage to readers.
+   * 
+   * Does nothing if the storage is not bound to an epoch_manager.
+   */
+  void publish()
+  {
+    if (_epochs) _published.store(_size, std::memory_order_release);
   }
 
   /**
@@ -502,6 +3042,22 @@ private:
     }
   }
 
+  /**
+   * @brief Swaps two entities and their components.
+   * 
+   * @param lhs Index of the first entity
+   * @param rhs Index of the second entity
+   */
+  void swap(const size_type lhs, const size_type rhs)
+  {
+    std::swap(_dense[lhs], _dense[rhs]);
+
+    ((std::swap(access<Components>()[lhs], access<Components>()[rhs])), ...);
+
+    (*_sparse)[_dense[lhs]] = static_cast<index_type>(lhs);
+    (*_sparse)[_dense[rhs]] = static_cast<index_type>(rhs);
+  }
+
   /**
    * @brief Calls the constructor on an component at the specified index.
    * 
@@ -564,10 +3120,39 @@ private:
 
   size_type _size;
   size_type _capacity;
+  size_type _high_water;
+
+  epoch_manager* _epochs;
+  std::atomic<block*> _block;
+  std::atomic<size_type> _published;
+
+  std::mutex _snapshot_mutex;
+  std::shared_ptr<base> _base;
+  std::vector<std::weak_ptr<frozen>> _frozen;
+  std::atomic<size_type> _frozen_count;
+  bool _changed;
+
+  std::tuple<typename zones<Components>::type...> _zones;
+  atomic_array<uint8_t> _fresh;
+
+  std::tuple<typename lookups<Components>::type...> _lookups;
+  atomic_array<uint8_t> _indexed;
+  std::atomic<bool> _reindex;
+
+  std::vector<uint8_t> _outdated;
+
+  std::tuple<typename arenas<Components>::type...> _arenas;
+
+  std::atomic<uint64_t> _version;
+  atomic_array<uint64_t> _versions;
+
+  std::vector<size_type> _order;
+
+  std::conditional_t<fixed, fixed_memory, growable_memory> _memory;
 };
 
-template<typename Entity, typename... Components>
-class storage<Entity, archetype<Components...>>::iterator final
+template<typename Entity, typename... Components, typename Policy>
+class storage<Entity, archetype<Components...>, Policy>::iterator final
 {
 public:
   using iterator_category = std::random_access_iterator_tag;
@@ -620,7 +3205,7 @@ public:
   template<typename Component>
   [[nodiscard]] const Component& unpack() const
   {
-    return _ptr->access<Component>()[_pos];
+    return _ptr->template access<std::remove_const_t<Component>>()[_pos];
   }
 
   /*! @copydoc unpack */
@@ -634,6 +3219,204 @@ private:
   storage* const _ptr;
   size_type _pos;
 };
+
+/**
+ * @brief Inserts entities into reserved space of a storage from many threads at once.
+ * 
+ * Every insert reserves a slot with a single atomic increment, then writes the entity, its
+ * components and its sparse index without any lock. Inserted entities become visible in the storage
+ * when the appender is committed, which is done automatically when the appender is destroyed.
+ * 
+ * Obtained with storage::append.
+ */
+template<typename Entity, typename... Components, typename Policy>
+class storage<Entity, archetype<Components...>, Policy>::appender final
+{
+public:
+  appender(storage* const ptr, const size_type count)
+    : _ptr { ptr }, _next { ptr->_size }, _limit { ptr->_size + count }
+  {}
+
+  /**
+   * @brief Destroy the appender object
+   * 
+   * Commits the inserted entities.
+   */
+  ~appender() { commit(); }
+
+  appender(const appender&) = delete;
+  appender(appender&&) = delete;
+  appender& operator=(const appender&) = delete;
+  appender& operator=(appender&&) = delete;
+
+  /**
+   * @brief Inserts a entity and all its components in the reserved space.
+   * 
+   * This method is thread-safe and lock-free.
+   * 
+   * @warning Undefined behaviour if the entity already exists or is larger than the
+   * entity specified to storage::append.
+   * 
+   * @tparam IncludedComponents Types of components to insert with (optional).
+   * @param entity Entity to insert
+   * @param components Components to insert alongside entity
+   * @return true If the entity was inserted, false if the reserved space is full
+   */
+  template<typename... IncludedComponents>
+  bool insert(const entity_type entity, const IncludedComponents&... components)
+  {
+    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
+      "One or more included components do not belong to the archetype");
+    static_assert(unique_types_v<IncludedComponents...>,
+      "Included components are not unique");
+
+    const size_type index = _next.fetch_add(1, std::memory_order_relaxed);
+
+    if (index >= _limit) return false;
+
+    _ptr->_dense[index] = entity;
+
+    // Call the constructors if needed
+    (_ptr->template construct<Components>(index), ...);
+
+    ((_ptr->template access<IncludedComponents>()[index] = components), ...);
+
+    (*_ptr->_sparse)[entity] = static_cast<index_type>(index);
+
+    return true;
+  }
+
+  /**
+   * @brief Makes the inserted entities visible in the storage.
+   * 
+   * Must be called once every thread is done inserting.
+   * 
+   * @return size_type Amount of entities that were committed
+   */
+  size_type commit()
+  {
+    const size_type next = _next.load(std::memory_order_acquire);
+    const size_type last = next < _limit ? next : _limit;
+    const size_type committed = last - _ptr->_size;
+
+    // Buffers share the arena, they are adopted here instead of by the inserting threads
+    if constexpr (buffered) (_ptr->template adopt<Components>(_ptr->_size, last), ...);
+
+    _ptr->_size = last;
+    _ptr->publish();
+
+    return committed;
+  }
+
+  /**
+   * @brief Returns the amount of entities that can still be inserted.
+   * 
+   * @return size_type Amount of reserved slots left
+   */
+  [[nodiscard]] size_type remaining() const
+  {
+    const size_type next = _next.load(std::memory_order_relaxed);
+
+    return next < _limit ? _limit - next : 0;
+  }
+
+private:
+  storage* const _ptr;
+  std::atomic<size_type> _next;
+  const size_type _limit;
+};
+
+/**
+ * @brief Read-only, point-in-time snapshot of a storage.
+ * 
+ * A snapshot can be read from any thread while the storage keeps being modified. The entities
+ * and components seen are always the ones that were in the storage when the snapshot was taken.
+ * 
+ * Snapshots are handles, copies share the same state. The state is released with the last copy.
+ * 
+ * Obtained with storage::freeze.
+ */
+template<typename Entity, typename... Components, typename Policy>
+class storage<Entity, archetype<Components...>, Policy>::snapshot final
+{
+public:
+  /**
+   * @brief Construct an empty snapshot
+   */
+  snapshot() = default;
+
+  explicit snapshot(std::shared_ptr<frozen> state) : _state(std::move(state)) {}
+
+  /**
+   * @brief Iterates over every entity of the snapshot and calls the given function with the specified components.
+   * 
+   * @warning While a chunk is being read from the storage, a writer that writes it for the first
+   * time waits for the read to finish, keep the callable short.
+   * 
+   * @tparam IncludedComponents Types of components to read
+   * @tparam Callable Callable type
+   * @param callable The callable to invoke on every entity
+   */
+  template<typename... IncludedComponents, typename Callable>
+  void for_each(const Callable& callable) const
+  {
+    static_assert(contains_all_v<list<Components...>, IncludedComponents...>,
+      "One or more included components do not belong to the archetype");
+
+    if (!_state) return;
+
+    for (size_type chunk = 0; chunk * snapshot_chunk_size < _state->size; chunk++)
+    {
+      const size_type offset = chunk * snapshot_chunk_size;
+      const size_type count = _state->size - offset < snapshot_chunk_size ? _state->size - offset : snapshot_chunk_size;
+
+      auto& readers = _state->readers[chunk];
+
+      readers.fetch_add(1, std::memory_order_seq_cst);
+
+      if (const chunk_copy* copy = _state->chunks[chunk].load(std::memory_order_seq_cst))
+      {
+        // Copies are never written, no need to hold the chunk
+        readers.fetch_sub(1, std::memory_order_release);
+
+        read<IncludedComponents...>(copy->dense, copy->pool, 0, count, callable);
+      }
+      else
+      {
+        read<IncludedComponents...>(_state->live->dense, _state->live->pool, offset, count, callable);
+
+        readers.fetch_sub(1, std::memory_order_release);
+      }
+    }
+  }
+
+  /**
+   * @brief Returns the amount of entities in the snapshot.
+   * 
+   * @return size_type Amount of entities
+   */
+  [[nodiscard]] size_type size() const { return _state ? _state->size : 0; }
+
+  /**
+   * @brief Returns whether or not the snapshot is empty.
+   * 
+   * @return true If the snapshot is empty, false otherwise
+   */
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+private:
+  template<typename... IncludedComponents, typename Callable>
+  static void read(const entity_type* dense, const component_pool_type& pool, const size_type offset, const size_type count, const Callable& callable)
+  {
+    for (size_type i = offset; i < offset + count; i++)
+    {
+      callable(dense[i], static_cast<const IncludedComponents&>(std::get<IncludedComponents*>(pool)[i])...);
+    }
+  }
+
+private:
+  std::shared_ptr<frozen> _state;
+};
 } // namespace xecs
 
 #endif
\ No newline at end of file
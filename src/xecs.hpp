@@ -1,4 +1,17 @@
+#include "access.hpp"
 #include "archetype.hpp"
+#include "buffer.hpp"
+#include "computed.hpp"
+#include "coroutine.hpp"
+#include "cow_memory.hpp"
 #include "entity_manager.hpp"
+#include "epoch.hpp"
+#include "execution.hpp"
+#include "index.hpp"
+#include "numa.hpp"
+#include "policy.hpp"
 #include "registry.hpp"
-#include "storage.hpp"
\ No newline at end of file
+#include "scheduler.hpp"
+#include "sparse_storage.hpp"
+#include "storage.hpp"
+#include "zone.hpp"
\ No newline at end of file
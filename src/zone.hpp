@@ -0,0 +1,149 @@
+#ifndef XECS_ZONE_HPP
+#define XECS_ZONE_HPP
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+namespace xecs
+{
+/**
+ * @brief Key of a component summarized by zone maps.
+ * 
+ * Components have no key by default. To summarize a component, specialize this struct with
+ * a key type and a key function, for example:
+ * 
+ * template<>
+ * struct xecs::zone_key<Health>
+ * {
+ *   using type = float;
+ *   static type key(const Health& health) { return health.value; }
+ * };
+ * 
+ * The key is either an arithmetic type or a std::array of an arithmetic type (for example the
+ * three coordinates of a position), arrays are compared field by field.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component>
+struct zone_key
+{};
+
+/**
+ * @brief Whether or not a component has a key summarized by zone maps.
+ * 
+ * @tparam Component Component type
+ */
+template<typename Component, typename = void>
+struct has_zone_key : std::false_type
+{};
+
+template<typename Component>
+struct has_zone_key<Component, std::void_t<typename zone_key<Component>::type>> : std::true_type
+{};
+
+template<typename Component>
+constexpr auto has_zone_key_v = has_zone_key<Component>::value;
+
+template<typename Component>
+using zone_key_t = typename zone_key<Component>::type;
+
+namespace internal
+{
+  /**
+   * @brief Returns whether or not every field of a key is smaller or equal to the same field of another key.
+   * 
+   * @tparam Key Key type
+   * @param lhs Left key
+   * @param rhs Right key
+   * @return true If lhs <= rhs for every field
+   */
+  template<typename Key>
+  bool fields_less_equal(const Key& lhs, const Key& rhs)
+  {
+    if constexpr (std::is_arithmetic_v<Key>) return lhs <= rhs;
+    else
+    {
+      for (size_t i = 0; i < std::tuple_size_v<Key>; i++)
+      {
+        if (!(lhs[i] <= rhs[i])) return false;
+      }
+
+      return true;
+    }
+  }
+
+  /**
+   * @brief Widens a zone so that it contains a key, field by field.
+   * 
+   * @tparam Key Key type
+   * @param low Smallest value of every field
+   * @param high Largest value of every field
+   * @param key Key to contain
+   */
+  template<typename Key>
+  void widen(Key& low, Key& high, const Key& key)
+  {
+    if constexpr (std::is_arithmetic_v<Key>)
+    {
+      if (key < low) low = key;
+      if (high < key) high = key;
+    }
+    else
+    {
+      for (size_t i = 0; i < std::tuple_size_v<Key>; i++) widen(low[i], high[i], key[i]);
+    }
+  }
+} // namespace internal
+
+/**
+ * @brief Inclusive range of keys, used as the predicate of filtered iteration.
+ * 
+ * For std::array keys, the range is a box: every field must be inside its own range.
+ * 
+ * @tparam Key Key type
+ */
+template<typename Key>
+struct range
+{
+  Key min; ///< Smallest key in the range
+  Key max; ///< Largest key in the range
+
+  /**
+   * @brief Returns whether or not the range contains a key.
+   * 
+   * @param key Key to check
+   * @return true If the key is in the range, false otherwise
+   */
+  [[nodiscard]] bool contains(const Key& key) const
+  {
+    return internal::fields_less_equal(min, key) && internal::fields_less_equal(key, max);
+  }
+
+  /**
+   * @brief Returns whether or not the range overlaps a zone.
+   * 
+   * @param low Smallest value of every field in the zone
+   * @param high Largest value of every field in the zone
+   * @return true If a key of the zone can be in the range, false otherwise
+   */
+  [[nodiscard]] bool overlaps(const Key& low, const Key& high) const
+  {
+    return internal::fields_less_equal(min, high) && internal::fields_less_equal(low, max);
+  }
+};
+
+/**
+ * @brief Smallest and largest value of every field of the keys in a chunk.
+ * 
+ * @tparam Key Key type
+ */
+template<typename Key>
+struct zone
+{
+  Key low;
+  Key high;
+};
+} // namespace xecs
+
+#endif
@@ -0,0 +1,268 @@
+#include <coroutine.hpp>
+#include <gtest/gtest.h>
+#include <registry.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+using namespace xecs;
+
+namespace
+{
+struct Request
+{
+  int id;
+};
+
+struct Path
+{
+  int length;
+};
+
+template<typename Registry>
+system_task find_path(Registry& registry, typename Registry::entity_type entity, deferred<int> query)
+{
+  const int length = co_await query;
+
+  if (auto* path = registry.template try_unpack<Path>(entity)) path->length = length;
+}
+
+system_task count_frames(phase& phase, int& frames)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    co_await phase.next();
+    frames++;
+  }
+}
+
+system_task fail()
+{
+  throw std::runtime_error("error");
+  co_return;
+}
+} // namespace
+
+TEST(Coroutine, Spawn_RunsUntilFirstAwait)
+{
+  phase phase;
+
+  int frames = 0;
+
+  phase.spawn(count_frames(phase, frames));
+
+  ASSERT_EQ(frames, 0);
+  ASSERT_EQ(phase.running(), 1);
+}
+
+TEST(Coroutine, Next_ResumedOncePerPhase)
+{
+  phase phase;
+
+  int frames = 0;
+
+  phase.spawn(count_frames(phase, frames));
+
+  ASSERT_EQ(phase.resume(), 1);
+  ASSERT_EQ(frames, 1);
+
+  phase.resume();
+  phase.resume();
+
+  ASSERT_EQ(frames, 3);
+  ASSERT_EQ(phase.running(), 0);
+}
+
+TEST(Coroutine, Deferred_CompletedElsewhere_AppliedOnResume)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Request, Path>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  phase phase;
+
+  auto entity = registry.create(Request { 1 }, Path { 0 });
+
+  deferred<int> query;
+
+  phase.spawn(find_path(registry, entity, query));
+
+  std::thread worker([query]() mutable
+    { query.complete(42); });
+  worker.join();
+
+  // Not applied until the phase is resumed
+  ASSERT_EQ(registry.unpack<Path>(entity).length, 0);
+
+  ASSERT_EQ(phase.resume(), 1);
+  ASSERT_EQ(registry.unpack<Path>(entity).length, 42);
+  ASSERT_EQ(phase.running(), 0);
+}
+
+TEST(Coroutine, Deferred_ComponentRemoved_NotApplied)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Request, Path>>::
+      add<archetype<Request>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  phase phase;
+
+  auto entity = registry.create(Request { 1 }, Path { 0 });
+
+  deferred<int> query;
+
+  phase.spawn(find_path(registry, entity, query));
+
+  registry.swap_archetype<Request>(entity);
+
+  query.complete(42);
+  phase.resume();
+
+  ASSERT_FALSE(registry.has<Path>(entity));
+  ASSERT_EQ(phase.running(), 0);
+}
+
+TEST(Coroutine, Deferred_AlreadyCompleted_ContinuesImmediately)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Request, Path>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  phase phase;
+
+  auto entity = registry.create(Request { 1 }, Path { 0 });
+
+  deferred<int> query;
+  query.complete(7);
+
+  phase.spawn(find_path(registry, entity, query));
+
+  ASSERT_EQ(registry.unpack<Path>(entity).length, 7);
+}
+
+TEST(Coroutine, Sender_TransformReduce_ResultOnResume)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(2);
+  phase phase;
+
+  for (int i = 1; i <= 10; i++) registry.create(i);
+
+  int total = 0;
+
+  auto system = [&]() -> system_task
+  {
+    total = co_await execution::transform_reduce(
+      scheduler, registry.view<int>(), 0, [](int a, int b)
+      { return a + b; },
+      [](auto, auto& value)
+      { return value; },
+      3);
+  };
+
+  phase.spawn(system());
+
+  while (phase.running())
+  {
+    phase.resume();
+    std::this_thread::yield();
+  }
+
+  ASSERT_EQ(total, 55);
+}
+
+TEST(Coroutine, Resume_SystemThrows_Rethrown)
+{
+  phase phase;
+
+  phase.spawn(fail());
+
+  ASSERT_THROW(phase.resume(), std::runtime_error);
+  ASSERT_EQ(phase.running(), 0);
+}
+
+TEST(Coroutine, Deferred_PhaseDestroyed_CompletionDropped)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Request, Path>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto phase = std::make_unique<xecs::phase>();
+
+  auto entity = registry.create(Request { 1 }, Path { 0 });
+
+  deferred<int> query;
+
+  phase->spawn(find_path(registry, entity, query));
+
+  phase.reset();
+
+  query.complete(42);
+
+  ASSERT_TRUE(query.ready());
+  ASSERT_EQ(registry.unpack<Path>(entity).length, 0);
+}
+
+TEST(Coroutine, Deferred_CompletedTwice_Throws)
+{
+  deferred<int> query;
+
+  query.complete(1);
+
+  ASSERT_THROW(query.complete(2), std::logic_error);
+}
+
+TEST(Coroutine, Sender_PhaseDestroyed_CompletionDropped)
+{
+  std::atomic<bool> started = false;
+  std::atomic<bool> release = false;
+
+  bool resumed = false;
+
+  auto work = [&]()
+  {
+    started = true;
+
+    while (!release) std::this_thread::yield();
+  };
+
+  {
+    scheduler scheduler(2);
+
+    auto phase = std::make_unique<xecs::phase>();
+
+    auto system = [&]() -> system_task
+    {
+      co_await (execution::schedule(scheduler) | execution::then(work));
+
+      resumed = true;
+    };
+
+    phase->spawn(system());
+
+    while (!started) std::this_thread::yield();
+
+    phase.reset();
+
+    release = true;
+  } // The scheduler completes the sender before it stops
+
+  ASSERT_FALSE(resumed);
+}
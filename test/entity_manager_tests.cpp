@@ -532,4 +532,70 @@ TEST(EntityManager, ShrinkToFit_MemoryOverhead)
   manager.shrink_to_fit();
 
   ASSERT_EQ(manager.heap_capacity(), manager.minimum_heap_capacity + 1);
-}
\ No newline at end of file
+}
+TEST(EntityManager, Reset_AfterRelease_ContinuesFromCounter)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  for (size_t i = 0; i < 100; i++) manager.generate();
+  for (entity_type i = 0; i < 50; i++) manager.release(i);
+
+  manager.reset(10);
+
+  ASSERT_EQ(manager.reusable(), 0);
+  ASSERT_EQ(manager.generate(), 10);
+}
+
+TEST(EntityManager, Reserve_Larger_HeapCapacity)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  manager.reserve(manager.minimum_heap_capacity * 4);
+
+  ASSERT_EQ(manager.heap_capacity(), manager.minimum_heap_capacity * 4);
+
+  manager.reserve(1);
+
+  ASSERT_EQ(manager.heap_capacity(), manager.minimum_heap_capacity * 4);
+}
+
+TEST(EntityManager, GenerateBlock_AfterRelease_Contiguous)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type>;
+
+  entity_manager_type manager;
+
+  for (entity_type i = 0; i < 10; i++) manager.generate();
+
+  manager.release(3);
+
+  ASSERT_EQ(manager.generate(100), 10);
+  ASSERT_EQ(manager.peek(), 110);
+  ASSERT_EQ(manager.generate(), 3);
+}
+
+TEST(EntityManager, Release_FixedCapacity_NoHeap)
+{
+  using entity_type = unsigned int;
+  using entity_manager_type = entity_manager<entity_type, 128>;
+
+  entity_manager_type manager;
+
+  ASSERT_EQ(manager.heap_capacity(), 0);
+
+  for (entity_type i = 0; i < 128; i++) manager.generate();
+  for (entity_type i = 0; i < 128; i++) manager.release(i);
+
+  manager.reserve(1024);
+
+  ASSERT_EQ(manager.stack_reusable(), 128);
+  ASSERT_EQ(manager.heap_capacity(), 0);
+  ASSERT_EQ(manager.generate(), 127);
+}
@@ -0,0 +1,76 @@
+#include <epoch.hpp>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+using namespace xecs;
+
+struct DestructorCounter
+{
+  int* _counter;
+
+  ~DestructorCounter()
+  {
+    (*_counter)++;
+  }
+};
+
+TEST(EpochManager, Slots_Zero_AtleastOne)
+{
+  epoch_manager epochs(0);
+
+  ASSERT_EQ(epochs.slots(), 1);
+}
+
+TEST(EpochManager, Collect_NoReaders_Reclaimed)
+{
+  epoch_manager epochs;
+
+  epochs.retire(std::malloc(16));
+
+  epochs.collect();
+  epochs.collect();
+
+  ASSERT_EQ(epochs.pending(), 0);
+}
+
+TEST(EpochManager, Collect_PinnedReader_NotReclaimed)
+{
+  epoch_manager epochs(2);
+
+  {
+    auto guard = epochs.pin(1);
+
+    epochs.retire(std::malloc(16));
+
+    for (int i = 0; i < 10; i++) epochs.collect();
+
+    ASSERT_EQ(epochs.pending(), 1);
+  }
+
+  epochs.collect();
+  epochs.collect();
+
+  ASSERT_EQ(epochs.pending(), 0);
+}
+
+TEST(EpochManager, Retire_NonTrivialArray_DestructorsCalled)
+{
+  int counter = 0;
+
+  {
+    epoch_manager epochs;
+
+    auto array = static_cast<DestructorCounter*>(std::malloc(3 * sizeof(DestructorCounter)));
+
+    for (int i = 0; i < 3; i++) new (array + i) DestructorCounter { &counter };
+
+    auto guard = epochs.pin(0);
+
+    epochs.retire(array, 3);
+
+    ASSERT_EQ(counter, 0);
+  }
+
+  ASSERT_EQ(counter, 3);
+}
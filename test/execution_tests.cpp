@@ -0,0 +1,184 @@
+#include <execution.hpp>
+#include <gtest/gtest.h>
+#include <registry.hpp>
+
+#include <stdexcept>
+
+using namespace xecs;
+
+TEST(Execution, SyncWait_Just_SameValues)
+{
+  auto result = execution::sync_wait(execution::just(5, 2.5f));
+
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(std::get<0>(*result), 5);
+  ASSERT_EQ(std::get<1>(*result), 2.5f);
+}
+
+TEST(Execution, Then_Just_TransformedValue)
+{
+  auto sender = execution::just(20) | execution::then([](int value)
+                                        { return value * 2; });
+
+  auto result = execution::sync_wait(sender);
+
+  ASSERT_EQ(std::get<0>(*result), 40);
+}
+
+TEST(Execution, Then_Throws_ErrorRethrown)
+{
+  auto sender = execution::then(execution::just(), []()
+    { throw std::runtime_error("error"); });
+
+  ASSERT_THROW(execution::sync_wait(sender), std::runtime_error);
+}
+
+TEST(Execution, WhenAll_Justs_ConcatenatedValues)
+{
+  auto result = execution::sync_wait(execution::when_all(execution::just(1), execution::just(), execution::just(2, 3)));
+
+  ASSERT_EQ(std::get<0>(*result), 1);
+  ASSERT_EQ(std::get<1>(*result), 2);
+  ASSERT_EQ(std::get<2>(*result), 3);
+}
+
+TEST(Execution, Schedule_Pool_CompletesOnWorker)
+{
+  scheduler scheduler(2);
+
+  auto sender = execution::schedule(scheduler) | execution::then([]()
+                                                   { return std::this_thread::get_id(); });
+
+  auto result = execution::sync_wait(sender);
+
+  ASSERT_NE(std::get<0>(*result), std::this_thread::get_id());
+}
+
+TEST(Execution, ForEach_Pool_EveryEntityOnce)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(4);
+
+  for (int i = 0; i < 5000; i++)
+  {
+    if (i % 2) registry.create(0);
+    else
+      registry.create(0, 0.0f);
+  }
+
+  auto sender = execution::for_each(
+    scheduler, registry.view<int>(), [](auto, auto& value)
+    { value++; },
+    100);
+
+  execution::sync_wait(sender);
+  execution::sync_wait(sender);
+
+  registry.for_each<int>([](auto, auto& value)
+    { ASSERT_EQ(value, 2); });
+}
+
+TEST(Execution, ForEach_Empty_Completes)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  execution::inline_scheduler scheduler;
+
+  auto result = execution::sync_wait(execution::for_each(scheduler, registry.view<int>(), [](auto, auto&) {}));
+
+  ASSERT_TRUE(result.has_value());
+}
+
+TEST(Execution, TransformReduce_Inline_Sum)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  execution::inline_scheduler scheduler;
+
+  for (int i = 1; i <= 100; i++) registry.create(i);
+
+  auto sender = execution::transform_reduce(
+    scheduler, registry.view<int>(), 0, [](int a, int b)
+    { return a + b; },
+    [](auto, auto& value)
+    { return value; },
+    7);
+
+  auto result = execution::sync_wait(sender);
+
+  ASSERT_EQ(std::get<0>(*result), 5050);
+}
+
+TEST(Execution, WhenAll_ForEachAndReduce_BothComplete)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(3);
+
+  for (int i = 0; i < 1000; i++)
+  {
+    registry.create(1);
+    registry.create(1.0f);
+  }
+
+  auto increment = execution::for_each(
+    scheduler, registry.view<float>(), [](auto, auto& value)
+    { value += 1.0f; },
+    64);
+
+  auto count = execution::transform_reduce(
+    scheduler, registry.view<int>(), 0, [](int a, int b)
+    { return a + b; },
+    [](auto, auto& value)
+    { return value; },
+    64);
+
+  auto result = execution::sync_wait(execution::when_all(increment, count) | execution::then([](int sum)
+                                                                               { return sum * 2; }));
+
+  ASSERT_EQ(std::get<0>(*result), 2000);
+
+  registry.for_each<float>([](auto, auto& value)
+    { ASSERT_EQ(value, 2.0f); });
+}
+
+TEST(Execution, ForEach_Throws_ErrorRethrown)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(2);
+
+  for (int i = 0; i < 100; i++) registry.create(i);
+
+  auto sender = execution::for_each(
+    scheduler, registry.view<int>(), [](auto, auto& value)
+    { if (value == 50) throw std::runtime_error("error"); },
+    10);
+
+  ASSERT_THROW(execution::sync_wait(sender), std::runtime_error);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <numa.hpp>
+#include <registry.hpp>
+#include <scheduler.hpp>
+
+#include <vector>
+
+using namespace xecs;
+
+TEST(Numa, ParseList_RangesAndSingles_EveryIndex)
+{
+  const std::vector<size_t> expected { 0, 1, 2, 3, 8, 10, 11 };
+
+  ASSERT_EQ(internal::parse_list("0-3,8,10-11"), expected);
+}
+
+TEST(Numa, ParseList_Empty_NoIndices)
+{
+  ASSERT_TRUE(internal::parse_list("").empty());
+}
+
+TEST(Numa, Topology_System_EveryCpuHasNode)
+{
+  const auto& topology = numa_topology::system();
+
+  ASSERT_GE(topology.nodes(), 1);
+  ASSERT_FALSE(topology.cpus().empty());
+
+  for (auto cpu : topology.cpus())
+  {
+    ASSERT_LT(topology.node(cpu), topology.nodes());
+  }
+}
+
+TEST(Numa, Bind_SingleNode_True)
+{
+  if (numa_topology::system().nodes() > 1) GTEST_SKIP();
+
+  std::vector<char> memory(1 << 16);
+
+  ASSERT_TRUE(numa_bind(memory.data(), memory.size(), 0));
+}
+
+TEST(Numa, Scheduler_Workers_NodeInRange)
+{
+  scheduler scheduler(4);
+
+  for (size_t worker = 0; worker < scheduler.workers(); worker++)
+  {
+    ASSERT_LT(scheduler.node(worker), numa_topology::system().nodes());
+  }
+}
+
+TEST(Numa, Place_ThenParallelForEach_EveryEntityOnce)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(4);
+
+  for (int i = 0; i < 20000; i++)
+  {
+    if (i % 2) registry.create(0);
+    else
+      registry.create(0, 0.0f);
+  }
+
+  auto view = registry.view<int>();
+
+  auto increment = [](auto, auto& value)
+  { value++; };
+
+  view.place(scheduler, increment);
+  view.parallel_for_each(scheduler, increment);
+
+  registry.for_each<int>([](auto, auto& value)
+    { ASSERT_EQ(value, 1); });
+}
@@ -1,8 +1,55 @@
 #include <gtest/gtest.h>
 #include <registry.hpp>
 
+#include <array>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 using namespace xecs;
 
+struct ZonePosition
+{
+  float x, y;
+};
+
+template<>
+struct xecs::zone_key<ZonePosition>
+{
+  using type = std::array<float, 2>;
+  static type key(const ZonePosition& position) { return { position.x, position.y }; }
+};
+
+struct PlayerId
+{
+  uint64_t id;
+};
+
+template<>
+struct xecs::index_key<PlayerId>
+{
+  using type = uint64_t;
+  static type key(const PlayerId& player) { return player.id; }
+};
+
+struct Speed
+{
+  float value;
+};
+
+struct Distance
+{
+  float value;
+};
+
+template<>
+struct xecs::computed<Distance>
+{
+  using inputs = list<Speed, float>;
+
+  static void compute(Distance& distance, const Speed& speed, const float& time) { distance.value = speed.value * time; }
+};
+
 TEST(Registry, Storages_OneArchetype_OneStorages)
 {
   using entity_type = unsigned int;
@@ -615,3 +662,1057 @@ TEST(Registry, ForEach_MultipleTwoArchetypes_CorrectIterations)
 
   ASSERT_EQ(amount / 2, floatview);
 }
+
+TEST(Registry, TryUnpack_WithComponent_SameValue)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity = registry.create(1, 2.0f);
+
+  ASSERT_NE(registry.try_unpack<float>(entity), nullptr);
+  ASSERT_EQ(*registry.try_unpack<float>(entity), 2.0f);
+}
+
+TEST(Registry, TryUnpack_WithoutComponent_Null)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity = registry.create(1);
+
+  ASSERT_EQ(registry.try_unpack<float>(entity), nullptr);
+
+  registry.destroy(entity);
+
+  ASSERT_EQ(registry.try_unpack<int>(entity), nullptr);
+}
+
+TEST(Registry, Create_ConcurrentDifferentArchetypes_AllCreated)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<float>>::
+        add<archetype<int, float>>::
+          build;
+
+  registry<entity_type, registered_archetypes, concurrent_policy> registry;
+
+  const int amount = 10000;
+
+  std::thread first([&]()
+    {
+      for (int i = 0; i < amount; i++) registry.create(i);
+    });
+
+  std::thread second([&]()
+    {
+      for (int i = 0; i < amount; i++) registry.create(static_cast<float>(i));
+    });
+
+  std::thread third([&]()
+    {
+      for (int i = 0; i < amount; i++)
+      {
+        auto entity = registry.create(i, 0.0f);
+        if (i % 2) registry.destroy<int, float>(entity);
+      }
+    });
+
+  first.join();
+  second.join();
+  third.join();
+
+  ASSERT_EQ(registry.size<int>(), amount + amount / 2);
+  ASSERT_EQ(registry.size<float>(), amount + amount / 2);
+
+  registry.for_each<int, float>([&](auto entity, auto& value, auto&)
+    {
+      ASSERT_EQ(value % 2, 0);
+      ASSERT_EQ(registry.unpack<int>(entity), value);
+    });
+
+  int sum = 0;
+
+  registry.view<int>().for_each([&](auto, auto& value)
+    { sum += value; });
+
+  ASSERT_EQ(sum, amount * (amount - 1) / 2 + (amount / 2) * (amount / 2 - 1));
+}
+
+TEST(Registry, SwapArchetype_ConcurrentOppositeDirections_NoDeadlock)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes, concurrent_policy> registry;
+
+  std::vector<entity_type> first, second;
+
+  for (int i = 0; i < 1000; i++)
+  {
+    first.push_back(registry.create(i));
+    second.push_back(registry.create(i, 0.0f));
+  }
+
+  std::thread forward([&]()
+    {
+      for (auto entity : first) registry.swap_archetype<int, float>(entity);
+    });
+
+  std::thread backward([&]()
+    {
+      for (auto entity : second) registry.swap_archetype<int>(entity);
+    });
+
+  forward.join();
+  backward.join();
+
+  ASSERT_EQ(registry.size<int>(), 2000);
+
+  for (auto entity : first) ASSERT_TRUE(registry.has<float>(entity));
+  for (auto entity : second) ASSERT_FALSE(registry.has<float>(entity));
+}
+
+TEST(Registry, Append_ConcurrentCreate_AllCreated)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto existing = registry.create(0, 0.0f);
+  registry.destroy(registry.create(0, 0.0f));
+
+  {
+    auto appender = registry.append<float, int>(1000);
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; t++)
+    {
+      threads.emplace_back([&]()
+        {
+          for (int i = 0; i < 200; i++) appender.create(1, 1.0f);
+        });
+    }
+
+    for (auto& thread : threads) thread.join();
+
+    ASSERT_EQ(appender.remaining(), 200);
+  }
+
+  ASSERT_EQ((registry.size<int, float>()), 801);
+  ASSERT_TRUE(registry.has<float>(existing));
+
+  // Unused identifiers are released and reused
+  auto entity = registry.create(2);
+
+  ASSERT_LT(entity, 1002);
+  ASSERT_FALSE(registry.has<float>(entity));
+}
+
+TEST(Registry, Read_Bound_EveryEntity)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  epoch_manager epochs;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  registry.bind(epochs);
+
+  for (int i = 0; i < 100; i++)
+  {
+    registry.create(1);
+    registry.create(2, 0.0f);
+  }
+
+  int sum = 0;
+
+  auto guard = epochs.pin(0);
+
+  registry.view<int>().read(guard, [&](auto, const int& value)
+    { sum += value; });
+
+  ASSERT_EQ(sum, 300);
+}
+
+TEST(Registry, SnapshotView_ModifiedAfter_OriginalValues)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 100; i++)
+  {
+    registry.create(1);
+    registry.create(1, 0.0f);
+  }
+
+  auto snapshot = registry.snapshot_view<const int>();
+
+  registry.for_each<int>([](auto, auto& value)
+    { value = 2; });
+
+  registry.destroy_all();
+
+  ASSERT_EQ(snapshot.size(), 200);
+
+  int sum = 0;
+
+  snapshot.for_each([&](auto, const int& value)
+    { sum += value; });
+
+  ASSERT_EQ(sum, 200);
+  ASSERT_TRUE(registry.empty());
+}
+
+TEST(Registry, ForEach_ConstComponent_SameValues)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int, float>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  auto entity = registry.create(5, 1.0f);
+
+  registry.for_each<const int, float>([](auto, const int& value, auto& other)
+    { other = static_cast<float>(value); });
+
+  ASSERT_EQ(registry.unpack<const int>(entity), 5);
+  ASSERT_EQ(registry.unpack<float>(entity), 5.0f);
+}
+
+TEST(Registry, ForEach_OutComponent_Overwritten)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int, float>>::
+      add<archetype<int>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 50; i++) registry.create(i, 0.0f);
+  for (int i = 0; i < 50; i++) registry.create(-1);
+
+  registry.for_each<out<int>>([](auto entity, out<int> value)
+    { value = static_cast<int>(entity) * 2; });
+
+  registry.for_each<int>([](auto entity, auto& value)
+    { ASSERT_EQ(value, static_cast<int>(entity) * 2); });
+}
+
+TEST(Registry, ForEach_OutLargeColumn_Streamed)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int, float>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const size_t amount = out<float>::stream_threshold / sizeof(float) + 10;
+
+  for (size_t i = 0; i < amount; i++) registry.create(static_cast<int>(i), 0.0f);
+
+  registry.for_each<const int, out<float>>([](auto, const int& source, out<float> destination)
+    { destination = static_cast<float>(source) + 0.5f; });
+
+  registry.for_each<int, float>([](auto, auto& source, auto& destination)
+    { ASSERT_EQ(destination, static_cast<float>(source) + 0.5f); });
+}
+
+TEST(Registry, Fill_TwoArchetypes_EveryComponent)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int, float>>::
+      add<archetype<float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 20; i++) registry.create(i, 1.0f);
+  for (int i = 0; i < 20; i++) registry.create(1.0f);
+
+  registry.fill(2.5f);
+
+  ASSERT_EQ(registry.size<float>(), 40);
+
+  registry.for_each<float>([](auto, auto& value)
+    { ASSERT_EQ(value, 2.5f); });
+}
+
+TEST(Registry, SingleAllocation_CreateDestroy_SameValues)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int, float>>::
+      add<archetype<int>>::
+        build;
+
+  registry<entity_type, registered_archetypes, single_allocation_policy> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 1000; i++) entities.push_back(registry.create(i, static_cast<float>(i)));
+  for (int i = 0; i < 1000; i += 3) registry.destroy(entities[i]);
+
+  registry.swap_archetype<int>(entities[1]);
+
+  registry.optimize();
+
+  ASSERT_EQ(registry.unpack<int>(entities[1]), 1);
+  ASSERT_EQ(registry.unpack<float>(entities[2]), 2.0f);
+  ASSERT_EQ(registry.size<int>(), 666);
+}
+
+TEST(Registry, Defragment_Scattered_DenseIdentifiers)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 10000; i++)
+  {
+    if (i % 2) entities.push_back(registry.create(i));
+    else
+      entities.push_back(registry.create(i, static_cast<float>(i)));
+  }
+
+  for (int i = 0; i < 10000; i++)
+  {
+    if (i % 100) registry.destroy(entities[i]);
+  }
+
+  const auto table = registry.defragment();
+
+  ASSERT_EQ(table.size(), 10000);
+
+  for (int i = 0; i < 10000; i++)
+  {
+    if (i % 100)
+    {
+      ASSERT_EQ(table[entities[i]], registry.tombstone);
+      continue;
+    }
+
+    const entity_type entity = table[entities[i]];
+
+    ASSERT_LT(entity, 100);
+    ASSERT_EQ(registry.unpack<int>(entity), i);
+  }
+
+  ASSERT_EQ(registry.size<int>(), 100);
+  ASSERT_EQ(registry.create(0), 100);
+}
+
+TEST(Registry, Defragment_Concurrent_DenseIdentifiers)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+
+  registry<entity_type, registered_archetypes, concurrent_policy> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 20000; i++) entities.push_back(registry.create(i));
+  for (int i = 0; i < 19000; i++) registry.destroy(entities[i]);
+
+  const auto table = registry.defragment();
+
+  for (int i = 19000; i < 20000; i++) ASSERT_EQ(registry.unpack<int>(table[entities[i]]), i);
+
+  for (int i = 0; i < 1000; i++) registry.create(i);
+
+  ASSERT_EQ(registry.size<int>(), 2000);
+}
+
+TEST(Registry, Maintain_ZeroBudget_OneSlice)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 10; i++) registry.create(i);
+
+  ASSERT_EQ(registry.maintain(std::chrono::nanoseconds(0)), 1);
+}
+
+TEST(Registry, Maintain_LargeBudget_OnePassSortedAndShrunk)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 20000; i++) entities.push_back(registry.create(i));
+  for (int i = 0; i < 20000; i += 2) registry.destroy(entities[i]);
+  for (int i = 0; i < 100; i++) registry.create(i, 0.0f);
+
+  // Sorting slices of the first storage, shrinking both storages and the entity_manager
+  const size_t slices = (10000 + registry.maintenance_slice - 1) / registry.maintenance_slice + 1 + 1 + 1 + 1;
+
+  ASSERT_EQ(registry.maintain(std::chrono::seconds(10)), slices);
+
+  auto& storage = registry.access<archetype<int>>();
+
+  ASSERT_EQ(storage.capacity(), storage.size());
+
+  for (size_t index = 1; index < registry.maintenance_slice; index++)
+  {
+    ASSERT_LT(*storage.at(index - 1), *storage.at(index));
+  }
+
+  for (int i = 1; i < 20000; i += 2) ASSERT_EQ(registry.unpack<int>(entities[i]), i);
+}
+
+TEST(Registry, Profile_WarmStart_NoGrowth)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  capacity_profile profile;
+
+  {
+    registry<entity_type, registered_archetypes> registry;
+
+    for (int i = 0; i < 5000; i++) registry.create(i);
+    for (int i = 0; i < 300; i++) registry.create(i, 0.0f);
+
+    profile = registry.profile();
+  }
+
+  using registry_type = registry<entity_type, registered_archetypes>;
+
+  const size_t index = find_v<archetype<int>, registry_type::archetype_list_type>;
+
+  ASSERT_EQ(profile.storages.size(), 2);
+  ASSERT_GE(profile.storages[index], 5000);
+  ASSERT_GE(profile.storages[1 - index], 300);
+  ASSERT_GE(profile.sparse, 5300);
+
+  std::stringstream text;
+  text << profile;
+
+  capacity_profile loaded;
+  text >> loaded;
+
+  ASSERT_EQ(loaded.storages, profile.storages);
+  ASSERT_EQ(loaded.sparse, profile.sparse);
+  ASSERT_EQ(loaded.manager, profile.manager);
+
+  registry_type registry(loaded);
+
+  auto& storage = registry.access<archetype<int>>();
+
+  ASSERT_EQ(storage.capacity(), profile.storages[index]);
+
+  for (int i = 0; i < 5000; i++) registry.create(i);
+
+  ASSERT_EQ(storage.capacity(), profile.storages[index]);
+  ASSERT_EQ(storage.high_water(), profile.storages[index]);
+}
+
+TEST(Registry, BoundedPolicy_PackedIndex_SameValues)
+{
+  using entity_type = uint64_t;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  using policy_type = bounded_policy<1 << 20>;
+
+  static_assert(std::is_same_v<policy_type::sparse_type<entity_type>, packed_sparse_array<entity_type, 3>>);
+  static_assert(std::is_same_v<bounded_policy<1000>::sparse_type<entity_type>, sparse_array<entity_type, uint16_t>>);
+  static_assert(std::is_same_v<bounded_policy<size_t { 1 } << 32>::sparse_type<entity_type>, sparse_array<entity_type, uint32_t>>);
+
+  registry<entity_type, registered_archetypes, policy_type> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100000; i++)
+  {
+    if (i % 2) entities.push_back(registry.create(i));
+    else
+      entities.push_back(registry.create(i, 0.0f));
+  }
+
+  for (int i = 0; i < 100000; i += 3) registry.destroy(entities[i]);
+
+  for (int i = 0; i < 100000; i++)
+  {
+    if (i % 3)
+    {
+      ASSERT_EQ(registry.unpack<int>(entities[i]), i);
+    }
+  }
+}
+
+TEST(Registry, Fork_ModifyBoth_Independent)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  using registry_type = registry<entity_type, registered_archetypes>;
+
+  registry_type registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100000; i++) entities.push_back(registry.create(i, 1.0f));
+  for (int i = 0; i < 10; i++) registry.destroy(entities[i]);
+
+  auto fork = registry.fork();
+
+  ASSERT_EQ(fork->size<int>(), registry.size<int>());
+
+  fork->view<int, const float>().for_each([](auto, int& value, const float&)
+    { value = -value; });
+
+  const entity_type created = fork->create(5000, 2.0f);
+
+  ASSERT_EQ(registry.create(6000, 3.0f), created);
+
+  fork->destroy(entities[500]);
+  registry.unpack<float>(entities[600]) = 4.0f;
+
+  for (int i = 10; i < 100000; i++)
+  {
+    ASSERT_EQ(registry.unpack<int>(entities[i]), i);
+
+    if (i != 500)
+    {
+      ASSERT_EQ(fork->unpack<int>(entities[i]), -i);
+    }
+  }
+
+  ASSERT_TRUE(registry.view<int>().contains(entities[500]));
+  ASSERT_FALSE(fork->view<int>().contains(entities[500]));
+  ASSERT_EQ(fork->unpack<float>(entities[600]), 1.0f);
+  ASSERT_EQ(fork->unpack<int>(created), 5000);
+  ASSERT_EQ(registry.unpack<int>(created), 6000);
+}
+
+TEST(Registry, ForkTwice_SharedPages_ForksIndependent)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int, float>>::
+      build;
+
+  registry<entity_type, registered_archetypes, shared_pages_policy> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100000; i++) entities.push_back(registry.create(i, 1.0f));
+
+  auto first = registry.fork();
+
+  registry.unpack<int>(entities[5]) = -5;
+  first->unpack<float>(entities[6]) = 6.0f;
+
+  auto second = registry.fork();
+
+  registry.unpack<int>(entities[7]) = -7;
+  second->destroy(entities[8]);
+
+  ASSERT_EQ(registry.unpack<int>(entities[5]), -5);
+  ASSERT_EQ(first->unpack<int>(entities[5]), 5);
+  ASSERT_EQ(second->unpack<int>(entities[5]), -5);
+
+  ASSERT_EQ(registry.unpack<float>(entities[6]), 1.0f);
+  ASSERT_EQ(second->unpack<float>(entities[6]), 1.0f);
+
+  ASSERT_EQ(first->unpack<int>(entities[7]), 7);
+  ASSERT_EQ(second->unpack<int>(entities[7]), 7);
+
+  ASSERT_TRUE(registry.view<int>().contains(entities[8]));
+  ASSERT_FALSE(second->view<int>().contains(entities[8]));
+
+  for (int i = 10; i < 100000; i++) ASSERT_EQ(second->unpack<int>(entities[i]), i);
+}
+
+TEST(Registry, Instantiate_Prefab_ContiguousBlock)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const entity_type single = registry.create(1);
+
+  registry.destroy(single);
+
+  prefab squad { 3, 2.0f };
+
+  const entity_type first = registry.instantiate(squad, 100);
+
+  ASSERT_EQ(first, 1);
+  ASSERT_EQ(registry.size<float>(), 100);
+
+  for (entity_type entity = first; entity < first + 100; entity++)
+  {
+    ASSERT_EQ(registry.unpack<int>(entity), 3);
+    ASSERT_EQ(registry.unpack<float>(entity), 2.0f);
+  }
+
+  ASSERT_EQ(registry.create(4), single);
+}
+
+TEST(Registry, Clone_Entity_SameComponents)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  registry.create(1);
+  const entity_type entity = registry.create(2, 3.0f);
+
+  const entity_type first = registry.clone(entity, 50);
+
+  ASSERT_EQ(registry.size<int>(), 52);
+  ASSERT_EQ(registry.size<float>(), 51);
+
+  for (entity_type clone = first; clone < first + 50; clone++)
+  {
+    ASSERT_EQ(registry.unpack<int>(clone), 2);
+    ASSERT_EQ(registry.unpack<float>(clone), 3.0f);
+  }
+}
+
+TEST(Registry, ForEachWhere_Box_OnlyEntitiesInside)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<ZonePosition>>::
+      add<archetype<ZonePosition, int>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 2000; i++)
+  {
+    registry.create(ZonePosition { static_cast<float>(i), static_cast<float>(i % 10) });
+    registry.create(ZonePosition { static_cast<float>(-i), 0.0f }, i);
+  }
+
+  const range<std::array<float, 2>> box { { 100.0f, 0.0f }, { 199.0f, 4.0f } };
+
+  size_t count = 0;
+
+  registry.view<ZonePosition>().for_each_where<ZonePosition>(box, [&](auto, ZonePosition& position)
+    {
+      ASSERT_TRUE(position.x >= 100.0f && position.x <= 199.0f && position.y <= 4.0f);
+      position.x += 1000.0f;
+      count++;
+    });
+
+  ASSERT_EQ(count, 50);
+
+  count = 0;
+
+  registry.view<const ZonePosition>().for_each_where<ZonePosition>(box, [&](auto, const ZonePosition&)
+    { count++; });
+
+  ASSERT_EQ(count, 0);
+}
+
+TEST(Registry, Find_AfterSwapAndWrites_CurrentEntity)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<PlayerId>>::
+      add<archetype<PlayerId, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (uint64_t i = 0; i < 100; i++) entities.push_back(registry.create(PlayerId { i + 1000 }));
+
+  ASSERT_EQ(registry.find<PlayerId>(1042), entities[42]);
+  ASSERT_EQ(registry.find<PlayerId>(42), registry.tombstone);
+
+  registry.swap_archetype<PlayerId, float>(entities[42]);
+
+  ASSERT_EQ(registry.find<PlayerId>(1042), entities[42]);
+
+  registry.for_each<PlayerId>([](auto, PlayerId& player)
+    { player.id += 1000; });
+
+  ASSERT_EQ(registry.find<PlayerId>(1042), registry.tombstone);
+  ASSERT_EQ(registry.find<PlayerId>(2042), entities[42]);
+  ASSERT_EQ(registry.find<PlayerId>(2000), entities[0]);
+
+  registry.destroy(entities[0]);
+
+  ASSERT_EQ(registry.find<PlayerId>(2000), registry.tombstone);
+}
+
+TEST(Registry, Compute_AfterInputWrites_ViewsSeeComputed)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Speed, float, Distance>>::
+      add<archetype<Speed, float, Distance, int>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const entity_type e1 = registry.create(Speed { 2.0f }, 3.0f, Distance {});
+  const entity_type e2 = registry.create(Speed { 4.0f }, 1.0f, Distance {}, 0);
+
+  registry.compute<Distance>();
+
+  ASSERT_EQ(registry.unpack<const Distance>(e1).value, 6.0f);
+  ASSERT_EQ(registry.unpack<const Distance>(e2).value, 4.0f);
+
+  registry.for_each<float>([](auto, float& time)
+    { time *= 2.0f; });
+
+  float total = 0;
+
+  registry.for_each<const Distance>([&total](auto, const Distance& distance)
+    { total += distance.value; });
+
+  ASSERT_EQ(total, 20.0f);
+
+  registry.unpack<Speed>(e1).value = 0.0f;
+
+  ASSERT_EQ(registry.unpack<const Distance>(e1).value, 0.0f);
+}
+
+TEST(Registry, Compute_ViewWritesInputAndReadsComputed_ComputedAgain)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<Speed, float, Distance>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const entity_type entity = registry.create(Speed { 2.0f }, 3.0f, Distance {});
+
+  float seen = 0;
+
+  registry.for_each<float, const Distance>([&seen](auto, float& time, const Distance& distance)
+    {
+      seen = distance.value;
+      time = 10.0f;
+    });
+
+  ASSERT_EQ(seen, 6.0f);
+  ASSERT_EQ(registry.unpack<const Distance>(entity).value, 20.0f);
+
+  registry.for_each<float, const Distance>([&seen](auto, float& time, const Distance& distance)
+    {
+      seen = distance.value;
+      time = 1.0f;
+    });
+
+  ASSERT_EQ(seen, 20.0f);
+  ASSERT_EQ(registry.unpack<const Distance>(entity).value, 2.0f);
+}
+
+TEST(Registry, Buffer_SwapArchetypeAndFork_ElementsKept)
+{
+  using entity_type = unsigned int;
+  using inventory = buffer<int, 2>;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<inventory>>::
+      add<archetype<inventory, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  const entity_type entity = registry.create(inventory {});
+
+  for (int i = 0; i < 10; i++) registry.unpack<inventory>(entity).push_back(i);
+
+  registry.swap_archetype<inventory, float>(entity);
+
+  const inventory& items = registry.unpack<const inventory>(entity);
+
+  ASSERT_EQ(items.size(), 10);
+
+  for (int i = 0; i < 10; i++) ASSERT_EQ(items[i], i);
+
+  auto fork = registry.fork();
+
+  fork->unpack<inventory>(entity)[0] = 42;
+  fork->unpack<inventory>(entity).push_back(10);
+
+  ASSERT_EQ(registry.unpack<inventory>(entity)[0], 0);
+  ASSERT_EQ(registry.unpack<inventory>(entity).size(), 10);
+  ASSERT_EQ(fork->unpack<inventory>(entity)[0], 42);
+  ASSERT_EQ(fork->unpack<inventory>(entity).size(), 11);
+}
+
+TEST(Registry, EntitySet_AfterWrites_OnlyChangedChunksEvaluated)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int, float>>::
+      add<archetype<int, float, double>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 1000; i++) entities.push_back(registry.create(i, float(i % 10)));
+  for (int i = 0; i < 10; i++) entities.push_back(registry.create(i, 0.0f, 0.0));
+
+  int calls = 0;
+
+  auto in_range = registry.entity_set<const int, const float>([&calls](auto, const int& health, const float& distance)
+    {
+      calls++;
+      return health > 0 && distance < 1.0f;
+    });
+
+  // Every entity with a distance of zero, except the two entities without health
+  ASSERT_EQ(in_range.size(), 108);
+  ASSERT_EQ(calls, 1010);
+
+  ASSERT_FALSE(in_range.contains(entities[0]));
+  ASSERT_TRUE(in_range.contains(entities[10]));
+  ASSERT_TRUE(in_range.contains(entities[1005]));
+
+  registry.unpack<float>(entities[10]) = 5.0f;
+  registry.unpack<float>(entities[11]) = 0.5f;
+
+  ASSERT_EQ(in_range.size(), 108);
+  ASSERT_FALSE(in_range.contains(entities[10]));
+  ASSERT_TRUE(in_range.contains(entities[11]));
+  ASSERT_EQ(calls, 1010 + 256);
+
+  registry.destroy(entities[20]);
+  registry.create(5, 0.0f, 0.0);
+
+  int health = 0;
+
+  in_range.for_each([&health](auto, const int& value, const float&)
+    { health += value; });
+
+  ASSERT_EQ(in_range.size(), 108);
+  ASSERT_EQ(health, 49500 + 45 - 10 + 11 - 20 + 5);
+}
+
+TEST(Registry, EntitySet_DestroyAll_NoMembers)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 10; i++) registry.create(i);
+
+  auto all = registry.entity_set<const int>([](auto, const int&)
+    { return true; });
+
+  ASSERT_EQ(all.size(), 10);
+
+  registry.destroy_all();
+
+  int calls = 0;
+
+  all.for_each([&calls](auto, const int&)
+    { calls++; });
+
+  ASSERT_EQ(all.size(), 0);
+  ASSERT_TRUE(all.empty());
+  ASSERT_EQ(calls, 0);
+
+  const entity_type entity = registry.create(1);
+
+  ASSERT_EQ(all.size(), 1);
+  ASSERT_TRUE(all.contains(entity));
+}
+
+struct OnFire
+{
+  int intensity;
+};
+
+struct SparsePolicy : default_policy
+{
+  using sparse_components = list<OnFire>;
+};
+
+TEST(Registry, SparseComponent_ToggleAndSwap_OtherComponentsNotMoved)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes, SparsePolicy> registry;
+
+  std::vector<entity_type> entities;
+
+  for (int i = 0; i < 100; i++) entities.push_back(registry.create(i));
+
+  const int* address = &registry.unpack<int>(entities[50]);
+
+  for (int i = 0; i < 10; i++)
+  {
+    registry.attach(entities[50], OnFire { i });
+    registry.detach<OnFire>(entities[50]);
+  }
+
+  ASSERT_EQ(&registry.unpack<int>(entities[50]), address);
+  ASSERT_FALSE(registry.attached<OnFire>(entities[50]));
+
+  registry.attach(entities[10], OnFire { 1 });
+  registry.attach(entities[20], OnFire { 2 });
+  registry.attach(entities[30], OnFire { 3 });
+  registry.attach(entities[30], OnFire { 4 });
+
+  registry.swap_archetype<int, float>(entities[20]);
+
+  ASSERT_EQ(registry.unpack<OnFire>(entities[20]).intensity, 2);
+  ASSERT_EQ(registry.sparse<OnFire>().size(), 3);
+
+  int sum = 0;
+
+  registry.for_each_with<OnFire, int>([&sum](auto, int& value, OnFire& fire)
+    { sum += value * fire.intensity; });
+
+  ASSERT_EQ(sum, 10 * 1 + 20 * 2 + 30 * 4);
+
+  sum = 0;
+
+  registry.for_each_with<const OnFire, int, float>([&sum](auto, int& value, float&, const OnFire& fire)
+    { sum += value * fire.intensity; });
+
+  ASSERT_EQ(sum, 20 * 2);
+
+  registry.destroy(entities[10]);
+
+  ASSERT_EQ(registry.sparse<OnFire>().size(), 2);
+
+  const entity_type reused = registry.create(0);
+
+  ASSERT_FALSE(registry.attached<OnFire>(reused));
+
+  const auto table = registry.defragment();
+
+  ASSERT_TRUE(registry.attached<OnFire>(table[entities[30]]));
+  ASSERT_EQ(registry.unpack<const OnFire>(table[entities[30]]).intensity, 4);
+
+  auto fork = registry.fork();
+
+  fork->detach<OnFire>(table[entities[30]]);
+
+  ASSERT_TRUE(registry.attached<OnFire>(table[entities[30]]));
+  ASSERT_FALSE(fork->attached<OnFire>(table[entities[30]]));
+}
+
+TEST(Registry, FixedPolicy_CreateDestroySwap_ArraysInline)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  using policy_type = fixed_policy<256, capacity_of<archetype<int, float>, 16>>;
+  using registry_type = registry<entity_type, registered_archetypes, policy_type>;
+
+  auto registry = std::make_unique<registry_type>();
+
+  const auto inside = [&registry](const void* address)
+  {
+    const auto* begin = reinterpret_cast<const unsigned char*>(registry.get());
+
+    return address >= begin && address < begin + sizeof(registry_type);
+  };
+
+  ASSERT_EQ(registry->access<archetype<int>>().capacity(), 256);
+  ASSERT_EQ((registry->access<archetype<int, float>>().capacity()), 16);
+
+  std::vector<entity_type> entities;
+
+  for (int frame = 0; frame < 10; frame++)
+  {
+    for (int i = 0; i < 200; i++) entities.push_back(registry->create(i));
+    for (int i = 0; i < 16; i++) registry->swap_archetype<int, float>(entities[i * 10]);
+
+    ASSERT_EQ(registry->size<int>(), 200);
+    ASSERT_EQ(registry->unpack<int>(entities[150]), 150);
+    ASSERT_TRUE(inside(&registry->unpack<int>(entities[150])));
+    ASSERT_TRUE(inside(&registry->unpack<float>(entities[10])));
+
+    for (const auto entity : entities) registry->destroy(entity);
+
+    entities.clear();
+  }
+
+  ASSERT_EQ(registry->access<archetype<int>>().capacity(), 256);
+  ASSERT_TRUE(registry->empty<int>());
+}
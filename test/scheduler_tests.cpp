@@ -0,0 +1,413 @@
+#include <gtest/gtest.h>
+#include <registry.hpp>
+#include <scheduler.hpp>
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace xecs;
+
+TEST(Scheduler, Workers_Specified_SameAmount)
+{
+  scheduler scheduler(3);
+
+  ASSERT_EQ(scheduler.workers(), 3);
+}
+
+TEST(Scheduler, Workers_Zero_AtleastOne)
+{
+  scheduler scheduler(0);
+
+  ASSERT_EQ(scheduler.workers(), 1);
+}
+
+TEST(Scheduler, ParallelFor_NoChunks_NoInvocations)
+{
+  scheduler scheduler(4);
+
+  std::atomic<size_t> invocations { 0 };
+
+  scheduler.parallel_for(0, [&](size_t, size_t)
+    { invocations++; });
+
+  ASSERT_EQ(invocations, 0);
+}
+
+TEST(Scheduler, ParallelFor_ManyChunks_EveryChunkOnce)
+{
+  scheduler scheduler(4);
+
+  const size_t chunks = 1000;
+
+  std::vector<std::atomic<int>> visits(chunks);
+
+  for (size_t frame = 0; frame < 10; frame++)
+  {
+    scheduler.parallel_for(chunks, [&](size_t, size_t chunk)
+      { visits[chunk]++; });
+  }
+
+  for (auto& visit : visits)
+  {
+    ASSERT_EQ(visit, 10);
+  }
+}
+
+TEST(Scheduler, ParallelFor_SingleWorker_EveryChunkOnWorkerZero)
+{
+  scheduler scheduler(1);
+
+  std::vector<size_t> workers(100, 1);
+
+  scheduler.parallel_for(workers.size(), [&](size_t worker, size_t chunk)
+    { workers[chunk] = worker; });
+
+  for (auto worker : workers)
+  {
+    ASSERT_EQ(worker, 0);
+  }
+}
+
+TEST(LoopStates, State_SameSite_SameState)
+{
+  scheduler first(1);
+  scheduler second(1);
+
+  loop_states states;
+
+  ASSERT_EQ(&states.state<int>(first), &states.state<int>(first));
+  ASSERT_NE(&states.state<int>(first), &states.state<float>(first));
+  ASSERT_NE(&states.state<int>(first), &states.state<int>(second));
+}
+
+TEST(LoopStates, State_NewSchedulerAtSameAddress_NotTuned)
+{
+  loop_states states;
+
+  std::optional<scheduler> current;
+
+  current.emplace(1);
+  states.state<int>(*current).chunk_size(64);
+
+  current.reset();
+  current.emplace(1);
+
+  ASSERT_EQ(states.state<int>(*current).chunk_size(), loop_state::default_chunk_size);
+}
+
+TEST(LoopState, Assign_Even_AllChunksCovered)
+{
+  loop_state state;
+
+  state.assign(10, 3);
+
+  ASSERT_EQ(state.begin(0), 0);
+  ASSERT_EQ(state.end(2), 10);
+
+  for (size_t i = 0; i < 2; i++)
+  {
+    ASSERT_EQ(state.end(i), state.begin(i + 1));
+  }
+}
+
+TEST(LoopState, Assign_SmallChange_SameRanges)
+{
+  loop_state state;
+
+  state.assign(100, 4);
+
+  const auto first = state.end(0), second = state.end(1);
+
+  state.assign(104, 4);
+
+  ASSERT_EQ(state.end(0), first);
+  ASSERT_EQ(state.end(1), second);
+  ASSERT_EQ(state.end(3), 104);
+}
+
+TEST(LoopState, Assign_LargeChange_Rebalanced)
+{
+  loop_state state;
+
+  state.assign(100, 4);
+  state.assign(400, 4);
+
+  ASSERT_EQ(state.end(0), 100);
+  ASSERT_EQ(state.end(1), 200);
+  ASSERT_EQ(state.end(3), 400);
+}
+
+TEST(LoopState, Assign_Affine_IdentityOrder)
+{
+  loop_state state;
+
+  state.assign(50, 2);
+
+  for (size_t i = 0; i < 50; i++)
+  {
+    ASSERT_EQ(state.chunk(i), i);
+  }
+}
+
+TEST(LoopState, Assign_Random_Permutation)
+{
+  loop_state state;
+  state.policy(assignment::random);
+
+  state.assign(50, 2);
+
+  std::vector<bool> seen(50, false);
+
+  for (size_t i = 0; i < 50; i++)
+  {
+    ASSERT_FALSE(seen[state.chunk(i)]);
+    seen[state.chunk(i)] = true;
+  }
+}
+
+TEST(Scheduler, ParallelForEach_TwoArchetypes_EveryEntityOnce)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(4);
+
+  const size_t amount = 10000;
+
+  for (size_t i = 0; i < amount; i++)
+  {
+    if (i % 3) registry.create(0);
+    else
+      registry.create(0, 0.0f);
+  }
+
+  auto view = registry.view<int>();
+
+  for (size_t frame = 0; frame < 3; frame++)
+  {
+    view.parallel_for_each(scheduler, [](auto, auto& value)
+      { value++; });
+  }
+
+  registry.for_each<int>([](auto, auto& value)
+    { ASSERT_EQ(value, 3); });
+}
+
+TEST(Scheduler, ForEachChunk_AllChunks_EveryEntityOnce)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      add<archetype<int, float>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 25; i++) registry.create(0);
+  for (int i = 0; i < 13; i++) registry.create(0, 0.0f);
+
+  auto view = registry.view<int>();
+
+  ASSERT_EQ(view.chunks(10), 5);
+
+  for (size_t chunk = 0; chunk < view.chunks(10); chunk++)
+  {
+    view.for_each_chunk(chunk, 10, [](auto, auto& value)
+      { value++; });
+  }
+
+  registry.for_each<int>([](auto, auto& value)
+    { ASSERT_EQ(value, 1); });
+}
+
+TEST(Scheduler, TreeReduce_Five_FixedShape)
+{
+  std::vector<std::string> values { "a", "b", "c", "d", "e" };
+
+  auto result = tree_reduce(values, [](const std::string& a, const std::string& b)
+    { return "(" + a + b + ")"; });
+
+  ASSERT_EQ(result, "(((ab)(cd))e)");
+}
+
+TEST(Scheduler, ParallelReduce_FloatSum_SameOnAnyWorkers)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<float>>::
+      add<archetype<float, int>>::
+        build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  for (int i = 0; i < 50000; i++)
+  {
+    registry.create(1.0f / static_cast<float>(i + 1));
+    registry.create(static_cast<float>(i) * 1000.0f, i);
+  }
+
+  auto sum = [&](size_t workers)
+  {
+    scheduler scheduler(workers);
+
+    return registry.view<const float>().parallel_reduce(
+      scheduler, 0.0f, [](float a, float b)
+      { return a + b; },
+      [](auto, const float& value)
+      { return value; });
+  };
+
+  const float expected = sum(1);
+
+  ASSERT_EQ(sum(2), expected);
+  ASSERT_EQ(sum(3), expected);
+  ASSERT_EQ(sum(8), expected);
+}
+
+TEST(LoopState, Deterministic_Default_False)
+{
+  loop_state state;
+
+  ASSERT_FALSE(state.deterministic());
+
+  state.deterministic(true);
+
+  ASSERT_TRUE(state.deterministic());
+}
+
+TEST(LoopState, Tune_CheapKernel_LargerChunks)
+{
+  loop_state state;
+  state.tuning(true);
+  state.chunk_size(256);
+
+  state.assign(4000, 4);
+  state.measure(0, 500000);
+  state.measure(3, 500000);
+  state.tune(1000000);
+
+  ASSERT_EQ(state.chunk_size(), 32768);
+  ASSERT_EQ(state.statistics().chunk_size, 32768);
+  ASSERT_EQ(state.statistics().adjustments, 1);
+  ASSERT_EQ(state.statistics().nanoseconds, 1000000);
+  ASSERT_DOUBLE_EQ(state.statistics().cost, 1.0);
+}
+
+TEST(LoopState, Tune_ExpensiveKernel_SmallerChunksWithinBounds)
+{
+  loop_state state;
+  state.tuning(true);
+  state.bounds(16, 4096);
+
+  state.assign(100, 4);
+  state.measure(1, 1000000000);
+  state.tune(100000);
+
+  ASSERT_EQ(state.chunk_size(), 16);
+}
+
+TEST(LoopState, Tune_CloseToIdeal_Unchanged)
+{
+  loop_state state;
+  state.tuning(true);
+  state.chunk_size(1024);
+
+  state.assign(1000, 4);
+  state.measure(0, 1000000);
+  state.tune(1000000 / 40); // 40ns per entity, ideal is 1250
+
+  ASSERT_EQ(state.chunk_size(), 1024);
+  ASSERT_EQ(state.statistics().adjustments, 0);
+  ASSERT_EQ(state.statistics().executions, 1);
+}
+
+TEST(LoopState, Tune_Deterministic_Unchanged)
+{
+  loop_state state;
+  state.tuning(true);
+  state.deterministic(true);
+
+  state.assign(4000, 4);
+  state.measure(0, 1000000);
+  state.tune(1000000);
+
+  ASSERT_FALSE(state.tuning());
+  ASSERT_EQ(state.chunk_size(), loop_state::default_chunk_size);
+  ASSERT_EQ(state.statistics().executions, 0);
+}
+
+TEST(Scheduler, ParallelForEach_Tuning_StatisticsRecorded)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(4);
+
+  for (size_t i = 0; i < 10000; i++) registry.create(0);
+
+  loop_state state;
+  state.tuning(true);
+  state.bounds(1, 1 << 20);
+
+  auto view = registry.view<int>();
+
+  for (size_t frame = 0; frame < 3; frame++)
+  {
+    view.parallel_for_each(scheduler, state, [](auto, auto& value)
+      { value++; });
+  }
+
+  ASSERT_EQ(state.statistics().executions, 3);
+  ASSERT_EQ(state.statistics().entities, 10000);
+  ASSERT_EQ(state.statistics().chunk_size, state.chunk_size());
+
+  registry.for_each<int>([](auto, auto& value)
+    { ASSERT_EQ(value, 3); });
+}
+
+TEST(Scheduler, ParallelForEach_ChunksSmallerThanVersionChunks_EveryChangeSeen)
+{
+  using entity_type = unsigned int;
+  using registered_archetypes = archetype_list_builder::
+    add<archetype<int>>::
+      build;
+
+  registry<entity_type, registered_archetypes> registry;
+
+  scheduler scheduler(4);
+
+  for (size_t i = 0; i < 2200; i++) registry.create(0);
+
+  auto positive = registry.entity_set<const int>([](auto, const int& value)
+    { return value > 0; });
+
+  ASSERT_EQ(positive.size(), 0);
+
+  // Workers get 9 or 8 chunks of 64 entities, so neighbour workers share a version chunk
+  loop_state state;
+  state.chunk_size(64);
+
+  auto view = registry.view<int>();
+
+  for (int frame = 1; frame <= 10; frame++)
+  {
+    view.parallel_for_each(scheduler, state, [frame](auto, auto& value)
+      { value = frame; });
+
+    ASSERT_EQ(positive.size(), 2200);
+  }
+
+  registry.for_each<int>([](auto, auto& value)
+    { ASSERT_EQ(value, 10); });
+}
@@ -1,7 +1,12 @@
 
 #include <gtest/gtest.h>
 #include <storage.hpp>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace xecs;
 
@@ -34,6 +39,60 @@ struct NonTrivial
   }
 };
 
+struct ZoneHealth
+{
+  float value;
+};
+
+template<>
+struct xecs::zone_key<ZoneHealth>
+{
+  using type = float;
+  static type key(const ZoneHealth& health) { return health.value; }
+};
+
+struct IndexedId
+{
+  uint64_t id;
+};
+
+template<>
+struct xecs::index_key<IndexedId>
+{
+  using type = uint64_t;
+  static type key(const IndexedId& player) { return player.id; }
+};
+
+struct ComputedScale
+{
+  float value;
+};
+
+struct ComputedOffset
+{
+  float value;
+};
+
+struct ComputedResult
+{
+  float value;
+};
+
+static int computed_result_calls = 0;
+
+template<>
+struct xecs::computed<ComputedResult>
+{
+  using inputs = list<ComputedScale, ComputedOffset>;
+
+  static void compute(ComputedResult& result, const ComputedScale& scale, const ComputedOffset& offset)
+  {
+    result.value = scale.value * 2.0f + offset.value;
+
+    computed_result_calls++;
+  }
+};
+
 TEST(Storage, Empty_AfterInitialization_True)
 {
   using entity_type = unsigned int;
@@ -766,3 +825,1143 @@ TEST(StorageSharedSparseArray, Insert_TwoStoragesInsertSingle_UsingSharedMemory)
   ASSERT_TRUE(shared[100000] == storage2.size() - 2);
   ASSERT_TRUE(shared[453] == storage2.size() - 1);
 }
+
+TEST(StorageConcurrentSparseArray, Assure_Large_CapacityWholePages)
+{
+  using entity_type = unsigned int;
+  using sparse_type = concurrent_sparse_array<entity_type>;
+
+  sparse_type sparse;
+
+  sparse.assure(5000);
+
+  ASSERT_EQ(sparse.capacity(), 2 * sparse_type::page_size);
+}
+
+TEST(StorageConcurrentSparseArray, Insert_TwoStoragesInsertSingle_UsingSharedMemory)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>, concurrent_policy>;
+
+  concurrent_sparse_array<entity_type> shared;
+
+  storage_type storage1;
+  storage_type storage2;
+
+  storage1.share(&shared);
+  storage2.share(&shared);
+
+  storage1.insert(100, 1);
+  storage2.insert(100000, 2);
+  storage1.insert(99999, 3);
+
+  ASSERT_EQ(shared[100], 0);
+  ASSERT_EQ(shared[99999], 1);
+  ASSERT_EQ(shared[100000], 0);
+
+  storage1.erase(100);
+
+  ASSERT_FALSE(storage1.contains(100));
+  ASSERT_EQ(shared[99999], 0);
+  ASSERT_EQ(storage1.unpack<int>(99999), 3);
+  ASSERT_EQ(storage2.unpack<int>(100000), 2);
+}
+
+TEST(StorageAppender, Insert_ManyThreads_AllInserted)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  storage_type storage;
+
+  storage.insert(0, 0);
+
+  const entity_type amount = 4000;
+
+  {
+    auto appender = storage.append(amount, amount);
+
+    std::vector<std::thread> threads;
+
+    for (entity_type t = 0; t < 4; t++)
+    {
+      threads.emplace_back([&, t]()
+        {
+          for (entity_type entity = 1 + t; entity <= amount; entity += 4) appender.insert(entity, static_cast<int>(entity));
+        });
+    }
+
+    for (auto& thread : threads) thread.join();
+
+    ASSERT_EQ(appender.remaining(), 0);
+    ASSERT_EQ(storage.size(), 1);
+  }
+
+  ASSERT_EQ(storage.size(), amount + 1);
+
+  for (entity_type entity = 0; entity <= amount; entity++)
+  {
+    ASSERT_TRUE(storage.contains(entity));
+    ASSERT_EQ(storage.unpack<int>(entity), static_cast<int>(entity));
+  }
+}
+
+TEST(StorageAppender, Insert_Full_False)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  storage_type storage;
+
+  auto appender = storage.append(1, 1);
+
+  ASSERT_TRUE(appender.insert(0, 1));
+  ASSERT_FALSE(appender.insert(1, 2));
+
+  ASSERT_EQ(appender.commit(), 1);
+  ASSERT_TRUE(storage.contains(0));
+  ASSERT_FALSE(storage.contains(1));
+}
+
+TEST(StorageEpoch, Read_ConcurrentGrowth_SameValues)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<size_t>>;
+
+  epoch_manager epochs(1);
+
+  storage_type storage;
+
+  storage.bind(&epochs);
+
+  std::atomic<bool> done { false };
+
+  std::thread reader([&]()
+    {
+      while (!done.load())
+      {
+        auto guard = epochs.pin(0);
+
+        storage.read<size_t>(guard, [](auto entity, const size_t& value)
+          { ASSERT_EQ(entity, value); });
+      }
+    });
+
+  for (entity_type entity = 0; entity < 100000; entity++)
+  {
+    storage.insert(entity, static_cast<size_t>(entity));
+
+    if (entity % 1000 == 0) epochs.collect();
+  }
+
+  done = true;
+  reader.join();
+
+  size_t count = 0;
+
+  auto guard = epochs.pin(0);
+
+  storage.read(guard, [&](auto)
+    { count++; });
+
+  ASSERT_EQ(count, 100000);
+}
+
+TEST(StorageSnapshot, Freeze_ThenModify_OriginalValues)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 3000; entity++) storage.insert(entity, static_cast<int>(entity));
+
+  auto snapshot = storage.freeze();
+
+  storage.unpack<int>(1500) = -1;
+  storage.erase(10);
+  storage.insert(5000, 5000);
+
+  ASSERT_EQ(snapshot.size(), 3000);
+
+  size_t count = 0;
+
+  snapshot.for_each<int>([&](auto entity, const int& value)
+    {
+      ASSERT_EQ(static_cast<int>(entity), value);
+      count++;
+    });
+
+  ASSERT_EQ(count, 3000);
+  ASSERT_EQ(storage.unpack<int>(1500), -1);
+}
+
+TEST(StorageSnapshot, Freeze_ThenGrow_OriginalValues)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<std::string>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 100; entity++) storage.insert(entity, std::to_string(entity));
+
+  auto snapshot = storage.freeze();
+
+  for (entity_type entity = 100; entity < 10000; entity++) storage.insert(entity, std::to_string(entity));
+
+  storage.unpack<std::string>(0) = "modified";
+
+  size_t count = 0;
+
+  snapshot.for_each<std::string>([&](auto entity, const std::string& value)
+    {
+      ASSERT_EQ(std::to_string(entity), value);
+      count++;
+    });
+
+  ASSERT_EQ(count, 100);
+  ASSERT_EQ(storage.unpack<std::string>(0), "modified");
+}
+
+TEST(StorageSnapshot, Freeze_NoWrites_SharedState)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  storage_type storage;
+
+  storage.insert(0, 1);
+
+  auto first = storage.freeze();
+  auto second = storage.freeze();
+
+  storage.unpack<int>(0) = 2;
+
+  auto third = storage.freeze();
+
+  int values[3] = {};
+
+  first.for_each<int>([&](auto, const int& value)
+    { values[0] = value; });
+  second.for_each<int>([&](auto, const int& value)
+    { values[1] = value; });
+  third.for_each<int>([&](auto, const int& value)
+    { values[2] = value; });
+
+  ASSERT_EQ(values[0], 1);
+  ASSERT_EQ(values[1], 1);
+  ASSERT_EQ(values[2], 2);
+}
+
+TEST(StorageSnapshot, ForEach_ConcurrentWriter_OriginalValues)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 20000; entity++) storage.insert(entity, 0);
+
+  auto snapshot = storage.freeze();
+
+  std::thread reader([&]()
+    {
+      for (int i = 0; i < 20; i++)
+      {
+        snapshot.for_each<int>([](auto, const int& value)
+          { ASSERT_EQ(value, 0); });
+      }
+    });
+
+  for (entity_type entity = 0; entity < 20000; entity++) storage.unpack<int>(entity) = 1;
+  for (entity_type entity = 20000; entity < 40000; entity++) storage.insert(entity, 1);
+
+  reader.join();
+}
+
+TEST(StorageFill, Fill_Zero_EveryComponent)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int, float>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 100; entity++) storage.insert(entity, 1, 2.0f);
+
+  storage.fill(10, 100, 0);
+
+  for (entity_type entity = 0; entity < 100; entity++)
+  {
+    ASSERT_EQ(storage.unpack<int>(entity), entity < 10 ? 1 : 0);
+    ASSERT_EQ(storage.unpack<float>(entity), 2.0f);
+  }
+}
+
+TEST(StorageFill, Fill_Pattern_EveryComponent)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<double>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 100; entity++) storage.insert(entity, 0.0);
+
+  storage.fill(0, storage.size(), 1.5);
+
+  for (entity_type entity = 0; entity < 100; entity++) ASSERT_EQ(storage.unpack<double>(entity), 1.5);
+}
+
+TEST(StorageFill, Fill_LargeColumn_Streamed)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<float>>;
+
+  storage_type storage;
+
+  const entity_type amount = out<float>::stream_threshold / sizeof(float) + 100;
+
+  for (entity_type entity = 0; entity < amount; entity++) storage.insert(entity, 0.0f);
+
+  ASSERT_TRUE(out<float>::streams(amount));
+
+  storage.fill(0, storage.size(), 3.0f);
+
+  for (entity_type entity = 0; entity < amount; entity++) ASSERT_EQ(storage.unpack<float>(entity), 3.0f);
+}
+
+TEST(StorageFill, Fill_NonTrivial_Assigned)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<std::string>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 10; entity++) storage.insert(entity, std::string("old"));
+
+  storage.fill(0, storage.size(), std::string("new"));
+
+  for (entity_type entity = 0; entity < 10; entity++) ASSERT_EQ(storage.unpack<std::string>(entity), "new");
+}
+
+TEST(StorageSingleAllocation, Insert_Grow_SameValues)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<char, double, std::string>, single_allocation_policy>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 1000; entity++)
+  {
+    storage.insert(entity, static_cast<char>(entity), static_cast<double>(entity), std::to_string(entity));
+  }
+
+  for (entity_type entity = 0; entity < 1000; entity += 2) storage.erase(entity);
+
+  storage.shrink_to_fit();
+
+  ASSERT_EQ(storage.capacity(), 500);
+
+  for (entity_type entity = 1; entity < 1000; entity += 2)
+  {
+    ASSERT_EQ(storage.unpack<char>(entity), static_cast<char>(entity));
+    ASSERT_EQ(storage.unpack<double>(entity), static_cast<double>(entity));
+    ASSERT_EQ(storage.unpack<std::string>(entity), std::to_string(entity));
+  }
+}
+
+TEST(StorageSingleAllocation, Columns_CacheLineAligned)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<char, double>, single_allocation_policy>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 100; entity++) storage.insert(entity, 'a', 1.0);
+
+  // The first entity is at the beginning of every column
+  const auto chars = reinterpret_cast<uintptr_t>(&storage.unpack<char>(0));
+  const auto doubles = reinterpret_cast<uintptr_t>(&storage.unpack<double>(0));
+
+  ASSERT_EQ(chars & 63, 0);
+  ASSERT_EQ(doubles & 63, 0);
+  ASSERT_GE(doubles - chars, 100 * sizeof(char));
+
+  struct alignas(128) OverAligned
+  {
+    int value;
+  };
+
+  xecs::storage<entity_type, archetype<char, OverAligned>, single_allocation_policy> over_aligned;
+
+  for (entity_type entity = 0; entity < 100; entity++) over_aligned.insert(entity, 'a', OverAligned { 1 });
+
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(&over_aligned.unpack<char>(0)) & 127, 0);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(&over_aligned.unpack<OverAligned>(0)) & 127, 0);
+}
+
+TEST(StorageSingleAllocation, NonTrivial_EveryConstructorDestroyed)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<NonTrivial>, single_allocation_policy>;
+
+  int constructor_count = 0;
+  int destructor_count = 0;
+
+  {
+    storage_type storage;
+
+    for (entity_type entity = 0; entity < 100; entity++)
+    {
+      NonTrivial inserted { &constructor_count, &destructor_count };
+
+      storage.insert(entity, inserted);
+    }
+  }
+
+  ASSERT_EQ(constructor_count, 100);
+  ASSERT_EQ(destructor_count, 100 * 2);
+}
+
+TEST(StorageSingleAllocation, Read_ConcurrentGrowth_SameValues)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<size_t, std::string>, single_allocation_policy>;
+
+  epoch_manager epochs(1);
+
+  storage_type storage;
+
+  storage.bind(&epochs);
+
+  std::atomic<bool> done { false };
+
+  std::thread reader([&]()
+    {
+      while (!done.load())
+      {
+        auto guard = epochs.pin(0);
+
+        storage.read<size_t>(guard, [](auto entity, const size_t& value)
+          { ASSERT_EQ(entity, value); });
+      }
+    });
+
+  for (entity_type entity = 0; entity < 20000; entity++)
+  {
+    storage.insert(entity, static_cast<size_t>(entity), std::string("component"));
+
+    if (entity % 1000 == 0) epochs.collect();
+  }
+
+  done = true;
+  reader.join();
+
+  ASSERT_EQ(storage.size(), 20000);
+}
+
+TEST(StorageSingleAllocation, Freeze_ThenGrow_OriginalValues)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int, std::string>, single_allocation_policy>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 3000; entity++) storage.insert(entity, static_cast<int>(entity), std::to_string(entity));
+
+  auto snapshot = storage.freeze();
+
+  storage.unpack<int>(5) = -1;
+
+  for (entity_type entity = 3000; entity < 10000; entity++) storage.insert(entity, 0, std::string());
+
+  size_t count = 0;
+
+  snapshot.for_each<int, std::string>([&](auto entity, const int& value, const std::string& name)
+    {
+      ASSERT_EQ(static_cast<int>(entity), value);
+      ASSERT_EQ(std::to_string(entity), name);
+      count++;
+    });
+
+  ASSERT_EQ(count, 3000);
+}
+
+TEST(StorageSharedSparseArray, Shrink_Smaller_CapacityReduced)
+{
+  using entity_type = unsigned int;
+
+  sparse_array<entity_type> sparse;
+
+  sparse.assure(10000);
+  sparse[5] = 3;
+
+  sparse.shrink(100);
+
+  ASSERT_EQ(sparse.capacity(), 100);
+  ASSERT_EQ(sparse[5], 3);
+
+  sparse.shrink(1000);
+
+  ASSERT_EQ(sparse.capacity(), 100);
+}
+
+TEST(StorageConcurrentSparseArray, Shrink_Smaller_WholePagesKept)
+{
+  using entity_type = unsigned int;
+  using sparse_type = concurrent_sparse_array<entity_type>;
+
+  sparse_type sparse;
+
+  sparse.assure(5 * sparse_type::page_size);
+  sparse[5] = 3;
+
+  sparse.shrink(sparse_type::page_size + 1);
+
+  ASSERT_EQ(sparse.capacity(), 2 * sparse_type::page_size);
+  ASSERT_EQ(sparse[5], 3);
+
+  sparse.assure(3 * sparse_type::page_size);
+
+  ASSERT_EQ(sparse.capacity(), 4 * sparse_type::page_size);
+}
+
+TEST(Storage, Renumber_Scattered_DenseIdentifiers)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 100; entity += 10) storage.insert(entity, static_cast<int>(entity));
+
+  std::vector<entity_type> table(100, 0);
+
+  storage.renumber(5, table.data());
+
+  for (entity_type entity = 0; entity < 100; entity += 10)
+  {
+    const entity_type renumbered = table[entity];
+
+    ASSERT_GE(renumbered, 5);
+    ASSERT_LT(renumbered, 15);
+    ASSERT_TRUE(storage.contains(renumbered));
+    ASSERT_EQ(storage.unpack<int>(renumbered), static_cast<int>(entity));
+  }
+}
+
+TEST(Storage, Sort_Range_SortedWithComponents)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int, std::string>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 100; entity > 0; entity--) storage.insert(entity, static_cast<int>(entity), std::to_string(entity));
+
+  storage.sort(10, 60);
+
+  entity_type previous = 0;
+
+  for (size_t index = 0; index < storage.size(); index++)
+  {
+    const entity_type entity = *storage.at(index);
+
+    if (index > 10 && index < 60)
+    {
+      ASSERT_GT(entity, previous);
+    }
+
+    previous = entity;
+
+    ASSERT_EQ(storage.unpack<int>(entity), static_cast<int>(entity));
+    ASSERT_EQ(storage.unpack<std::string>(entity), std::to_string(entity));
+  }
+}
+
+TEST(Storage, HighWater_AfterShrink_LargestCapacity)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 1000; entity++) storage.insert(entity, 0);
+
+  const auto capacity = storage.capacity();
+
+  for (entity_type entity = 0; entity < 900; entity++) storage.erase(entity);
+
+  storage.shrink_to_fit();
+
+  ASSERT_EQ(storage.capacity(), 100);
+  ASSERT_EQ(storage.high_water(), capacity);
+}
+
+TEST(Storage, Broadcast_Block_SameComponents)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int, std::string, char>>;
+
+  storage_type storage;
+
+  storage.insert(0, 1, std::string("first"), 'a');
+  storage.broadcast(100, 1000, 7, std::string("copy"));
+
+  ASSERT_EQ(storage.size(), 1001);
+  ASSERT_EQ(storage.unpack<int>(0), 1);
+
+  for (entity_type entity = 100; entity < 1100; entity++)
+  {
+    ASSERT_TRUE(storage.contains(entity));
+    ASSERT_EQ(storage.unpack<int>(entity), 7);
+    ASSERT_EQ(storage.unpack<std::string>(entity), "copy");
+  }
+
+  ASSERT_FALSE(storage.contains(1100));
+}
+
+TEST(Storage, Clone_Entity_SameComponents)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int, std::string>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 8; entity++) storage.insert(entity, static_cast<int>(entity), std::to_string(entity));
+
+  const auto capacity = storage.capacity();
+
+  storage.clone(5, 10, 500);
+
+  ASSERT_GT(storage.capacity(), capacity);
+  ASSERT_EQ(storage.size(), 508);
+
+  for (entity_type entity = 10; entity < 510; entity++)
+  {
+    ASSERT_EQ(storage.unpack<int>(entity), 5);
+    ASSERT_EQ(storage.unpack<std::string>(entity), "5");
+  }
+}
+
+TEST(StorageZoneMap, Overlaps_SortedKeys_SkipsChunks)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<ZoneHealth, int>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 1024; entity++) storage.insert(entity, ZoneHealth { static_cast<float>(entity) }, 0);
+
+  const range<float> low { 0.0f, 10.0f };
+
+  ASSERT_TRUE(storage.overlaps<ZoneHealth>(0, low));
+  ASSERT_FALSE(storage.overlaps<ZoneHealth>(1, low));
+  ASSERT_FALSE(storage.overlaps<ZoneHealth>(3, low));
+
+  storage.unpack<ZoneHealth>(1000).value = 5.0f;
+
+  ASSERT_TRUE(storage.overlaps<ZoneHealth>(3, low));
+
+  storage.unpack<int>(300) = 1;
+
+  ASSERT_FALSE(storage.overlaps<ZoneHealth>(1, low));
+
+  storage.erase(2);
+
+  ASSERT_TRUE(storage.overlaps<ZoneHealth>(0, range<float> { 1023.0f, 2000.0f }));
+}
+
+TEST(StorageZoneMap, Write_ManyThreadsInOneChunk_ZonesAndIndexStale)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<ZoneHealth, IndexedId>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 256; entity++) storage.insert(entity, ZoneHealth { static_cast<float>(entity) }, IndexedId { entity });
+
+  const range<float> low { 0.0f, 10.0f };
+
+  ASSERT_TRUE(storage.overlaps<ZoneHealth>(0, low));
+  ASSERT_EQ(storage.lookup<IndexedId>(42), 42);
+
+  std::vector<std::thread> threads;
+
+  // Every thread writes a quarter of the same zone chunk
+  for (entity_type t = 0; t < 4; t++)
+  {
+    threads.emplace_back([&storage, t]()
+      {
+        storage.write<ZoneHealth, IndexedId>(t * 64, t * 64 + 64);
+
+        for (entity_type index = t * 64; index < t * 64 + 64; index++)
+        {
+          auto it = storage.at(index);
+
+          it.unpack<ZoneHealth>().value += 1000.0f;
+          it.unpack<IndexedId>().id += 1000;
+        }
+      });
+  }
+
+  for (auto& thread : threads) thread.join();
+
+  ASSERT_FALSE(storage.overlaps<ZoneHealth>(0, low));
+  ASSERT_EQ(storage.lookup<IndexedId>(42), storage_type::entity_type(-1));
+  ASSERT_EQ(storage.lookup<IndexedId>(1042), 42);
+}
+
+TEST(StorageHashIndex, InsertErase_Many_SameEntities)
+{
+  hash_index<std::string, unsigned int> index;
+
+  for (unsigned int i = 0; i < 10000; i++) index.insert(std::to_string(i), i);
+
+  ASSERT_EQ(index.size(), 10000);
+
+  for (unsigned int i = 0; i < 10000; i += 2) index.erase(std::to_string(i), i);
+
+  index.erase("1", 2);
+
+  ASSERT_EQ(index.size(), 5000);
+
+  for (unsigned int i = 0; i < 10000; i++)
+  {
+    ASSERT_EQ(index.find(std::to_string(i)), i % 2 ? i : index.null);
+  }
+}
+
+TEST(StorageHashIndex, Lookup_AfterWritesAndErase_CurrentEntities)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<IndexedId, int>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 1000; entity++) storage.insert(entity, IndexedId { entity * 10u }, 0);
+
+  ASSERT_EQ(storage.lookup<IndexedId>(500), 50);
+  ASSERT_EQ(storage.lookup<IndexedId>(505), storage_type::entity_type(-1));
+
+  // Exchange keys
+  storage.unpack<IndexedId>(1).id = 20;
+  storage.unpack<IndexedId>(2).id = 10;
+
+  storage.erase(3);
+  storage.erase(0);
+
+  storage.insert(2000, IndexedId { 30 }, 0);
+
+  ASSERT_EQ(storage.lookup<IndexedId>(10), 2);
+  ASSERT_EQ(storage.lookup<IndexedId>(20), 1);
+  ASSERT_EQ(storage.lookup<IndexedId>(30), 2000);
+  ASSERT_EQ(storage.lookup<IndexedId>(0), storage_type::entity_type(-1));
+  ASSERT_EQ(storage.lookup<IndexedId>(9990), 999);
+
+  storage.clear();
+
+  ASSERT_EQ(storage.lookup<IndexedId>(9990), storage_type::entity_type(-1));
+}
+
+TEST(StorageHashIndex, Lookup_DuplicateKeyErased_OtherHolderFound)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<IndexedId, int>>;
+
+  storage_type storage;
+
+  storage.insert(1, IndexedId { 7 }, 0);
+  storage.insert(2, IndexedId { 7 }, 0);
+  storage.insert(3, IndexedId { 8 }, 0);
+
+  const entity_type found = storage.lookup<IndexedId>(7);
+
+  ASSERT_TRUE(found == 1 || found == 2);
+
+  storage.erase(found);
+
+  ASSERT_EQ(storage.lookup<IndexedId>(7), found == 1 ? 2 : 1);
+
+  storage.unpack<IndexedId>(3).id = 7;
+  storage.erase(found == 1 ? 2 : 1);
+
+  ASSERT_EQ(storage.lookup<IndexedId>(7), 3);
+  ASSERT_EQ(storage.lookup<IndexedId>(8), storage_type::entity_type(-1));
+}
+
+TEST(StorageComputed, WriteInput_OnlyOutdatedComputed)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<ComputedScale, ComputedOffset, ComputedResult, int>>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 100; entity++) storage.insert(entity, ComputedScale { 1.0f }, ComputedOffset { float(entity) });
+
+  computed_result_calls = 0;
+
+  storage.compute<ComputedResult>(0, storage.size());
+
+  ASSERT_EQ(computed_result_calls, 100);
+  ASSERT_EQ(std::as_const(storage).unpack<ComputedResult>(10).value, 12.0f);
+
+  storage.compute<ComputedResult>(0, storage.size());
+
+  ASSERT_EQ(computed_result_calls, 100);
+
+  // Not an input
+  storage.unpack<int>(20) = 1;
+  storage.write<const ComputedScale>(0, storage.size());
+
+  storage.compute<ComputedResult>(0, storage.size());
+
+  ASSERT_EQ(computed_result_calls, 100);
+
+  // Computed lazily
+  storage.unpack<ComputedScale>(30).value = 3.0f;
+  storage.unpack<ComputedOffset>(40).value = 0.0f;
+
+  ASSERT_EQ(storage.unpack<ComputedResult>(30).value, 36.0f);
+  ASSERT_EQ(computed_result_calls, 101);
+
+  storage.compute<ComputedResult>(0, storage.size());
+
+  ASSERT_EQ(computed_result_calls, 102);
+  ASSERT_EQ(std::as_const(storage).unpack<ComputedResult>(40).value, 2.0f);
+}
+
+TEST(StorageBuffer, ArenaRelease_SameCapacity_Reused)
+{
+  buffer_arena<int> arena;
+
+  const auto first = arena.allocate(16);
+  const auto second = arena.allocate(8);
+
+  ASSERT_EQ(arena.size(), 24);
+
+  arena.release(first, 16);
+
+  ASSERT_EQ(arena.allocate(8), 24);
+  ASSERT_EQ(arena.allocate(16), first);
+  ASSERT_EQ(arena.size(), 32);
+
+  arena.release(second, 8);
+
+  ASSERT_EQ(arena.allocate(8), second);
+}
+
+TEST(StorageBuffer, GrowAndErase_BlocksReused)
+{
+  using entity_type = unsigned int;
+  using waypoints = buffer<int, 4>;
+  using storage_type = storage<entity_type, archetype<waypoints, float>>;
+
+  static_assert(std::is_trivially_copyable_v<waypoints>);
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 100; entity++)
+  {
+    storage.insert(entity);
+
+    waypoints& points = storage.unpack<waypoints>(entity);
+
+    for (int i = 0; i < int(entity % 20); i++) points.push_back(int(entity) * 100 + i);
+  }
+
+  for (entity_type entity = 0; entity < 100; entity++)
+  {
+    const waypoints& points = std::as_const(storage).unpack<waypoints>(entity);
+
+    ASSERT_EQ(points.size(), entity % 20);
+
+    for (int i = 0; i < int(entity % 20); i++) ASSERT_EQ(points[i], int(entity) * 100 + i);
+  }
+
+  waypoints copy = storage.unpack<waypoints>(19);
+
+  storage.erase(19);
+
+  // A copy of a buffer gets its own block when inserted, in the block that was just released
+  storage.insert(1000, copy);
+
+  ASSERT_EQ(storage.unpack<waypoints>(1000).size(), 19);
+  ASSERT_EQ(storage.unpack<waypoints>(1000)[18], 1918);
+
+  storage.clone(1000, 2000, 2);
+
+  storage.unpack<waypoints>(2000)[0] = -1;
+  storage.unpack<waypoints>(2001).pop_back();
+
+  ASSERT_EQ(storage.unpack<waypoints>(1000)[0], 1900);
+  ASSERT_EQ(storage.unpack<waypoints>(1000).size(), 19);
+  ASSERT_EQ(storage.unpack<waypoints>(2000)[0], -1);
+  ASSERT_EQ(storage.unpack<waypoints>(2001).size(), 18);
+
+  for (entity_type entity = 0; entity < 19; entity++) storage.erase(entity);
+
+  for (entity_type entity = 0; entity < 19; entity++)
+  {
+    storage.insert(entity);
+    storage.unpack<waypoints>(entity).resize(entity);
+    storage.unpack<waypoints>(entity).clear();
+    storage.unpack<waypoints>(entity).resize(entity);
+  }
+
+  ASSERT_EQ(storage.unpack<waypoints>(18).size(), 18);
+  ASSERT_EQ(storage.unpack<waypoints>(18)[17], 0);
+}
+
+TEST(CowMemory, Fork_WriteBoth_Independent)
+{
+  const size_t size = 1024 * 1024;
+
+  cow_memory memory(size);
+
+  unsigned char* data = static_cast<unsigned char*>(memory.data());
+
+  for (size_t i = 0; i < size; i++) data[i] = static_cast<unsigned char>(i);
+
+  std::unique_ptr<cow_memory> fork(memory.fork());
+
+  if (!cow_memory::supported())
+  {
+    ASSERT_EQ(fork, nullptr);
+    return;
+  }
+
+  ASSERT_NE(fork, nullptr);
+  ASSERT_EQ(cow_memory::of(fork->data()), fork.get());
+  ASSERT_EQ(cow_memory::of(memory.data()), &memory);
+
+  unsigned char* forked = static_cast<unsigned char*>(fork->data());
+
+  data[0] = 1;
+  forked[size - 1] = 2;
+
+  std::unique_ptr<cow_memory> second(fork->fork());
+
+  forked[4096] = 3;
+
+  ASSERT_EQ(data[0], 1);
+  ASSERT_EQ(data[size - 1], static_cast<unsigned char>(size - 1));
+  ASSERT_EQ(data[4096], 0);
+  ASSERT_EQ(forked[0], 0);
+  ASSERT_EQ(forked[size - 1], 2);
+
+  const unsigned char* seconds = static_cast<const unsigned char*>(second->data());
+
+  ASSERT_EQ(seconds[0], 0);
+  ASSERT_EQ(seconds[size - 1], 2);
+  ASSERT_EQ(seconds[4096], 0);
+
+  fork.reset();
+
+  for (size_t i = 1; i < size - 1; i++) ASSERT_EQ(seconds[i], static_cast<unsigned char>(i));
+}
+
+TEST(StorageFork, LargeSharedPages_WriteBoth_Independent)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int, float>, shared_pages_policy>;
+
+  sparse_array<entity_type> sparse;
+
+  storage_type storage;
+  storage_type fork;
+
+  storage.share(&sparse);
+  fork.share(&sparse);
+
+  for (entity_type entity = 0; entity < 100000; entity++) storage.insert(entity, static_cast<int>(entity), 1.0f);
+
+  storage.fork(fork);
+
+  ASSERT_EQ(fork.size(), 100000);
+  ASSERT_NE(&std::as_const(fork).unpack<int>(5), &std::as_const(storage).unpack<int>(5));
+
+  fork.unpack<int>(5) = -1;
+  storage.unpack<float>(50000) = 2.0f;
+
+  ASSERT_EQ(storage.unpack<int>(5), 5);
+  ASSERT_EQ(fork.unpack<int>(5), -1);
+  ASSERT_EQ(fork.unpack<float>(50000), 1.0f);
+  ASSERT_EQ(storage.unpack<float>(50000), 2.0f);
+
+  // Growing moves the arrays of the fork, the storage keeps its own
+  for (entity_type entity = 100000; entity < 200000; entity++) fork.insert(entity, static_cast<int>(entity), 3.0f);
+
+  ASSERT_EQ(storage.size(), 100000);
+
+  for (entity_type entity = 0; entity < 100000; entity++)
+  {
+    ASSERT_EQ(std::as_const(storage).unpack<int>(entity), static_cast<int>(entity));
+    ASSERT_EQ(std::as_const(fork).unpack<float>(entity), 1.0f);
+  }
+}
+
+TEST(StorageFork, ParentDestroyed_ForkKeepsComponents)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<std::string>>;
+
+  sparse_array<entity_type> sparse;
+
+  auto storage = std::make_unique<storage_type>();
+  storage_type fork;
+
+  storage->share(&sparse);
+  fork.share(&sparse);
+
+  for (entity_type entity = 0; entity < 100; entity++) storage->insert(entity, std::to_string(entity));
+
+  storage->fork(fork);
+
+  storage.reset();
+
+  fork.unpack<std::string>(0) = "modified";
+
+  ASSERT_EQ(fork.unpack<std::string>(0), "modified");
+
+  for (entity_type entity = 1; entity < 100; entity++) ASSERT_EQ(fork.unpack<std::string>(entity), std::to_string(entity));
+}
+
+TEST(StorageFork, Frozen_SnapshotAndForkIndependent)
+{
+  using entity_type = unsigned int;
+  using storage_type = storage<entity_type, archetype<int>>;
+
+  sparse_array<entity_type> sparse;
+
+  storage_type storage;
+  storage_type fork;
+
+  storage.share(&sparse);
+  fork.share(&sparse);
+
+  for (entity_type entity = 0; entity < 100000; entity++) storage.insert(entity, static_cast<int>(entity));
+
+  auto snapshot = storage.freeze();
+
+  storage.fork(fork);
+
+  storage.touch(0, 100000);
+  storage.unpack<int>(0) = -1;
+
+  for (entity_type entity = 0; entity < 100000; entity++) ASSERT_EQ(fork.unpack<int>(entity), static_cast<int>(entity));
+
+  ASSERT_EQ(snapshot.size(), 100000);
+
+  snapshot.for_each<int>([](auto entity, const int& value)
+    { ASSERT_EQ(value, static_cast<int>(entity)); });
+}
+
+TEST(StorageSharedSparseArray, Fork_WriteBoth_Independent)
+{
+  using entity_type = unsigned int;
+
+  sparse_array<entity_type> sparse;
+  sparse_array<entity_type> fork;
+
+  sparse.assure(100000);
+
+  for (entity_type entity = 0; entity < 100000; entity++) sparse[entity] = entity;
+
+  sparse.fork(fork);
+
+  ASSERT_EQ(fork.capacity(), sparse.capacity());
+
+  fork[5] = 0;
+  sparse[6] = 0;
+  fork.assure(300000);
+
+  for (entity_type entity = 7; entity < 100000; entity++) ASSERT_EQ(fork[entity], entity);
+
+  ASSERT_EQ(sparse[5], 5);
+  ASSERT_EQ(fork[6], 6);
+
+  // The first fork moved the array to shared pages, the next fork shares them
+  sparse_array<entity_type> second;
+
+  sparse.fork(second);
+
+  sparse[7] = 0;
+  sparse.shrink(0);
+
+  ASSERT_EQ(second[5], 5);
+  ASSERT_EQ(second[6], 0);
+  ASSERT_EQ(second[7], 7);
+}
+
+TEST(StorageSharedSparseArray, ConcurrentFork_WriteBoth_Independent)
+{
+  using entity_type = unsigned int;
+  using sparse_type = concurrent_sparse_array<entity_type>;
+
+  sparse_type sparse;
+  sparse_type fork;
+
+  sparse.assure(100000);
+
+  for (entity_type entity = 0; entity < 100000; entity++) sparse[entity] = entity;
+
+  sparse.fork(fork);
+
+  ASSERT_EQ(fork.capacity(), sparse.capacity());
+
+  fork[5] = 0;
+  sparse[6] = 0;
+
+  // Shrinking zeroes the pages that are dropped from the last slab
+  sparse.shrink(10);
+  sparse.assure(100000);
+
+  for (entity_type entity = 7; entity < 100000; entity++) ASSERT_EQ(fork[entity], entity);
+
+  ASSERT_EQ(fork[6], 6);
+  ASSERT_EQ(sparse[5], 5);
+  ASSERT_EQ(sparse[sparse_type::page_size], 0);
+  ASSERT_EQ(sparse[99999], 0);
+}
+
+TEST(StorageSharedSparseArray, PackedIndex_ReadWrite_SameValues)
+{
+  using entity_type = uint64_t;
+  using sparse_type = packed_sparse_array<entity_type, 3>;
+
+  sparse_type sparse;
+
+  sparse.assure(1000);
+
+  for (entity_type entity = 0; entity < 1000; entity++) sparse[entity] = static_cast<uint32_t>(entity * 16411) & 0xFFFFFF;
+
+  for (entity_type entity = 0; entity < 1000; entity++) ASSERT_EQ(sparse[entity], static_cast<uint32_t>(entity * 16411) & 0xFFFFFF);
+
+  ASSERT_EQ(sparse_type::max_index, 0xFFFFFF);
+}
+
+struct SmallIndexPolicy : default_policy
+{
+  template<typename Entity>
+  using sparse_type = sparse_array<Entity, uint16_t>;
+};
+
+TEST(StorageSharedSparseArray, SmallIndex_Insert_SameValues)
+{
+  using entity_type = uint64_t;
+
+  using storage_type = storage<entity_type, archetype<int>, SmallIndexPolicy>;
+
+  storage_type storage;
+
+  for (entity_type entity = 0; entity < 3000; entity++) storage.insert(entity * 7, static_cast<int>(entity));
+  for (entity_type entity = 0; entity < 1000; entity++) storage.erase(entity * 7);
+
+  for (entity_type entity = 1000; entity < 3000; entity++)
+  {
+    ASSERT_TRUE(storage.contains(entity * 7));
+    ASSERT_EQ(storage.unpack<int>(entity * 7), static_cast<int>(entity));
+  }
+
+  ASSERT_FALSE(storage.contains(7));
+}